@@ -17,6 +17,8 @@ namespace llarp
     int num_nethreads   = 1;
     bool singleThreaded = false;
     std::vector< std::thread > netio_threads;
+    /// extra loops reading for our inbound links, one per netio thread
+    std::vector< llarp_ev_loop * > netloops;
     llarp_crypto crypto      = {};
     llarp_router *router     = nullptr;
     llarp_threadpool *worker = nullptr;
@@ -25,6 +27,8 @@ namespace llarp
     llarp_nodedb *nodedb     = nullptr;
     llarp_ev_loop *mainloop  = nullptr;
     std::string nodedb_dir;
+    /// write a nodedb snapshot on close for a faster start next time
+    bool nodedb_snapshot = false;
 
     bool
     LoadConfig(const std::string &fname);
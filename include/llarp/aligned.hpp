@@ -131,7 +131,7 @@ namespace llarp
     void
     Randomize()
     {
-      randombytes(b, sz);
+      llarp_randbytes(b, sz);
     }
 
     byte_t*
@@ -45,6 +45,11 @@ typedef bool (*llarp_transport_dh_func)(byte_t *, const byte_t *,
 typedef bool (*llarp_sym_cipher_func)(llarp_buffer_t, const byte_t *,
                                       const byte_t *);
 
+/// SD/SE with several layers in one pass (buffer, keys, nonces, layers)
+typedef bool (*llarp_sym_cipher_layers_func)(llarp_buffer_t,
+                                             const byte_t *const *,
+                                             const byte_t *const *, size_t);
+
 /// H(result, body)
 typedef bool (*llarp_hash_func)(byte_t *, llarp_buffer_t);
 
@@ -66,6 +71,8 @@ struct llarp_crypto
 {
   /// xchacha symettric cipher
   llarp_sym_cipher_func xchacha20;
+  /// xchacha20 of every layer's key and nonce xor'd over the buffer at once
+  llarp_sym_cipher_layers_func xchacha20_layers;
   /// path dh creator's side
   llarp_path_dh_func dh_client;
   /// path dh relay side
@@ -112,4 +119,9 @@ llarp_crypto_initialized(struct llarp_crypto *c);
 uint64_t
 llarp_randint();
 
+/// fill ptr with sz random bytes from this thread's buffered csprng, seeded
+/// from the system rng, reseeded every so often and again after fork
+void
+llarp_randbytes(void *ptr, size_t sz);
+
 #endif
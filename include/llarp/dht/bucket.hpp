@@ -3,20 +3,41 @@
 
 #include <llarp/dht/kademlia.hpp>
 #include <llarp/dht/key.hpp>
-#include <map>
+#include <array>
+#include <list>
+#include <memory>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 namespace llarp
 {
   namespace dht
   {
+    /// kademlia routing table
+    ///
+    /// every key sits in a k-bucket picked by how many leading bits it shares
+    /// with us, each bucket keeps its keys least recently seen first and
+    /// drops from the front when it is over maxPerBucket (0 for no limit).
+    /// closest-k queries walk a crit-bit trie over all keys, taking the
+    /// branch that matches the target first, which hands out keys in xor
+    /// order in O(log n + k).
     template < typename Val_t >
     struct Bucket
     {
-      typedef std::map< Key_t, Val_t, XorMetric > BucketStorage_t;
+      typedef std::unordered_map< Key_t, Val_t, Key_t::Hash > BucketStorage_t;
 
-      Bucket(const Key_t& us) : nodes(XorMetric(us)){};
+      static constexpr size_t KeyBits = 256;
+
+      Bucket(const Key_t& us, size_t perBucket = 0)
+          : maxPerBucket(perBucket), m_Us(us)
+      {
+      }
+
+      Bucket(const Bucket&) = delete;
+
+      Bucket&
+      operator=(const Bucket&) = delete;
 
       size_t
       Size() const
@@ -28,55 +49,52 @@ namespace llarp
       GetRandomNodeExcluding(Key_t& result,
                              const std::set< Key_t >& exclude) const
       {
-        std::vector< Key_t > candidates;
-        for(const auto& item : nodes)
+        if(m_Leaves.size() == 0)
+          return false;
+        // exclude sets are small so a few random picks almost always do it
+        for(size_t tries = 0; tries <= exclude.size(); ++tries)
         {
-          if(exclude.find(item.first) == exclude.end())
-            candidates.push_back(item.first);
+          const Key_t& k = m_Leaves[llarp_randint() % m_Leaves.size()]->key;
+          if(exclude.find(k) == exclude.end())
+          {
+            result = k;
+            return true;
+          }
+        }
+        std::vector< const Key_t* > candidates;
+        for(const auto leaf : m_Leaves)
+        {
+          if(exclude.find(leaf->key) == exclude.end())
+            candidates.push_back(&leaf->key);
         }
         if(candidates.size() == 0)
           return false;
-        result = candidates[llarp_randint() % candidates.size()];
+        result = *candidates[llarp_randint() % candidates.size()];
         return true;
       }
 
       bool
       FindClosest(const Key_t& target, Key_t& result) const
       {
-        Key_t mindist;
-        mindist.Fill(0xff);
-        for(const auto& item : nodes)
-        {
-          auto curDist = item.first ^ target;
-          if(curDist < mindist)
-          {
-            mindist = curDist;
-            result  = item.first;
-          }
-        }
-        return nodes.size() > 0;
+        return FindCloseExcluding(target, result, {});
       }
 
       bool
       GetManyRandom(std::set< Key_t >& result, size_t N) const
       {
-        if(nodes.size() < N)
+        if(m_Leaves.size() < N)
           return false;
-        if(nodes.size() == N)
+        if(m_Leaves.size() == N)
         {
-          for(const auto& node : nodes)
-          {
-            result.insert(node.first);
-          }
+          for(const auto leaf : m_Leaves)
+            result.insert(leaf->key);
           return true;
         }
         size_t expecting = N;
-        size_t sz        = nodes.size();
         while(N)
         {
-          auto itr = nodes.begin();
-          std::advance(itr, llarp_randint() % sz);
-          if(result.insert(itr->first).second)
+          if(result.insert(m_Leaves[llarp_randint() % m_Leaves.size()]->key)
+                 .second)
             --N;
         }
         return result.size() == expecting;
@@ -86,60 +104,264 @@ namespace llarp
       GetManyNearExcluding(const Key_t& target, std::set< Key_t >& result,
                            size_t N, const std::set< Key_t >& exclude) const
       {
-        std::set< Key_t > s;
-        for(const auto& k : exclude)
-          s.insert(k);
-        Key_t peer;
-        while(N--)
-        {
-          if(!FindCloseExcluding(target, peer, s))
-            return false;
-          s.insert(peer);
-          result.insert(peer);
-        }
-        return true;
+        if(N == 0)
+          return true;
+        WalkClosest(target, [&](const Key_t& k) -> bool {
+          if(exclude.count(k) == 0 && result.insert(k).second)
+            --N;
+          return N > 0;
+        });
+        return N == 0;
       }
 
       bool
       FindCloseExcluding(const Key_t& target, Key_t& result,
                          const std::set< Key_t >& exclude) const
       {
-        Key_t maxdist;
-        maxdist.Fill(0xff);
-        Key_t mindist;
-        mindist.Fill(0xff);
-        for(const auto& item : nodes)
-        {
-          if(exclude.count(item.first))
-            continue;
-
-          auto curDist = item.first ^ target;
-          if(curDist < mindist)
-          {
-            mindist = curDist;
-            result  = item.first;
-          }
-        }
-        return mindist < maxdist;
+        bool found = false;
+        WalkClosest(target, [&](const Key_t& k) -> bool {
+          if(exclude.count(k))
+            return true;
+          result = k;
+          found  = true;
+          return false;
+        });
+        return found;
       }
 
       void
       PutNode(const Val_t& val)
       {
         auto itr = nodes.find(val.ID);
-        if(itr == nodes.end() || itr->second < val)
-          nodes[val.ID] = val;
+        if(itr == nodes.end())
+        {
+          nodes.emplace(val.ID, val);
+          Insert(val.ID);
+          return;
+        }
+        if(itr->second < val)
+          itr->second = val;
+        Touch(val.ID);
       }
 
       void
       DelNode(const Key_t& key)
       {
         auto itr = nodes.find(key);
-        if(itr != nodes.end())
-          nodes.erase(itr);
+        if(itr == nodes.end())
+          return;
+        Remove(key);
+        nodes.erase(itr);
       }
 
+      /// the value stored under key or nullptr
+      const Val_t*
+      GetNode(const Key_t& key) const
+      {
+        auto itr = nodes.find(key);
+        if(itr == nodes.end())
+          return nullptr;
+        return &itr->second;
+      }
+
+      /// delete every value pred returns true for
+      /// return how many we deleted
+      template < typename Pred_t >
+      size_t
+      RemoveIf(Pred_t pred)
+      {
+        size_t removed = 0;
+        auto itr       = nodes.begin();
+        while(itr != nodes.end())
+        {
+          if(pred(itr->second))
+          {
+            Remove(itr->first);
+            itr = nodes.erase(itr);
+            ++removed;
+          }
+          else
+            ++itr;
+        }
+        return removed;
+      }
+
+      /// number of keys in the k-bucket sharing prefix leading bits with us
+      size_t
+      BucketSize(size_t prefix) const
+      {
+        return m_Buckets[prefix].size();
+      }
+
+      /// leading bits a and b have in common
+      static size_t
+      CommonPrefix(const Key_t& a, const Key_t& b)
+      {
+        for(size_t idx = 0; idx < a.size(); ++idx)
+        {
+          byte_t x = a.data()[idx] ^ b.data()[idx];
+          if(x == 0)
+            continue;
+          size_t bit = idx * 8;
+          while((x & 0x80) == 0)
+          {
+            x <<= 1;
+            ++bit;
+          }
+          return bit;
+        }
+        return KeyBits;
+      }
+
+      /// 0 for no limit
+      const size_t maxPerBucket;
+
+      /// read only, changes go through PutNode, DelNode and RemoveIf so the
+      /// routing table stays in step
       BucketStorage_t nodes;
+
+     private:
+      struct Node
+      {
+        /// bit the children differ at, KeyBits on leaves
+        size_t bit = KeyBits;
+        std::unique_ptr< Node > child[2];
+        /// the rest is for leaves
+        Key_t key;
+        /// index in m_Leaves
+        size_t slot   = 0;
+        size_t prefix = 0;
+        typename std::list< Node* >::iterator seen;
+      };
+
+      static size_t
+      Bit(const Key_t& k, size_t bit)
+      {
+        return (k.data()[bit >> 3] >> (7 - (bit & 7))) & 1;
+      }
+
+      /// visit keys closest to target first until visit returns false
+      template < typename Visit_t >
+      void
+      WalkClosest(const Key_t& target, Visit_t visit) const
+      {
+        if(m_Root)
+          Walk(m_Root.get(), target, visit);
+      }
+
+      template < typename Visit_t >
+      static bool
+      Walk(const Node* n, const Key_t& target, Visit_t& visit)
+      {
+        if(n->bit == KeyBits)
+          return visit(n->key);
+        // every key under the branch matching target's bit is closer than
+        // every key under the other one
+        const size_t dir = Bit(target, n->bit);
+        return Walk(n->child[dir].get(), target, visit)
+            && Walk(n->child[dir ^ 1].get(), target, visit);
+      }
+
+      Node*
+      FindLeaf(const Key_t& key) const
+      {
+        Node* n = m_Root.get();
+        if(n == nullptr)
+          return nullptr;
+        while(n->bit != KeyBits)
+          n = n->child[Bit(key, n->bit)].get();
+        return n->key == key ? n : nullptr;
+      }
+
+      void
+      Insert(const Key_t& key)
+      {
+        std::unique_ptr< Node > leaf(new Node());
+        Node* added   = leaf.get();
+        added->key    = key;
+        added->slot   = m_Leaves.size();
+        added->prefix = CommonPrefix(key, m_Us);
+        auto& bucket  = m_Buckets[added->prefix];
+        added->seen   = bucket.insert(bucket.end(), added);
+        m_Leaves.push_back(added);
+
+        if(m_Root == nullptr)
+          m_Root = std::move(leaf);
+        else
+        {
+          // any leaf we end up at shares the longest prefix with key
+          const Node* n = m_Root.get();
+          while(n->bit != KeyBits)
+            n = n->child[Bit(key, n->bit)].get();
+          const size_t crit = CommonPrefix(key, n->key);
+          // hang a new branch above the first node splitting past crit
+          std::unique_ptr< Node >* where = &m_Root;
+          while((*where)->bit < crit)
+            where = &(*where)->child[Bit(key, (*where)->bit)];
+          std::unique_ptr< Node > branch(new Node());
+          const size_t dir       = Bit(key, crit);
+          branch->bit            = crit;
+          branch->child[dir]     = std::move(leaf);
+          branch->child[dir ^ 1] = std::move(*where);
+          *where                 = std::move(branch);
+        }
+
+        if(maxPerBucket && bucket.size() > maxPerBucket)
+        {
+          Key_t stale = bucket.front()->key;
+          nodes.erase(stale);
+          Remove(stale);
+        }
+      }
+
+      /// move key to the back of its bucket
+      void
+      Touch(const Key_t& key)
+      {
+        Node* leaf = FindLeaf(key);
+        if(leaf == nullptr)
+          return;
+        auto& bucket = m_Buckets[leaf->prefix];
+        bucket.splice(bucket.end(), bucket, leaf->seen);
+      }
+
+      void
+      Remove(const Key_t& key)
+      {
+        std::unique_ptr< Node >* where  = &m_Root;
+        std::unique_ptr< Node >* parent = nullptr;
+        size_t dir                      = 0;
+        if(*where == nullptr)
+          return;
+        while((*where)->bit != KeyBits)
+        {
+          parent = where;
+          dir    = Bit(key, (*where)->bit);
+          where  = &(*where)->child[dir];
+        }
+        Node* leaf = where->get();
+        if(!(leaf->key == key))
+          return;
+        m_Buckets[leaf->prefix].erase(leaf->seen);
+        m_Leaves[leaf->slot]       = m_Leaves.back();
+        m_Leaves[leaf->slot]->slot = leaf->slot;
+        m_Leaves.pop_back();
+        if(parent == nullptr)
+          m_Root.reset();
+        else
+        {
+          // the sibling takes the parent's place
+          std::unique_ptr< Node > sibling =
+              std::move((*parent)->child[dir ^ 1]);
+          *parent = std::move(sibling);
+        }
+      }
+
+      Key_t m_Us;
+      std::unique_ptr< Node > m_Root;
+      /// every leaf in no order for random picks
+      std::vector< Node* > m_Leaves;
+      std::array< std::list< Node* >, KeyBits + 1 > m_Buckets;
     };
   }  // namespace dht
 }  // namespace llarp
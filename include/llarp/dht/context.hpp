@@ -4,10 +4,12 @@
 #include <llarp/dht.h>
 #include <llarp/router.h>
 #include <llarp/dht/bucket.hpp>
+#include <llarp/dht/introset_store.hpp>
 #include <llarp/dht/key.hpp>
 #include <llarp/dht/message.hpp>
 #include <llarp/dht/messages/findintro.hpp>
 #include <llarp/dht/node.hpp>
+#include <llarp/dht/verifier.hpp>
 #include <llarp/service/IntroSet.hpp>
 
 #include <set>
@@ -204,6 +206,12 @@ namespace llarp
                           const Key_t& target, bool recursive,
                           std::vector< std::unique_ptr< IMessage > >& replies);
 
+      /// send replies to a request we finished handling later, back down the
+      /// path it came in on or straight to the peer that sent it
+      void
+      SendReplies(const IMessage* request,
+                  std::vector< std::unique_ptr< IMessage > >& replies);
+
       /// relay a dht messeage from a local path to the main network
       bool
       RelayRequestForPath(const llarp::PathID_t& localPath,
@@ -238,8 +246,12 @@ namespace llarp
       Bucket< RCNode >* nodes = nullptr;
 
       // for introduction sets
-      Bucket< ISNode >* services = nullptr;
-      bool allowTransit          = false;
+      IntroSetStore* services = nullptr;
+      size_t maxIntroSets     = IntroSetStore::DefaultMaxIntroSets;
+      bool allowTransit       = false;
+
+      // checks introset and rc signatures on the worker pool
+      Verifier verifier;
 
       const Key_t&
       OurKey() const
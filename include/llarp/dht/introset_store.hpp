@@ -0,0 +1,100 @@
+#ifndef LLARP_DHT_INTROSET_STORE_HPP
+#define LLARP_DHT_INTROSET_STORE_HPP
+
+#include <llarp/dht/key.hpp>
+#include <llarp/service/IntroSet.hpp>
+#include <llarp/service/tag.hpp>
+#include <llarp/time.h>
+
+#include <functional>
+#include <queue>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace llarp
+{
+  namespace dht
+  {
+    /// introsets we hold for the dht by service address
+    ///
+    /// indexed by topic so tag lookups only touch matches, and by the time
+    /// their last intro runs out so expiring only touches what expired.
+    /// past maxIntroSets the one farthest from us goes, as that is the one
+    /// we are least responsible for.
+    struct IntroSetStore
+    {
+      static constexpr size_t DefaultMaxIntroSets = 50000;
+
+      IntroSetStore(const Key_t& us, size_t max = DefaultMaxIntroSets);
+
+      /// store introset or replace an older one at the same address
+      /// return false if we are full of introsets closer to us than it
+      bool
+      Put(const service::IntroSet& introset);
+
+      /// stored introset for service address or nullptr
+      const service::IntroSet*
+      Get(const Key_t& addr) const;
+
+      /// drop all introsets with no intros left at now
+      /// return how many we dropped
+      size_t
+      Expire(llarp_time_t now);
+
+      /// up to max introsets with topic tag that are not in exclude, starting
+      /// at a random one
+      std::set< service::IntroSet >
+      FindRandomWithTagExcluding(
+          const service::Tag& tag, size_t max,
+          const std::set< service::IntroSet >& exclude) const;
+
+      size_t
+      Size() const
+      {
+        return m_IntroSets.size();
+      }
+
+      size_t maxIntroSets;
+
+     private:
+      struct Entry
+      {
+        service::IntroSet introset;
+        service::Tag topic;
+        llarp_time_t expiresAt = 0;
+        /// index in m_ByTag[topic]
+        size_t tagSlot = 0;
+      };
+
+      /// tags compare as the strings they hold
+      static service::Tag
+      TopicOf(const service::Tag& tag);
+
+      void
+      Remove(const Key_t& addr);
+
+      void
+      AddToTag(const Key_t& addr, Entry& entry);
+
+      void
+      RemoveFromTag(const Entry& entry);
+
+      typedef std::pair< llarp_time_t, Key_t > Expiry_t;
+
+      Key_t m_Us;
+      std::unordered_map< Key_t, Entry, Key_t::Hash > m_IntroSets;
+      std::unordered_map< service::Tag, std::vector< Key_t >,
+                          service::Tag::Hash >
+          m_ByTag;
+      /// soonest first, replaced and evicted entries are left in and skipped
+      std::priority_queue< Expiry_t, std::vector< Expiry_t >,
+                           std::greater< Expiry_t > >
+          m_Expiry;
+      /// address ^ us, farthest last
+      std::set< Key_t > m_ByDistance;
+    };
+  }  // namespace dht
+}  // namespace llarp
+
+#endif
@@ -8,6 +8,9 @@ namespace llarp
 {
   namespace dht
   {
+    struct Context;
+    struct TXOwner;
+
     /// acknologement to PublishIntroMessage or reply to FinIntroMessage
     struct GotIntroMessage : public IMessage
     {
@@ -32,6 +35,11 @@ namespace llarp
       virtual bool
       HandleMessage(llarp_dht_context* ctx,
                     std::vector< std::unique_ptr< IMessage > >& replies) const;
+
+      /// store and hand to the lookup owner once signatures have been checked
+      static void
+      HandleVerified(Context& dht, const TXOwner& owner, bool valid,
+                     const std::vector< llarp::service::IntroSet >& introsets);
     };
 
     struct RelayedGotIntroMessage : public GotIntroMessage
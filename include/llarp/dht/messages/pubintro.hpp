@@ -8,6 +8,8 @@ namespace llarp
 {
   namespace dht
   {
+    struct Context;
+
     struct PublishIntroMessage : public IMessage
     {
       llarp::service::IntroSet I;
@@ -39,6 +41,11 @@ namespace llarp
       virtual bool
       HandleMessage(llarp_dht_context* ctx,
                     std::vector< std::unique_ptr< IMessage > >& replies) const;
+
+      /// store and propagate once the signature has been checked
+      void
+      HandleVerified(Context& dht, bool valid,
+                     std::vector< std::unique_ptr< IMessage > >& replies) const;
     };
   }  // namespace dht
 }  // namespace llarp
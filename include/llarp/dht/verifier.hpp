@@ -0,0 +1,108 @@
+#ifndef LLARP_DHT_VERIFIER_HPP
+#define LLARP_DHT_VERIFIER_HPP
+
+#include <llarp/crypto.hpp>
+#include <llarp/logic.h>
+#include <llarp/router_contact.hpp>
+#include <llarp/service/IntroSet.hpp>
+#include <llarp/threading.hpp>
+#include <llarp/threadpool.h>
+
+#include <deque>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+namespace llarp
+{
+  namespace dht
+  {
+    /// checks signatures on introsets and router contacts off the logic
+    /// thread
+    ///
+    /// jobs queue up on the logic thread and go to the worker pool in
+    /// batches, results come back on the logic thread. blobs whose signature
+    /// already checked out are remembered by hash so the same introset or rc
+    /// going past again only costs a hash.
+    struct Verifier
+    {
+      struct Job
+      {
+        std::vector< service::IntroSet > introsets;
+        std::vector< RouterContact > rcs;
+        /// called on the logic thread once valid is set
+        std::function< void(Job& job) > result;
+        /// true if everything passed
+        bool valid = false;
+      };
+
+      /// jobs per worker batch, 0 verifies inline on the caller
+      size_t batchSize = 8;
+      /// how many good signatures we remember
+      size_t cacheSize = 4096;
+
+      void
+      Init(llarp_crypto* crypto, llarp_threadpool* worker, llarp_logic* logic);
+
+      void
+      Queue(Job job);
+
+      /// verify right now, still going through the cache
+      bool
+      Verify(const service::IntroSet& introset);
+
+      bool
+      Verify(const RouterContact& rc);
+
+      /// jobs queued or on the worker pool
+      size_t
+      Pending() const;
+
+      /// remembered good signatures
+      size_t
+      CacheSize() const;
+
+     private:
+      struct Batch
+      {
+        Verifier* parent;
+        std::vector< Job > jobs;
+      };
+
+      bool
+      Verify(const Job& job);
+
+      bool
+      HasGoodSignature(const ShortHash& h);
+
+      void
+      PutGoodSignature(const ShortHash& h);
+
+      void
+      Dispatch();
+
+      static void
+      HandleFlush(void* user);
+
+      static void
+      HandleWork(void* user);
+
+      static void
+      HandleDone(void* user);
+
+      llarp_crypto* m_Crypto     = nullptr;
+      llarp_threadpool* m_Worker = nullptr;
+      llarp_logic* m_Logic       = nullptr;
+      std::vector< Job > m_Pending;
+      size_t m_InFlight     = 0;
+      bool m_FlushScheduled = false;
+
+      mutable util::Mutex m_CacheAccess;
+      std::unordered_set< ShortHash, ShortHash::Hash > m_Good;
+      /// oldest first
+      std::deque< ShortHash > m_GoodOrder;
+    };
+  }  // namespace dht
+}  // namespace llarp
+
+#endif
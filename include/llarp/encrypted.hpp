@@ -3,6 +3,7 @@
 
 #include <llarp/bencode.h>
 #include <llarp/buffer.h>
+#include <llarp/crypto.h>
 #include <sodium.h>
 #include <vector>
 #include <stdexcept>
@@ -71,7 +72,7 @@ namespace llarp
     Randomize()
     {
       if(_sz)
-        randombytes(_data, _sz);
+        llarp_randbytes(_data, _sz);
     }
 
     bool
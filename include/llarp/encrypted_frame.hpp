@@ -47,6 +47,16 @@ namespace llarp
     bool
     EncryptInPlace(const byte_t* seckey, const byte_t* other,
                    llarp_crypto* crypto);
+
+    /// decrypt a frame that lives in someone else's memory
+    static bool
+    DecryptInPlace(llarp_buffer_t frame, const byte_t* seckey,
+                   llarp_crypto* crypto);
+
+    /// encrypt a frame that lives in someone else's memory
+    static bool
+    EncryptInPlace(llarp_buffer_t frame, const byte_t* seckey,
+                   const byte_t* other, llarp_crypto* crypto);
   };
 
   /// TOOD: can only handle 1 frame at a time
@@ -36,7 +36,7 @@ llarp_ev_loop_alloc(struct llarp_ev_loop **ev);
 void
 llarp_ev_loop_free(struct llarp_ev_loop **ev);
 
-/// run main loop
+/// run main loop, logic may be null for loops that only do network io
 int
 llarp_ev_loop_run(struct llarp_ev_loop *ev, struct llarp_logic *logic);
 
@@ -68,6 +68,19 @@ int
 llarp_ev_add_udp(struct llarp_ev_loop *ev, struct llarp_udp_io *udp,
                  const struct sockaddr *src);
 
+/// set SO_REUSEPORT on UDP sockets the loop binds from now on so that they
+/// can be mirrored by other loops
+void
+llarp_ev_loop_set_reuseport(struct llarp_ev_loop *ev, bool enable);
+
+/// bind another socket on ev to the address of udp, which was added to a
+/// loop with reuseport set, the kernel spreads remotes across the sockets by
+/// 4-tuple and datagrams read on ev are handed to udp on its own loop
+/// call before either loop runs
+/// returns 0 on success or -1 if not supported on this platform
+int
+llarp_ev_udp_mirror(struct llarp_ev_loop *ev, struct llarp_udp_io *udp);
+
 /// schedule UDP packet
 int
 llarp_ev_udp_sendto(struct llarp_udp_io *udp, const struct sockaddr *to,
@@ -77,6 +90,20 @@ llarp_ev_udp_sendto(struct llarp_udp_io *udp, const struct sockaddr *to,
 int
 llarp_ev_close_udp(struct llarp_udp_io *udp);
 
+/// datagram counters for a UDP handler
+/// pkts / calls is the number of datagrams moved per syscall
+struct llarp_udp_stats
+{
+  uint64_t rx_pkts;
+  uint64_t rx_calls;
+  uint64_t tx_pkts;
+  uint64_t tx_calls;
+};
+
+/// get datagram counters for a UDP handler
+void
+llarp_ev_udp_get_stats(struct llarp_udp_io *udp, struct llarp_udp_stats *stats);
+
 #ifdef _WIN32
 #define IFNAMSIZ (16)
 #endif
@@ -97,6 +124,10 @@ struct llarp_tun_io
   /// called every event loop tick after reads
   void (*tick)(struct llarp_tun_io *);
   void (*recvpkt)(struct llarp_tun_io *, const void *, ssize_t);
+  /// if set, called before each read for where to read the next packet into
+  /// and how big it may be, returning NULL reads into the event loop's
+  /// buffer instead. recvpkt gets the same pointer back
+  void *(*recvbuf)(struct llarp_tun_io *, size_t *);
 };
 
 /// create tun interface with network interface name ifname
@@ -3,9 +3,12 @@
 #include <llarp/ev.h>
 #include <llarp/codel.hpp>
 #include <llarp/ip.hpp>
+#include <llarp/lockfree.hpp>
 #include <llarp/service/endpoint.hpp>
 #include <llarp/threading.hpp>
 
+#include <atomic>
+
 namespace llarp
 {
   namespace handlers
@@ -73,6 +76,11 @@ namespace llarp
       static void
       tunifRecvPkt(llarp_tun_io* t, const void* pkt, ssize_t sz);
 
+      /// called before every read from the tun interface for the send ring
+      /// slot to read into
+      static void*
+      tunifRecvBuf(llarp_tun_io* t, size_t* sz);
+
       /// called in the endpoint logic thread
       static void
       handleTickTun(void* u);
@@ -82,8 +90,13 @@ namespace llarp
           net::IPv4Packet, net::IPv4Packet::GetTime, net::IPv4Packet::PutTime,
           net::IPv4Packet::CompareOrder >
           PacketQueue_t;
-      /// queue for sending packets over the network from us
-      PacketQueue_t m_UserToNetworkPktQueue;
+      typedef llarp::util::SPSCRing< net::IPv4Packet, 512 > PacketRing_t;
+      /// ring for sending packets over the network from us, the tun thread
+      /// reads into it and the router logic sends from it
+      PacketRing_t m_UserToNetworkPktQueue;
+      /// set while a flush of m_UserToNetworkPktQueue is queued on the router
+      /// logic
+      std::atomic< bool > m_NetSendQueued{false};
       /// queue for sending packets to user from network
       PacketQueue_t m_NetworkToUserPktQueue;
       /// return true if we have a remote loki address for this ip address
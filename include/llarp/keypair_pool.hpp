@@ -0,0 +1,57 @@
+#ifndef LLARP_KEYPAIR_POOL_HPP
+#define LLARP_KEYPAIR_POOL_HPP
+
+#include <llarp/crypto.hpp>
+#include <llarp/threading.hpp>
+#include <llarp/threadpool.h>
+
+#include <vector>
+
+namespace llarp
+{
+  /// ephemeral x25519 keypairs made ahead of time on the worker pool so path
+  /// builds don't wait on keygen. once it is down to half it tops itself back
+  /// up in the background. the worker must be joined before this goes
+  struct KeypairPool
+  {
+    KeypairPool(llarp_crypto* crypto, size_t capacity = 128);
+
+    ~KeypairPool();
+
+    /// refill from worker, starting now. null makes every key on the caller
+    void
+    Init(llarp_threadpool* worker);
+
+    /// a fresh keypair in encryption_keygen's layout, made on the spot if
+    /// the pool is dry
+    void
+    Take(SecretKey& k);
+
+    /// keypairs ready right now
+    size_t
+    Size() const;
+
+    /// how many Take calls had to make their own
+    size_t
+    Misses() const;
+
+    /// most keypairs held, 0 turns the pool off
+    size_t capacity;
+
+   private:
+    static void
+    HandleRefill(void* user);
+
+    void
+    Refill();
+
+    llarp_crypto* m_Crypto;
+    llarp_threadpool* m_Worker = nullptr;
+    mutable util::Mutex m_Access;
+    std::vector< SecretKey > m_Keys;
+    bool m_Refilling = false;
+    size_t m_Misses  = 0;
+  };
+}  // namespace llarp
+
+#endif
@@ -95,6 +95,14 @@ namespace llarp
     void
     MapAddr(const PubKey& pk, ILinkSession* s);
 
+    /// datagram and syscall counters for our socket
+    void
+    GetUDPStats(llarp_udp_stats& stats);
+
+    /// read for our socket on another net thread's loop too
+    bool
+    Mirror(llarp_ev_loop* loop);
+
     virtual void
     Tick(llarp_time_t now)
     {
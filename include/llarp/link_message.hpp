@@ -4,6 +4,7 @@
 #include <llarp/bencode.hpp>
 #include <llarp/router_id.hpp>
 #include <llarp/link/session.hpp>
+#include <llarp/packet_buffer.hpp>
 
 #include <queue>
 #include <vector>
@@ -41,6 +42,7 @@ namespace llarp
   struct InboundMessageParser
   {
     InboundMessageParser(llarp_router* router);
+    ~InboundMessageParser();
     dict_reader reader;
 
     static bool
@@ -50,6 +52,11 @@ namespace llarp
     bool
     ProcessFrom(ILinkSession* from, llarp_buffer_t buf);
 
+    /// process a message held in a pooled buffer
+    /// relayed payloads share pkt instead of being copied out of it
+    bool
+    ProcessFrom(ILinkSession* from, const PacketRef& pkt, size_t sz);
+
     /// called when the message is fully read
     /// return true when the message was accepted otherwise returns false
     bool
@@ -67,7 +74,13 @@ namespace llarp
     bool firstkey;
     llarp_router* router;
     ILinkSession* from = nullptr;
-    std::unique_ptr< ILinkMessage > msg;
+    PacketRef packet;
+    ILinkMessage* msg = nullptr;
+    std::unique_ptr< ILinkMessage > allocated;
+
+    /// relay messages are reused so relaying does not allocate
+    struct msg_holder_t;
+    std::unique_ptr< msg_holder_t > holder;
   };
 }  // namespace llarp
 
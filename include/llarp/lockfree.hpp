@@ -0,0 +1,169 @@
+#ifndef LLARP_LOCKFREE_HPP
+#define LLARP_LOCKFREE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace llarp
+{
+  namespace util
+  {
+    /// bounded lock free multi producer single consumer ring
+    /// each cell carries a sequence number so producers claim a cell with one
+    /// CAS and the consumer never takes a lock
+    template < typename T, size_t Capacity = 4096 >
+    struct MPSCRing
+    {
+      static_assert(Capacity && ((Capacity & (Capacity - 1)) == 0),
+                    "capacity must be a power of 2");
+
+      MPSCRing() : m_Head(0), m_Tail(0)
+      {
+        for(size_t idx = 0; idx < Capacity; ++idx)
+          m_Cells[idx].seq.store(idx, std::memory_order_relaxed);
+      }
+
+      /// called from any thread
+      /// return false if the ring is full
+      bool
+      TryPush(T&& val)
+      {
+        Cell* cell;
+        size_t pos = m_Head.load(std::memory_order_relaxed);
+        for(;;)
+        {
+          cell          = &m_Cells[pos & Mask];
+          size_t seq    = cell->seq.load(std::memory_order_acquire);
+          intptr_t diff = intptr_t(seq) - intptr_t(pos);
+          if(diff == 0)
+          {
+            if(m_Head.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed))
+              break;
+          }
+          else if(diff < 0)
+            return false;
+          else
+            pos = m_Head.load(std::memory_order_relaxed);
+        }
+        cell->val = std::move(val);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+
+      /// called from the consumer thread only
+      /// return false if the ring is empty
+      bool
+      TryPop(T& val)
+      {
+        Cell* cell    = &m_Cells[m_Tail & Mask];
+        size_t seq    = cell->seq.load(std::memory_order_acquire);
+        intptr_t diff = intptr_t(seq) - intptr_t(m_Tail + 1);
+        if(diff < 0)
+          return false;
+        val = std::move(cell->val);
+        cell->seq.store(m_Tail + Capacity, std::memory_order_release);
+        ++m_Tail;
+        return true;
+      }
+
+      /// called from the consumer thread only
+      /// number of claimed cells, may be stale by the time it returns
+      size_t
+      SizeApprox() const
+      {
+        return m_Head.load(std::memory_order_relaxed) - m_Tail;
+      }
+
+     private:
+      static constexpr size_t Mask = Capacity - 1;
+
+      struct Cell
+      {
+        std::atomic< size_t > seq;
+        T val;
+      };
+
+      std::array< Cell, Capacity > m_Cells;
+      /// producers and consumer on different cache lines
+      alignas(64) std::atomic< size_t > m_Head;
+      alignas(64) size_t m_Tail;
+    };
+
+    /// bounded lock free single producer single consumer ring of slots that
+    /// are filled and read in place, so nothing is copied in or out
+    template < typename T, size_t Capacity = 1024 >
+    struct SPSCRing
+    {
+      static_assert(Capacity && ((Capacity & (Capacity - 1)) == 0),
+                    "capacity must be a power of 2");
+
+      SPSCRing() : m_Head(0), m_Tail(0)
+      {
+      }
+
+      /// called from the producer thread only
+      /// the slot to fill next, stays the producer's until Push
+      /// return nullptr if the ring is full
+      T*
+      Reserve()
+      {
+        const size_t head = m_Head.load(std::memory_order_relaxed);
+        if(head - m_Tail.load(std::memory_order_acquire) == Capacity)
+          return nullptr;
+        return &m_Slots[head & Mask];
+      }
+
+      /// called from the producer thread only
+      /// hand the slot from Reserve to the consumer
+      void
+      Push()
+      {
+        m_Head.store(m_Head.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_release);
+      }
+
+      /// called from the consumer thread only
+      /// the oldest pushed slot, stays the consumer's until Pop
+      /// return nullptr if the ring is empty
+      T*
+      Front()
+      {
+        const size_t tail = m_Tail.load(std::memory_order_relaxed);
+        if(tail == m_Head.load(std::memory_order_acquire))
+          return nullptr;
+        return &m_Slots[tail & Mask];
+      }
+
+      /// called from the consumer thread only
+      /// give the slot from Front back to the producer
+      void
+      Pop()
+      {
+        m_Tail.store(m_Tail.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_release);
+      }
+
+      /// number of pushed slots, may be stale by the time it returns
+      size_t
+      SizeApprox() const
+      {
+        return m_Head.load(std::memory_order_acquire)
+            - m_Tail.load(std::memory_order_acquire);
+      }
+
+     private:
+      static constexpr size_t Mask = Capacity - 1;
+
+      std::array< T, Capacity > m_Slots;
+      /// producer and consumer on different cache lines
+      alignas(64) std::atomic< size_t > m_Head;
+      alignas(64) std::atomic< size_t > m_Tail;
+    };
+  }  // namespace util
+}  // namespace llarp
+
+#endif
@@ -24,6 +24,8 @@ namespace llarp
     KeyExchangeNonce N;
     Signature Z;
     uint64_t P;
+    /// link layer feature bits the sender supports, omitted when 0
+    uint64_t F = 0;
 
     LinkIntroMessage&
     operator=(const LinkIntroMessage& msg);
@@ -3,7 +3,7 @@
 #include <llarp/link_message.hpp>
 
 #include <llarp/crypto.hpp>
-#include <llarp/encrypted.hpp>
+#include <llarp/packet_buffer.hpp>
 #include <llarp/path_types.hpp>
 #include <vector>
 
@@ -12,13 +12,19 @@ namespace llarp
   struct RelayUpstreamMessage : public ILinkMessage
   {
     PathID_t pathid;
-    Encrypted X;
+    PacketSlice X;
     TunnelNonce Y;
+    /// pooled buffer we are decoding from, X shares its bytes
+    PacketRef packet;
 
     RelayUpstreamMessage();
     RelayUpstreamMessage(ILinkSession* from);
     ~RelayUpstreamMessage();
 
+    /// forget the last message and decode the next one from pkt
+    void
+    Reset(ILinkSession* from, const PacketRef& pkt);
+
     bool
     DecodeKey(llarp_buffer_t key, llarp_buffer_t* buf);
 
@@ -32,12 +38,19 @@ namespace llarp
   struct RelayDownstreamMessage : public ILinkMessage
   {
     PathID_t pathid;
-    Encrypted X;
+    PacketSlice X;
     TunnelNonce Y;
+    /// pooled buffer we are decoding from, X shares its bytes
+    PacketRef packet;
+
     RelayDownstreamMessage();
     RelayDownstreamMessage(ILinkSession* from);
     ~RelayDownstreamMessage();
 
+    /// forget the last message and decode the next one from pkt
+    void
+    Reset(ILinkSession* from, const PacketRef& pkt);
+
     bool
     DecodeKey(llarp_buffer_t key, llarp_buffer_t* buf);
 
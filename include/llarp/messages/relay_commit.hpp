@@ -6,7 +6,7 @@
 #include <llarp/link_message.hpp>
 #include <llarp/path_types.hpp>
 #include <llarp/pow.hpp>
-#include <array>
+#include <vector>
 
 namespace llarp
 {
@@ -43,9 +43,51 @@ namespace llarp
     OnKey(dict_reader *r, llarp_buffer_t *buf);
   };
 
+  /// the records of a commit, one frame per hop all the same size, back to
+  /// back in one buffer. hop order starts at the first slot so dropping our
+  /// record and putting one on the end only touches that one slot
+  struct LR_CommitFrames
+  {
+    static constexpr size_t NumFrames = 8;
+    /// what the path builder puts in each frame
+    static constexpr size_t DefaultFrameSize =
+        256 + EncryptedFrame::OverheadSize;
+
+    LR_CommitFrames(size_t frameSize = DefaultFrameSize);
+
+    /// the idx-th frame in hop order
+    llarp_buffer_t
+    Frame(size_t idx);
+
+    size_t
+    FrameSize() const
+    {
+      return m_FrameSize;
+    }
+
+    void
+    Randomize();
+
+    /// drop the first frame and put a random one on the end
+    void
+    Rotate();
+
+    bool
+    BEncode(llarp_buffer_t *buf) const;
+
+    bool
+    BDecode(llarp_buffer_t *buf);
+
+   private:
+    size_t m_FrameSize;
+    /// slot the first hop's frame is in
+    size_t m_First = 0;
+    std::vector< byte_t > m_Data;
+  };
+
   struct LR_CommitMessage : public ILinkMessage
   {
-    std::array< EncryptedFrame, 8 > frames;
+    LR_CommitFrames frames;
 
     LR_CommitMessage() : ILinkMessage()
     {
@@ -2,9 +2,12 @@
 #define LLARP_NODEDB_HPP
 #include <llarp/common.h>
 #include <llarp/crypto.h>
+#include <llarp/threadpool.h>
 #include <llarp/router_contact.hpp>
 #include <llarp/router_id.hpp>
 
+#include <functional>
+
 /**
  * nodedb.hpp
  *
@@ -33,6 +36,31 @@ llarp_nodedb_set_dir(struct llarp_nodedb *n, const char *dir);
 ssize_t
 llarp_nodedb_load_dir(struct llarp_nodedb *n, const char *dir);
 
+/// load entire nodedb from fs skiplist at dir, reading and verifying rc files
+/// on worker, blocks until done
+/// uses the snapshot in dir instead if it is newer than the rc files and
+/// every rc in it verifies, removes it otherwise
+ssize_t
+llarp_nodedb_load_dir_parallel(struct llarp_nodedb *n, const char *dir,
+                               struct llarp_threadpool *worker);
+
+/// write rc put into the nodedb in batches on disk from now on
+void
+llarp_nodedb_set_disk_worker(struct llarp_nodedb *n,
+                             struct llarp_threadpool *disk);
+
+/// write every rc not yet on disk right now
+/// returns false if any failed to write
+bool
+llarp_nodedb_flush(struct llarp_nodedb *n);
+
+/// pack all loaded rc into one snapshot file in the nodedb dir
+/// so the next load can skip reading each rc file, they are still verified
+/// rc not yet on disk are written first
+/// the snapshot is removed again once the nodedb changes
+bool
+llarp_nodedb_write_snapshot(struct llarp_nodedb *n);
+
 /// store entire nodedb to fs skiplist at dir
 ssize_t
 llarp_nodedb_store_dir(struct llarp_nodedb *n, const char *dir);
@@ -63,7 +91,7 @@ llarp_nodedb_num_loaded(struct llarp_nodedb *n);
 /**
    put an rc into the node db
    overwrites with new contents if already present
-   flushes the single entry to disk
+   writes it to disk later on the disk worker if one is set, otherwise now
    returns true on success and false on error
  */
 bool
@@ -144,9 +172,26 @@ struct llarp_async_load_rc
 void
 llarp_nodedb_async_load_rc(struct llarp_async_load_rc *job);
 
+/// pick a router with addresses that isn't prev as a path hop
+/// routers are picked in proportion to their hop weight
 bool
 llarp_nodedb_select_random_hop(struct llarp_nodedb *n,
                                const llarp::RouterContact &prev,
                                llarp::RouterContact &result, size_t N);
 
+/// weight for picking a router as a path hop, 0 never picks it
+typedef std::function< uint64_t(const llarp::RouterContact &) >
+    llarp_nodedb_hop_weight_func;
+
+/// weigh every hop with func from now on, they all weigh 1 by default
+/// func is called with the nodedb locked
+void
+llarp_nodedb_set_hop_weight_func(struct llarp_nodedb *n,
+                                 llarp_nodedb_hop_weight_func func);
+
+/// weigh pk again after what func returns for it changed
+void
+llarp_nodedb_update_hop_weight(struct llarp_nodedb *n,
+                               const llarp::RouterID &pk);
+
 #endif
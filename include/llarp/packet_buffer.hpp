@@ -0,0 +1,210 @@
+#ifndef LLARP_PACKET_BUFFER_HPP
+#define LLARP_PACKET_BUFFER_HPP
+
+#include <llarp/bencode.h>
+#include <llarp/buffer.h>
+#include <llarp/link_layer.hpp>
+#include <llarp/threading.hpp>
+
+#include <atomic>
+#include <vector>
+
+namespace llarp
+{
+  struct PacketPool;
+
+  /// a link message sized buffer handed out by a PacketPool
+  struct PacketBuffer
+  {
+    static constexpr size_t MAX_SIZE = MAX_LINK_MSG_SIZE;
+
+    byte_t data[MAX_SIZE];
+    std::atomic< size_t > refs{0};
+    PacketPool* pool = nullptr;
+  };
+
+  /// shared handle on a PacketBuffer
+  /// the buffer goes back to its pool when the last handle lets go of it
+  struct PacketRef
+  {
+    PacketRef() = default;
+
+    PacketRef(const PacketRef& other) : m_Buf(other.m_Buf)
+    {
+      if(m_Buf)
+        ++m_Buf->refs;
+    }
+
+    PacketRef(PacketRef&& other) : m_Buf(other.m_Buf)
+    {
+      other.m_Buf = nullptr;
+    }
+
+    ~PacketRef()
+    {
+      reset();
+    }
+
+    PacketRef&
+    operator=(const PacketRef& other)
+    {
+      if(other.m_Buf)
+        ++other.m_Buf->refs;
+      reset();
+      m_Buf = other.m_Buf;
+      return *this;
+    }
+
+    PacketRef&
+    operator=(PacketRef&& other)
+    {
+      if(this != &other)
+      {
+        reset();
+        m_Buf       = other.m_Buf;
+        other.m_Buf = nullptr;
+      }
+      return *this;
+    }
+
+    explicit operator bool() const
+    {
+      return m_Buf != nullptr;
+    }
+
+    byte_t*
+    data() const
+    {
+      return m_Buf ? m_Buf->data : nullptr;
+    }
+
+    static constexpr size_t
+    capacity()
+    {
+      return PacketBuffer::MAX_SIZE;
+    }
+
+    /// return true if ptr points into our bytes
+    bool
+    Contains(const byte_t* ptr, size_t sz) const
+    {
+      return m_Buf && ptr >= m_Buf->data && sz <= capacity()
+          && ptr + sz <= m_Buf->data + capacity();
+    }
+
+    /// number of handles sharing the buffer, 0 if we have none
+    size_t
+    use_count() const
+    {
+      return m_Buf ? m_Buf->refs.load() : 0;
+    }
+
+    void
+    reset();
+
+   private:
+    friend struct PacketPool;
+
+    explicit PacketRef(PacketBuffer* buf) : m_Buf(buf)
+    {
+      ++m_Buf->refs;
+    }
+
+    PacketBuffer* m_Buf = nullptr;
+  };
+
+  /// thread safe free list of packet buffers
+  /// allocates when empty and keeps up to maxFree buffers around for reuse
+  struct PacketPool
+  {
+    PacketPool(size_t maxFree = 1024);
+    ~PacketPool();
+
+    /// the pool shared by the link layers
+    static PacketPool&
+    Global();
+
+    PacketRef
+    Get();
+
+    /// buffers currently handed out
+    size_t
+    InUse() const
+    {
+      return m_InUse;
+    }
+
+    /// heap allocations made over our lifetime
+    size_t
+    Allocations() const
+    {
+      return m_Allocations;
+    }
+
+   private:
+    friend struct PacketRef;
+
+    void
+    Put(PacketBuffer* buf);
+
+    util::Mutex m_Access;
+    std::vector< PacketBuffer* > m_Free;
+    const size_t m_MaxFree;
+    std::atomic< size_t > m_InUse;
+    std::atomic< size_t > m_Allocations;
+  };
+
+  /// a byte range inside a pooled packet buffer or borrowed from a caller
+  /// copying a slice shares the bytes instead of copying them
+  struct PacketSlice
+  {
+    /// keeps the bytes alive, empty when borrowed
+    PacketRef packet;
+    byte_t* base = nullptr;
+    size_t sz    = 0;
+
+    /// share bytes inside pkt
+    void
+    Share(const PacketRef& pkt, byte_t* ptr, size_t len);
+
+    /// point at bytes we do not own, the caller keeps them alive for as long
+    /// as we are used
+    void
+    Borrow(const llarp_buffer_t& buf);
+
+    /// copy bytes into a buffer from the global pool
+    bool
+    Copy(const llarp_buffer_t& buf);
+
+    void
+    Clear();
+
+    /// read a bencoded string, sharing the bytes if they are inside src
+    /// otherwise copying them
+    bool
+    BDecode(llarp_buffer_t* buf, const PacketRef& src);
+
+    bool
+    BDecode(llarp_buffer_t* buf)
+    {
+      return BDecode(buf, PacketRef());
+    }
+
+    bool
+    BEncode(llarp_buffer_t* buf) const
+    {
+      return bencode_write_bytestring(buf, base, sz);
+    }
+
+    llarp_buffer_t
+    Buffer() const;
+
+    size_t
+    size() const
+    {
+      return sz;
+    }
+  };
+}  // namespace llarp
+
+#endif
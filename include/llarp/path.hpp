@@ -7,6 +7,7 @@
 #include <llarp/dht.hpp>
 #include <llarp/messages/relay.hpp>
 #include <llarp/messages/relay_commit.hpp>
+#include <llarp/path_index.hpp>
 #include <llarp/path_types.hpp>
 #include <llarp/pathset.hpp>
 #include <llarp/pathbuilder.hpp>
@@ -16,9 +17,11 @@
 #include <llarp/service/Intro.hpp>
 #include <llarp/threading.hpp>
 
+#include <array>
 #include <functional>
 #include <list>
 #include <map>
+#include <queue>
 #include <unordered_map>
 #include <vector>
 
@@ -109,12 +112,12 @@ namespace llarp
 
       // handle data in upstream direction
       virtual bool
-      HandleUpstream(llarp_buffer_t X, const TunnelNonce& Y,
+      HandleUpstream(const PacketSlice& X, const TunnelNonce& Y,
                      llarp_router* r) = 0;
 
       // handle data in downstream direction
       virtual bool
-      HandleDownstream(llarp_buffer_t X, const TunnelNonce& Y,
+      HandleDownstream(const PacketSlice& X, const TunnelNonce& Y,
                        llarp_router* r) = 0;
 
      protected:
@@ -189,11 +192,117 @@ namespace llarp
 
       // handle data in upstream direction
       bool
-      HandleUpstream(llarp_buffer_t X, const TunnelNonce& Y, llarp_router* r);
+      HandleUpstream(const PacketSlice& X, const TunnelNonce& Y,
+                     llarp_router* r);
 
       // handle data in downstream direction
       bool
-      HandleDownstream(llarp_buffer_t X, const TunnelNonce& Y, llarp_router* r);
+      HandleDownstream(const PacketSlice& X, const TunnelNonce& Y,
+                       llarp_router* r);
+
+     private:
+      /// hand our crypto to the router's relay pipeline
+      bool
+      QueueRelay(const PacketSlice& X, const TunnelNonce& Y, bool upstream,
+                 llarp_router* r);
+    };
+
+    /// onion crypto for relayed messages done on the worker pool
+    /// messages that come in during a tick go out to the workers in batches
+    /// sharded by path id so each path keeps its order, and come back to the
+    /// logic thread one batch at a time
+    struct RelayPipeline
+    {
+      /// a relayed message waiting on its xchacha20
+      struct Job
+      {
+        TransitHopInfo info;
+        SharedSecret key;
+        /// nonce we got it with
+        TunnelNonce Y;
+        /// nonce the next hop gets it with
+        TunnelNonce nextY;
+        PacketSlice X;
+        bool upstream;
+      };
+
+      /// called on the logic thread with each message after its crypto
+      typedef std::function< void(Job&) > DeliverFunc;
+
+      static constexpr size_t Shards = 16;
+
+      RelayPipeline(DeliverFunc deliver);
+
+      /// where to do the crypto and where to deliver, before the first Queue
+      void
+      Init(llarp_crypto* crypto, llarp_threadpool* worker, llarp_logic* logic);
+
+      /// take a message from the logic thread, false if its shard is full
+      /// and we dropped it
+      bool
+      Queue(Job job);
+
+      /// messages queued or with the workers
+      size_t
+      Pending() const;
+
+      /// messages refused because their shard was full
+      uint64_t
+      Dropped() const
+      {
+        return m_Dropped;
+      }
+
+      /// most messages a worker takes in one go, 0 does the crypto inline
+      size_t batchSize = 64;
+      /// most ms a message waits for its batch to fill, 0 sends whatever
+      /// came in at the end of the tick
+      llarp_time_t latency = 0;
+      /// most messages a shard holds waiting for its batch to come back
+      /// from the workers, 0 for no limit
+      size_t maxPending = 1024;
+
+     private:
+      struct Shard
+      {
+        RelayPipeline* parent = nullptr;
+        std::vector< Job > pending;
+        /// owned by a worker while busy
+        std::vector< Job > working;
+        bool busy = false;
+      };
+
+      static void
+      HandleWork(void* user);
+
+      static void
+      HandleDone(void* user);
+
+      static void
+      HandleFlush(void* user);
+
+      static void
+      HandleFlushTimer(void* user, uint64_t orig, uint64_t left);
+
+      void
+      Flush();
+
+      void
+      Dispatch(Shard& shard);
+
+      void
+      Crypt(Job& job);
+
+      void
+      ScheduleFlush();
+
+      DeliverFunc m_Deliver;
+      llarp_crypto* m_Crypto     = nullptr;
+      llarp_threadpool* m_Worker = nullptr;
+      llarp_logic* m_Logic       = nullptr;
+      bool m_FlushScheduled      = false;
+      uint64_t m_Dropped         = 0;
+      std::array< Shard, Shards > m_Shards;
     };
 
     /// configuration for a single hop when building a path
@@ -238,6 +347,9 @@ namespace llarp
       llarp_time_t buildStarted;
       PathStatus _status;
 
+      /// rtt, loss and load seen on this path
+      PathQuality quality;
+
       Path(const std::vector< RouterContact >& routers);
 
       void
@@ -309,11 +421,13 @@ namespace llarp
 
       // handle data in upstream direction
       bool
-      HandleUpstream(llarp_buffer_t X, const TunnelNonce& Y, llarp_router* r);
+      HandleUpstream(const PacketSlice& X, const TunnelNonce& Y,
+                     llarp_router* r);
 
       // handle data in downstream direction
       bool
-      HandleDownstream(llarp_buffer_t X, const TunnelNonce& Y, llarp_router* r);
+      HandleDownstream(const PacketSlice& X, const TunnelNonce& Y,
+                       llarp_router* r);
 
       bool
       IsReady() const;
@@ -349,6 +463,8 @@ namespace llarp
       llarp_time_t m_LastRecvMessage     = 0;
       llarp_time_t m_LastLatencyTestTime = 0;
       uint64_t m_LastLatencyTestID       = 0;
+      /// the outstanding latency test was counted as lost
+      bool m_LatencyTestLost = false;
     };
 
     enum PathBuildStatus
@@ -358,6 +474,56 @@ namespace llarp
       ePathBuildReject
     };
 
+    /// how fast PathContext may start builds across all of its builders
+    struct PathBuildBudget
+    {
+      /// builds started per second on average, 0 for no limit
+      size_t rate = 4;
+      /// most builds started at once after a quiet spell
+      size_t burst = 8;
+      /// most of our paths building at once, 0 for no limit
+      size_t maxBuilding = 16;
+
+      uint64_t started  = 0;
+      uint64_t deferred = 0;
+
+      /// how many of want builds may start at now with building already
+      /// out, spends the rate for them
+      size_t
+      Take(llarp_time_t now, size_t want, size_t building);
+
+      /// hand back num taken builds that did not start
+      void
+      Refund(size_t num);
+
+     private:
+      llarp_time_t m_Last = 0;
+      /// 1000 per build we may start
+      uint64_t m_Credit = 0;
+    };
+
+    struct PathBuildStats
+    {
+      size_t builders = 0;
+      /// paths building right now
+      size_t building    = 0;
+      size_t established = 0;
+      /// builds we started
+      uint64_t started = 0;
+      /// builds wanted that the budget put off
+      uint64_t deferred = 0;
+      PathReadyStats ready;
+
+      friend std::ostream&
+      operator<<(std::ostream& out, const PathBuildStats& st)
+      {
+        return out << "builders=" << st.builders << " building=" << st.building
+                   << " established=" << st.established
+                   << " started=" << st.started << " deferred=" << st.deferred
+                   << " " << st.ready;
+      }
+    };
+
     struct PathContext
     {
       PathContext(llarp_router* router);
@@ -368,10 +534,16 @@ namespace llarp
       ExpirePaths();
 
       /// called from router tick function
-      /// builds all paths we need to build at current tick
+      /// starts as many of the paths our builders want as the budget allows,
+      /// taking turns between builders
       void
       BuildPaths();
 
+      PathBuildStats
+      BuildStats() const;
+
+      PathBuildBudget buildBudget;
+
       /// called from router tick function
       void
       TickPaths();
@@ -403,6 +575,15 @@ namespace llarp
       IHopHandler*
       GetByDownstream(const RouterID& id, const PathID_t& path);
 
+      TransitHop*
+      GetTransitHop(const TransitHopInfo& info);
+
+      RelayPipeline&
+      Relay()
+      {
+        return m_Relay;
+      }
+
       PathSet*
       GetLocalPathSet(const PathID_t& id);
 
@@ -410,8 +591,7 @@ namespace llarp
       GetHandler(const PathID_t& id);
 
       bool
-      ForwardLRCM(const RouterID& nextHop,
-                  const std::array< EncryptedFrame, 8 >& frames);
+      ForwardLRCM(const RouterID& nextHop, LR_CommitFrames frames);
 
       bool
       HopIsUs(const PubKey& k) const;
@@ -431,9 +611,17 @@ namespace llarp
       void
       RemovePathSet(PathSet* set);
 
-      typedef std::multimap< PathID_t, TransitHop* > TransitHopsMap_t;
+      typedef PathIndex< TransitHop > TransitHopIndex_t;
 
-      typedef std::pair< util::Mutex, TransitHopsMap_t > SyncTransitMap_t;
+      // transit hops by expire time, soonest on top
+      typedef std::priority_queue<
+          std::pair< llarp_time_t, TransitHop* >,
+          std::vector< std::pair< llarp_time_t, TransitHop* > >,
+          std::greater< std::pair< llarp_time_t, TransitHop* > > >
+          TransitExpiryHeap_t;
+
+      typedef std::pair< util::Mutex, TransitExpiryHeap_t >
+          SyncTransitExpiryHeap_t;
 
       // maps path id -> pathset owner of path
       typedef std::map< PathID_t, PathSet* > OwnedPathsMap_t;
@@ -460,11 +648,21 @@ namespace llarp
 
      private:
       llarp_router* m_Router;
-      SyncTransitMap_t m_TransitPaths;
-      SyncTransitMap_t m_Paths;
+      TransitHopIndex_t m_TransitPaths;
+      SyncTransitExpiryHeap_t m_TransitExpiry;
+      /// hops gone from m_TransitPaths that readers may still hold, freed
+      /// next tick, guarded by m_TransitExpiry's mutex
+      std::vector< TransitHop* > m_RetiredHops;
       SyncOwnedPathsMap_t m_OurPaths;
       std::list< Builder* > m_PathBuilders;
+      /// which builder goes first next time we build
+      size_t m_NextBuilder = 0;
       bool m_AllowTransit;
+      RelayPipeline m_Relay;
+
+      /// send on or handle a transit message once its crypto is done
+      void
+      HandleRelayed(RelayPipeline::Job& job);
     };
   }  // namespace path
 }  // namespace llarp
@@ -0,0 +1,288 @@
+#ifndef LLARP_PATH_INDEX_HPP
+#define LLARP_PATH_INDEX_HPP
+
+#include <llarp/path_types.hpp>
+#include <llarp/threading.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace llarp
+{
+  namespace path
+  {
+    /// open addressing hash index from path id to Value_t*
+    /// a path id can map to more than one value
+    ///
+    /// writers serialize on a mutex and bump a sequence number around each
+    /// change, readers take no lock and retry if a write happened under them.
+    /// growing publishes a new table and keeps the old one around until we
+    /// are destroyed so readers still on it never touch freed memory, with
+    /// capacity doubling that never adds up to more than the live table.
+    ///
+    /// values are not owned. a reader can find a value, or run a check on
+    /// it, while it is being removed, so whoever removes one has to keep it
+    /// alive until every reader that could have seen it is done, PathContext
+    /// waits a whole tick. checks should only read fields that do not change
+    /// after insertion.
+    template < typename Value_t >
+    struct PathIndex
+    {
+      static_assert(PATHIDSIZE == 16, "path id must be 2 words");
+
+      PathIndex(size_t capacity = 64) : m_Seq(0), m_Size(0)
+      {
+        size_t cap = 16;
+        while(cap < capacity)
+          cap <<= 1;
+        m_Tables.emplace_back(new Table(cap));
+        m_Table.store(m_Tables.back().get(), std::memory_order_release);
+      }
+
+      /// find a value under id that passes check
+      template < typename Check_t >
+      Value_t*
+      Find(const PathID_t& id, Check_t check) const
+      {
+        Key k(id);
+        for(;;)
+        {
+          uint64_t seq = m_Seq.load(std::memory_order_acquire);
+          if(seq & 1)
+          {
+            std::this_thread::yield();
+            continue;
+          }
+          const Table* t = m_Table.load(std::memory_order_acquire);
+          Value_t* found = nullptr;
+          size_t idx     = t->Home(k);
+          Value_t* val   = t->slots[idx].val.load(std::memory_order_relaxed);
+          while(val)
+          {
+            if(t->slots[idx].Matches(k) && check(val))
+            {
+              found = val;
+              break;
+            }
+            idx = (idx + 1) & t->mask;
+            val = t->slots[idx].val.load(std::memory_order_relaxed);
+          }
+          std::atomic_thread_fence(std::memory_order_acquire);
+          if(m_Seq.load(std::memory_order_relaxed) == seq)
+            return found;
+        }
+      }
+
+      Value_t*
+      Find(const PathID_t& id) const
+      {
+        return Find(id, [](const Value_t*) -> bool { return true; });
+      }
+
+      void
+      Insert(const PathID_t& id, Value_t* val)
+      {
+        Key k(id);
+        util::Lock lock(m_Access);
+        Table* t = m_Table.load(std::memory_order_relaxed);
+        if((m_Size + 1) * 2 > t->mask + 1)
+          t = Grow(t);
+        BeginWrite();
+        t->Put(k, val);
+        ++m_Size;
+        EndWrite();
+      }
+
+      /// remove val from under id
+      /// return false if it was not there
+      bool
+      Remove(const PathID_t& id, const Value_t* val)
+      {
+        Key k(id);
+        util::Lock lock(m_Access);
+        Table* t   = m_Table.load(std::memory_order_relaxed);
+        size_t idx = t->Home(k);
+        for(;;)
+        {
+          Value_t* cur = t->slots[idx].val.load(std::memory_order_relaxed);
+          if(cur == nullptr)
+            return false;
+          if(cur == val && t->slots[idx].Matches(k))
+            break;
+          idx = (idx + 1) & t->mask;
+        }
+        BeginWrite();
+        t->Erase(idx);
+        --m_Size;
+        EndWrite();
+        return true;
+      }
+
+      /// number of entries
+      size_t
+      Size() const
+      {
+        return m_Size;
+      }
+
+      /// slots in the live table
+      size_t
+      Capacity() const
+      {
+        return m_Table.load(std::memory_order_acquire)->mask + 1;
+      }
+
+     private:
+      struct Key
+      {
+        uint64_t w[2];
+
+        explicit Key(const PathID_t& id)
+        {
+          memcpy(w, id.data(), sizeof(w));
+        }
+
+        Key(uint64_t w0, uint64_t w1) : w{w0, w1}
+        {
+        }
+
+        size_t
+        Hash() const
+        {
+          uint64_t h = (w[0] ^ w[1]) * 0x9E3779B97F4A7C15ULL;
+          return h ^ (h >> 32);
+        }
+      };
+
+      /// words are atomic so a reader racing a writer reads garbage it will
+      /// throw away instead of tearing
+      struct Slot
+      {
+        std::atomic< uint64_t > w[2];
+        std::atomic< Value_t* > val;
+
+        Slot()
+        {
+          w[0].store(0, std::memory_order_relaxed);
+          w[1].store(0, std::memory_order_relaxed);
+          val.store(nullptr, std::memory_order_relaxed);
+        }
+
+        Key
+        GetKey() const
+        {
+          return Key(w[0].load(std::memory_order_relaxed),
+                     w[1].load(std::memory_order_relaxed));
+        }
+
+        bool
+        Matches(const Key& k) const
+        {
+          return w[0].load(std::memory_order_relaxed) == k.w[0]
+              && w[1].load(std::memory_order_relaxed) == k.w[1];
+        }
+
+        void
+        Set(uint64_t w0, uint64_t w1, Value_t* v)
+        {
+          w[0].store(w0, std::memory_order_relaxed);
+          w[1].store(w1, std::memory_order_relaxed);
+          val.store(v, std::memory_order_relaxed);
+        }
+      };
+
+      struct Table
+      {
+        const size_t mask;
+        std::unique_ptr< Slot[] > slots;
+
+        explicit Table(size_t cap) : mask(cap - 1), slots(new Slot[cap])
+        {
+        }
+
+        size_t
+        Home(const Key& k) const
+        {
+          return k.Hash() & mask;
+        }
+
+        void
+        Put(const Key& k, Value_t* val)
+        {
+          size_t idx = Home(k);
+          while(slots[idx].val.load(std::memory_order_relaxed))
+            idx = (idx + 1) & mask;
+          slots[idx].Set(k.w[0], k.w[1], val);
+        }
+
+        /// backward shift deletion so we never need tombstones
+        void
+        Erase(size_t hole)
+        {
+          size_t idx = hole;
+          for(;;)
+          {
+            idx        = (idx + 1) & mask;
+            Slot& slot = slots[idx];
+            if(slot.val.load(std::memory_order_relaxed) == nullptr)
+              break;
+            Key k       = slot.GetKey();
+            size_t home = Home(k);
+            // leave it if its home is cyclically in (hole, idx]
+            if(hole <= idx ? (hole < home && home <= idx)
+                           : (hole < home || home <= idx))
+              continue;
+            slots[hole].Set(k.w[0], k.w[1],
+                            slot.val.load(std::memory_order_relaxed));
+            hole = idx;
+          }
+          slots[hole].Set(0, 0, nullptr);
+        }
+      };
+
+      void
+      BeginWrite()
+      {
+        m_Seq.store(m_Seq.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+      }
+
+      void
+      EndWrite()
+      {
+        m_Seq.store(m_Seq.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+      }
+
+      /// copy everything into a table twice the size and publish it
+      Table*
+      Grow(const Table* old)
+      {
+        Table* t = new Table((old->mask + 1) * 2);
+        for(size_t idx = 0; idx <= old->mask; ++idx)
+        {
+          const Slot& slot = old->slots[idx];
+          Value_t* val     = slot.val.load(std::memory_order_relaxed);
+          if(val)
+            t->Put(slot.GetKey(), val);
+        }
+        m_Tables.emplace_back(t);
+        m_Table.store(t, std::memory_order_release);
+        return t;
+      }
+
+      std::atomic< uint64_t > m_Seq;
+      std::atomic< Table* > m_Table;
+      size_t m_Size;
+      util::Mutex m_Access;
+      /// live table last
+      std::vector< std::unique_ptr< Table > > m_Tables;
+    };
+  }  // namespace path
+}  // namespace llarp
+
+#endif
@@ -26,7 +26,8 @@ namespace llarp
       virtual bool
       ShouldBuildMore() const;
 
-      void
+      /// start building a path, false if we could not pick its hops
+      bool
       BuildOne();
 
       void
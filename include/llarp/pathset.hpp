@@ -10,6 +10,7 @@
 #include <llarp/service/lookup.hpp>
 #include <llarp/dht/messages/all.hpp>
 #include <map>
+#include <ostream>
 #include <tuple>
 
 namespace llarp
@@ -31,6 +32,90 @@ namespace llarp
     // forward declare
     struct Path;
 
+    /// how well one of our paths carries traffic, fed by its latency probes,
+    /// drops and what we send on it
+    struct PathQuality
+    {
+      /// until we have an rtt sample
+      static constexpr llarp_time_t DefaultRTT = 1000;
+      /// bytes in flight that we reckon double how long a message takes
+      static constexpr double InflightScale = 64 * 1024;
+
+      /// smoothed rtt and its variation in ms, rfc 6298 style
+      llarp_time_t srtt   = 0;
+      llarp_time_t rttvar = 0;
+      /// share of recent messages lost, 0 to 1
+      double loss = 0.0;
+
+      void
+      SampleRTT(llarp_time_t rtt);
+
+      /// we sent sz bytes at now
+      void
+      Sent(size_t sz, llarp_time_t now);
+
+      /// something we sent never made it
+      void
+      Lost();
+
+      /// bytes we reckon are still on their way, each send fades out over
+      /// about an rtt
+      double
+      InflightBytes(llarp_time_t now) const;
+
+      /// ms we expect a message to take, without what is in flight
+      double
+      BaseCost() const;
+
+      /// ms we expect a message sent at now to take
+      double
+      Cost(llarp_time_t now) const;
+
+     private:
+      double m_Inflight       = 0.0;
+      llarp_time_t m_LastSent = 0;
+    };
+
+    /// how long path sets wait for their first established path, from when
+    /// they are made or lose their last one
+    struct PathReadyStats
+    {
+      uint64_t samples   = 0;
+      llarp_time_t total = 0;
+      llarp_time_t max   = 0;
+
+      void
+      Add(llarp_time_t dlt)
+      {
+        ++samples;
+        total += dlt;
+        if(dlt > max)
+          max = dlt;
+      }
+
+      void
+      Add(const PathReadyStats& other)
+      {
+        samples += other.samples;
+        total += other.total;
+        if(other.max > max)
+          max = other.max;
+      }
+
+      llarp_time_t
+      Mean() const
+      {
+        return samples ? total / samples : 0;
+      }
+
+      friend std::ostream&
+      operator<<(std::ostream& out, const PathReadyStats& st)
+      {
+        return out << "first path samples=" << st.samples
+                   << " mean=" << st.Mean() << "ms max=" << st.max << "ms";
+      }
+    };
+
     /// a set of paths owned by an entity
     struct PathSet
     {
@@ -64,6 +149,39 @@ namespace llarp
       virtual bool
       ShouldBuildMore() const;
 
+      /// how many more paths we want building at now, counting paths due
+      /// for replacement as gone
+      size_t
+      NumPathsWanted(llarp_time_t now) const;
+
+      /// true if p is established and close enough to expiry that we want
+      /// its replacement building
+      bool
+      ShouldReplace(const Path* p, llarp_time_t now) const;
+
+      /// call when one of our paths is established at now
+      void
+      PathEstablished(llarp_time_t now);
+
+      const PathReadyStats&
+      ReadyStats() const
+      {
+        return m_ReadyStats;
+      }
+
+      /// established paths kept on top of the ones we maintain so one can
+      /// go without anything waiting on a build
+      size_t numSpare = 1;
+
+      /// ms before expiry we may start replacing a path, each path picks
+      /// its own point in this window so paths built together are not
+      /// replaced together
+      llarp_time_t rebuildAhead = 60 * 1000;
+
+      /// how many paths to one router PickPathByRouter spreads traffic
+      /// over, 1 pins it to the best one and 0 uses them all
+      size_t stripeWidth = 2;
+
       /// return true if we should publish a new hidden service descriptor
       virtual bool
       ShouldPublishDescriptors(llarp_time_t now) const
@@ -98,9 +216,16 @@ namespace llarp
       Path*
       PickRandomEstablishedPath() const;
 
+      /// the ready path to router with the best smoothed rtt and loss
       Path*
       GetPathByRouter(const RouterID& router) const;
 
+      /// the ready path to router to send on at now, out of the
+      /// stripeWidth best by rtt and loss whichever expects to deliver
+      /// soonest with what we already put in flight on it
+      Path*
+      PickPathByRouter(const RouterID& router, llarp_time_t now) const;
+
       Path*
       GetNewestPathByRouter(const RouterID& router) const;
 
@@ -126,6 +251,9 @@ namespace llarp
       typedef std::map< PathInfo_t, Path* > PathMap_t;
       size_t m_NumPaths;
       PathMap_t m_Paths;
+      /// when we started waiting on an established path, 0 if we have one
+      llarp_time_t m_WaitingSince;
+      PathReadyStats m_ReadyStats;
     };
 
   }  // namespace path
@@ -0,0 +1,287 @@
+#ifndef LLARP_PENDING_QUEUE_HPP
+#define LLARP_PENDING_QUEUE_HPP
+
+#include <llarp/time.h>
+
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <ostream>
+#include <unordered_map>
+
+namespace llarp
+{
+  namespace util
+  {
+    /// bytes held by every PendingQueues pointing at it, those may live on
+    /// different logic threads
+    struct PendingBudget
+    {
+      /// most bytes held across all queues, 0 for no limit
+      size_t limit = 16 * 1024 * 1024;
+
+      bool
+      Take(size_t sz)
+      {
+        size_t was = used.load();
+        do
+        {
+          if(limit && was + sz > limit)
+            return false;
+        } while(!used.compare_exchange_weak(was, was + sz));
+        return true;
+      }
+
+      void
+      Give(size_t sz)
+      {
+        used -= sz;
+      }
+
+      size_t
+      Used() const
+      {
+        return used.load();
+      }
+
+     private:
+      std::atomic< size_t > used{0};
+    };
+
+    /// how much a PendingQueues holds per destination and for how long
+    struct PendingQueueLimits
+    {
+      /// most bytes held for one destination, 0 for no limit
+      size_t bytesPerDest = 256 * 1024;
+      /// codel target, ms the head may wait before the queue counts as
+      /// standing, 0 never drops for waiting
+      llarp_time_t targetMs = 500;
+      /// codel interval, ms the queue may stand before we shed its head
+      llarp_time_t intervalMs = 1000;
+    };
+
+    struct PendingQueueStats
+    {
+      /// destinations with a queue
+      size_t queues = 0;
+      /// entries held right now
+      size_t depth = 0;
+      /// bytes held right now
+      size_t bytes = 0;
+      uint64_t queued = 0;
+      uint64_t sent = 0;
+      /// refused because a budget was spent
+      uint64_t droppedFull = 0;
+      /// shed from the head for waiting too long
+      uint64_t droppedStale = 0;
+      /// thrown away along with their destination
+      uint64_t discarded = 0;
+
+      friend std::ostream&
+      operator<<(std::ostream& out, const PendingQueueStats& st)
+      {
+        return out << "queues=" << st.queues << " depth=" << st.depth
+                   << " bytes=" << st.bytes << " queued=" << st.queued
+                   << " sent=" << st.sent << " full=" << st.droppedFull
+                   << " stale=" << st.droppedStale
+                   << " discarded=" << st.discarded;
+      }
+    };
+
+    /// per destination queues of traffic waiting on a session or path
+    ///
+    /// each destination gets a byte budget and all of them draw from one
+    /// PendingBudget. new entries are refused when either is spent. entries
+    /// that wait longer than the target for a whole interval are shed from
+    /// the head by the codel control law, checked whenever the destination
+    /// is touched. not thread safe, the budget is.
+    template < typename Key_t, typename Val_t,
+               typename Hash_t = typename Key_t::Hash >
+    struct PendingQueues
+    {
+      PendingQueues(PendingBudget* budget = nullptr) : m_Budget(budget)
+      {
+      }
+
+      ~PendingQueues()
+      {
+        Clear();
+      }
+
+      PendingQueueLimits limits;
+
+      bool
+      Has(const Key_t& k) const
+      {
+        return m_Queues.find(k) != m_Queues.end();
+      }
+
+      /// queue sz bytes worth of val for k, making the queue if there is
+      /// none, returns false if we dropped it
+      bool
+      Put(const Key_t& k, Val_t val, size_t sz, llarp_time_t now)
+      {
+        auto& q = m_Queues[k];
+        Shed(q, now);
+        if(limits.bytesPerDest && q.bytes + sz > limits.bytesPerDest)
+        {
+          ++m_Stats.droppedFull;
+          return false;
+        }
+        if(m_Budget && !m_Budget->Take(sz))
+        {
+          ++m_Stats.droppedFull;
+          return false;
+        }
+        q.entries.emplace_back(std::move(val), sz, now);
+        q.bytes += sz;
+        ++m_Stats.depth;
+        m_Stats.bytes += sz;
+        ++m_Stats.queued;
+        return true;
+      }
+
+      /// call visit in order on everything for k that is still fresh at now
+      /// and forget k, returns how many we visited
+      template < typename Visit >
+      size_t
+      Drain(const Key_t& k, llarp_time_t now, Visit visit)
+      {
+        auto itr = m_Queues.find(k);
+        if(itr == m_Queues.end())
+          return 0;
+        auto& q     = itr->second;
+        size_t sent = 0;
+        while(q.entries.size())
+        {
+          if(Stale(q, now))
+          {
+            ++m_Stats.droppedStale;
+          }
+          else
+          {
+            visit(q.entries.front().val);
+            ++sent;
+          }
+          Pop(q);
+        }
+        m_Stats.sent += sent;
+        m_Queues.erase(itr);
+        return sent;
+      }
+
+      /// forget k and everything queued for it, returns how many entries
+      size_t
+      Discard(const Key_t& k)
+      {
+        auto itr = m_Queues.find(k);
+        if(itr == m_Queues.end())
+          return 0;
+        const size_t num = itr->second.entries.size();
+        while(itr->second.entries.size())
+          Pop(itr->second);
+        m_Stats.discarded += num;
+        m_Queues.erase(itr);
+        return num;
+      }
+
+      void
+      Clear()
+      {
+        while(m_Queues.size())
+          Discard(m_Queues.begin()->first);
+      }
+
+      PendingQueueStats
+      Stats() const
+      {
+        PendingQueueStats st = m_Stats;
+        st.queues            = m_Queues.size();
+        return st;
+      }
+
+     private:
+      struct Entry
+      {
+        Entry(Val_t v, size_t s, llarp_time_t t)
+            : val(std::move(v)), sz(s), enqueued(t)
+        {
+        }
+
+        Val_t val;
+        size_t sz;
+        llarp_time_t enqueued;
+      };
+
+      struct Queue
+      {
+        std::deque< Entry > entries;
+        size_t bytes = 0;
+        /// when the current head's wait above target becomes an interval
+        llarp_time_t firstAbove = 0;
+        llarp_time_t dropNext   = 0;
+        size_t dropCount        = 0;
+        bool dropping           = false;
+      };
+
+      /// codel on the head of q, true if it should go
+      bool
+      Stale(Queue& q, llarp_time_t now)
+      {
+        const auto& head = q.entries.front();
+        if(limits.targetMs == 0 || now < head.enqueued + limits.targetMs)
+        {
+          q.firstAbove = 0;
+          q.dropping   = false;
+          return false;
+        }
+        if(q.firstAbove == 0)
+          q.firstAbove = head.enqueued + limits.targetMs + limits.intervalMs;
+        if(now < q.firstAbove)
+          return false;
+        if(!q.dropping)
+        {
+          // drop as if we had been watching since it started standing
+          q.dropping  = true;
+          q.dropCount = 0;
+          q.dropNext  = q.firstAbove;
+        }
+        if(now < q.dropNext)
+          return false;
+        ++q.dropCount;
+        q.dropNext +=
+            llarp_time_t(limits.intervalMs / std::sqrt(double(q.dropCount)));
+        return true;
+      }
+
+      /// drop stale entries off the head of q
+      void
+      Shed(Queue& q, llarp_time_t now)
+      {
+        while(q.entries.size() && Stale(q, now))
+        {
+          ++m_Stats.droppedStale;
+          Pop(q);
+        }
+      }
+
+      void
+      Pop(Queue& q)
+      {
+        const size_t sz = q.entries.front().sz;
+        q.entries.pop_front();
+        q.bytes -= sz;
+        --m_Stats.depth;
+        m_Stats.bytes -= sz;
+        if(m_Budget)
+          m_Budget->Give(sz);
+      }
+
+      PendingBudget* m_Budget;
+      PendingQueueStats m_Stats;
+      std::unordered_map< Key_t, Queue, Hash_t > m_Queues;
+    };
+  }  // namespace util
+}  // namespace llarp
+
+#endif
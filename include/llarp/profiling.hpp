@@ -6,16 +6,22 @@
 #include <llarp/path.hpp>
 
 #include <map>
+#include <set>
+#include <vector>
 
 namespace llarp
 {
   struct RouterProfile : public IBEncodeMessage
   {
-    static constexpr size_t MaxSize = 256;
-    uint64_t connectTimeoutCount    = 0;
-    uint64_t connectGoodCount       = 0;
-    uint64_t pathSuccessCount       = 0;
-    uint64_t pathFailCount          = 0;
+    /// per hop latency in ms that neither helps nor hurts the hop weight
+    static constexpr uint64_t ReferenceLatency = 100;
+    static constexpr size_t MaxSize            = 256;
+    uint64_t connectTimeoutCount               = 0;
+    uint64_t connectGoodCount                  = 0;
+    uint64_t pathSuccessCount                  = 0;
+    uint64_t pathFailCount                     = 0;
+    /// smoothed share of path latency in ms, 0 if we never measured it
+    uint64_t latency = 0;
 
     RouterProfile() : IBEncodeMessage(){};
     ~RouterProfile(){};
@@ -28,6 +34,10 @@ namespace llarp
 
     bool
     IsGood(uint64_t chances) const;
+
+    /// how much to favour this router as a path hop, at least 1
+    uint64_t
+    HopWeight(uint64_t chances) const;
   };
 
   struct Profiling : public IBEncodeMessage
@@ -40,6 +50,10 @@ namespace llarp
     bool
     IsBad(const RouterID& r, uint64_t chances = 8);
 
+    /// weight for picking r as a path hop
+    uint64_t
+    HopWeight(const RouterID& r, uint64_t chances = 8);
+
     void
     MarkSuccess(const RouterID& r);
 
@@ -64,11 +78,20 @@ namespace llarp
     void
     MarkPathSuccess(path::Path* p);
 
+    /// give each hop of p an even share of its measured latency
+    void
+    MarkPathLatency(path::Path* p, llarp_time_t latency);
+
+    /// routers whose profile changed since the last call
+    std::vector< RouterID >
+    TakeChanged();
+
    private:
     typedef llarp::util::Lock lock_t;
     typedef llarp::util::Mutex mtx_t;
     mtx_t m_ProfilesMutex;
     std::map< RouterID, RouterProfile > m_Profiles;
+    std::set< RouterID > m_Changed;
   };
 
 }  // namespace llarp
@@ -134,8 +134,17 @@ namespace llarp
       bool
       DecodeKey(llarp_buffer_t key, llarp_buffer_t* buf);
 
+      /// signature, proof of work and timestamps
       bool
       Verify(llarp_crypto* crypto) const;
+
+      /// just the signature
+      bool
+      VerifySignature(llarp_crypto* crypto) const;
+
+      /// proof of work and timestamps for when the signature is known good
+      bool
+      VerifyContents(llarp_crypto* crypto) const;
     };
   }  // namespace service
 }  // namespace llarp
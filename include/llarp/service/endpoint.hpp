@@ -2,6 +2,7 @@
 #define LLARP_SERVICE_ENDPOINT_HPP
 #include <llarp/codel.hpp>
 #include <llarp/pathbuilder.hpp>
+#include <llarp/pending_queue.hpp>
 #include <llarp/service/Identity.hpp>
 #include <llarp/service/handler.hpp>
 #include <llarp/service/protocol.hpp>
@@ -167,7 +168,15 @@ namespace llarp
       bool
       CheckPathIsDead(path::Path* p, llarp_time_t latency);
 
-      typedef std::queue< PendingBuffer > PendingBufferQueue;
+      typedef llarp::util::PendingQueues< Address, PendingBuffer >
+          PendingBufferQueue;
+
+      /// traffic waiting on a path to its service
+      llarp::util::PendingQueueStats
+      PendingTrafficStats() const
+      {
+        return m_PendingTraffic.Stats();
+      }
 
       struct SendContext
       {
@@ -305,6 +314,12 @@ namespace llarp
       bool
       GetSenderFor(const ConvoTag& remote, ServiceInfo& si) const;
 
+      void
+      PutPeerTakesMACFor(const ConvoTag& remote);
+
+      bool
+      PeerTakesMACFor(const ConvoTag& remote) const;
+
       void
       PutIntroFor(const ConvoTag& remote, const Introduction& intro);
 
@@ -385,8 +400,7 @@ namespace llarp
       std::string m_Name;
       std::string m_NetNS;
 
-      std::unordered_map< Address, PendingBufferQueue, Address::Hash >
-          m_PendingTraffic;
+      PendingBufferQueue m_PendingTraffic;
 
       std::unordered_map< Address, std::unique_ptr< OutboundContext >,
                           Address::Hash >
@@ -446,6 +460,8 @@ namespace llarp
         Introduction intro;
         llarp_time_t lastUsed = 0;
         uint64_t seqno        = 0;
+        /// remote sent ProtocolMessageVersionMAC
+        bool takesMAC = false;
       };
 
       /// sessions
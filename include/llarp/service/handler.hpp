@@ -30,6 +30,13 @@ namespace llarp
       virtual bool
       GetSenderFor(const ConvoTag& remote, ServiceInfo& si) const = 0;
 
+      /// remote takes frames with a mac instead of a signature
+      virtual void
+      PutPeerTakesMACFor(const ConvoTag& remote) = 0;
+
+      virtual bool
+      PeerTakesMACFor(const ConvoTag& remote) const = 0;
+
       virtual void
       PutIntroFor(const ConvoTag& remote, const Introduction& intro) = 0;
 
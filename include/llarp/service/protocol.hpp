@@ -22,6 +22,10 @@ namespace llarp
     constexpr ProtocolType eProtocolText    = 0UL;
     constexpr ProtocolType eProtocolTraffic = 1UL;
 
+    /// ProtocolMessage version from which the sender takes frames on an
+    /// established convo with M instead of Z, older versions ignore it
+    constexpr uint64_t ProtocolMessageVersionMAC = 1;
+
     /// inner message
     struct ProtocolMessage : public IBEncodeMessage
     {
@@ -56,6 +60,9 @@ namespace llarp
     {
       llarp::PQCipherBlock C;
       llarp::Encrypted D;
+      /// hmac keyed from the session key, set instead of Z once both ends
+      /// have the session key and the remote sent ProtocolMessageVersionMAC
+      llarp::ShortHash M;
       llarp::KeyExchangeNonce N;
       llarp::Signature Z;
       llarp::service::ConvoTag T;
@@ -64,6 +71,7 @@ namespace llarp
           : llarp::routing::IMessage()
           , C(other.C)
           , D(other.D)
+          , M(other.M)
           , N(other.N)
           , Z(other.Z)
           , T(other.T)
@@ -94,6 +102,12 @@ namespace llarp
       EncryptAndSign(llarp_crypto* c, const ProtocolMessage& msg,
                      const byte_t* sharedkey, const Identity& localIdent);
 
+      /// encrypt msg and authenticate the frame with sessionKey instead of
+      /// signing it, for frames on an established convo
+      bool
+      EncryptAndMAC(llarp_crypto* c, const ProtocolMessage& msg,
+                    const byte_t* sessionKey);
+
       bool
       AsyncDecryptAndVerify(llarp_logic* logic, llarp_crypto* c,
                             const PathID_t& srcpath, llarp_threadpool* worker,
@@ -113,8 +127,21 @@ namespace llarp
       bool
       Verify(llarp_crypto* c, const ServiceInfo& from) const;
 
+      bool
+      VerifyMAC(llarp_crypto* c, const byte_t* sessionKey) const;
+
       bool
       HandleMessage(llarp::routing::IMessageHandler* h, llarp_router* r) const;
+
+     private:
+      /// put msg encrypted with key into D
+      bool
+      Encrypt(llarp_crypto* c, const ProtocolMessage& msg, const byte_t* key);
+
+      /// hmac of this frame with M zeroed, keyed from sessionKey
+      bool
+      CalculateMAC(llarp_crypto* c, const byte_t* sessionKey,
+                   ShortHash& mac) const;
     };
   }  // namespace service
 }  // namespace llarp
@@ -1,11 +1,18 @@
 #ifndef LLARP_THREADPOOL_H
 #define LLARP_THREADPOOL_H
+#include <stddef.h>
+#include <stdint.h>
 
 struct llarp_threadpool;
 
 struct llarp_threadpool *
 llarp_init_threadpool(int workers, const char *name);
 
+/// worker N is pinned to cpus[N % numcpus]
+struct llarp_threadpool *
+llarp_init_pinned_threadpool(int workers, const char *name, const int *cpus,
+                             size_t numcpus);
+
 /// for single process mode
 struct llarp_threadpool *
 llarp_init_same_process_threadpool();
@@ -45,6 +52,25 @@ struct llarp_thread_job
 void
 llarp_threadpool_tick(struct llarp_threadpool *tp);
 
+/// job queue counters for single process mode, sample twice to get rates
+struct llarp_threadpool_stats
+{
+  /// jobs queued since creation
+  uint64_t enqueued;
+  /// jobs run since creation
+  uint64_t dequeued;
+  /// jobs that did not fit in the lock free ring
+  uint64_t overflowed;
+  /// jobs waiting right now
+  uint64_t depth;
+  /// highest depth seen at the start of a tick
+  uint64_t maxdepth;
+};
+
+void
+llarp_threadpool_get_stats(struct llarp_threadpool *tp,
+                           struct llarp_threadpool_stats *stats);
+
 void
 llarp_threadpool_queue_job(struct llarp_threadpool *tp,
                            struct llarp_thread_job j);
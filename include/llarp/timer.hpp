@@ -0,0 +1,249 @@
+#ifndef LLARP_TIMER_HPP
+#define LLARP_TIMER_HPP
+#include <llarp/time.h>
+#include <llarp/timer.h>
+
+#include <array>
+#include <functional>
+
+namespace llarp
+{
+  struct timer
+  {
+    void* user;
+    uint64_t called_at;
+    uint64_t started;
+    uint64_t timeout;
+    llarp_timer_handler_func func;
+    bool done;
+    bool canceled;
+
+    uint32_t id = 0;
+    /// intrusive linkage for the wheel slot we are in
+    timer* prev  = nullptr;
+    timer* next  = nullptr;
+    timer** slot = nullptr;
+
+    timer(uint64_t ms = 0, void* _user = nullptr,
+          llarp_timer_handler_func _func = nullptr)
+        : user(_user)
+        , called_at(0)
+        , started(llarp_time_now_ms())
+        , timeout(ms)
+        , func(_func)
+        , done(false)
+        , canceled(false)
+    {
+    }
+
+    ~timer()
+    {
+    }
+
+    uint64_t
+    expires() const
+    {
+      return started + timeout;
+    }
+
+    void
+    exec();
+
+    static void
+    call(void* user)
+    {
+      static_cast< timer* >(user)->exec();
+    }
+
+    bool
+    operator<(const timer& other) const
+    {
+      return expires() < other.expires();
+    }
+  };
+
+  /// hierarchical timing wheel with 1ms resolution
+  /// 4 levels of 256 slots each covers ~49 days of timeout
+  /// insert, unlink and expire are O(1) amortized
+  /// does not own the timers it holds and is not thread safe
+  struct TimerWheel
+  {
+    static constexpr size_t Levels     = 4;
+    static constexpr size_t SlotBits   = 8;
+    static constexpr size_t Slots      = 1 << SlotBits;
+    static constexpr uint64_t SlotMask = Slots - 1;
+
+    TimerWheel(uint64_t now = llarp_time_now_ms()) : m_Now(now)
+    {
+      Clear();
+    }
+
+    /// forget about all timers without touching them
+    void
+    Clear()
+    {
+      for(auto& level : m_Wheel)
+        level.fill(nullptr);
+      m_Expired = nullptr;
+      m_Size    = 0;
+      m_Level0  = 0;
+    }
+
+    /// current position of the wheel
+    uint64_t
+    Now() const
+    {
+      return m_Now;
+    }
+
+    /// number of timers held
+    size_t
+    Size() const
+    {
+      return m_Size;
+    }
+
+    /// put a timer into the wheel, it will expire on the first Advance to a
+    /// time at or after its expiration time
+    void
+    Insert(timer* t)
+    {
+      ++m_Size;
+      if(t->expires() <= m_Now)
+        Link(t, &m_Expired);
+      else
+        Place(t);
+    }
+
+    /// take a timer out of the wheel
+    void
+    Unlink(timer* t)
+    {
+      if(t->slot == nullptr)
+        return;
+      if(t->slot != &m_Expired && IsLevel0(t->slot))
+        --m_Level0;
+      if(t->prev)
+        t->prev->next = t->next;
+      else
+        *t->slot = t->next;
+      if(t->next)
+        t->next->prev = t->prev;
+      t->prev = nullptr;
+      t->next = nullptr;
+      t->slot = nullptr;
+      --m_Size;
+    }
+
+    /// make timer expire on the next Advance regardless of its timeout
+    void
+    ExpireNow(timer* t)
+    {
+      Unlink(t);
+      ++m_Size;
+      Link(t, &m_Expired);
+    }
+
+    /// move the wheel forward to now, calling visit on every timer that has
+    /// expired after unlinking it
+    void
+    Advance(uint64_t now, std::function< void(timer*) > visit)
+    {
+      Drain(&m_Expired, visit);
+      while(m_Now < now)
+      {
+        if(m_Level0 == 0)
+        {
+          // nothing in the lowest level, skip to the next cascade point
+          uint64_t skip = m_Now | SlotMask;
+          if(skip >= now)
+          {
+            m_Now = now;
+            break;
+          }
+          m_Now = skip;
+        }
+        ++m_Now;
+        Cascade();
+        Drain(&m_Wheel[0][m_Now & SlotMask], visit);
+      }
+    }
+
+   private:
+    typedef std::array< timer*, Slots > Level_t;
+
+    bool
+    IsLevel0(timer** slot) const
+    {
+      return slot >= m_Wheel[0].data() && slot < m_Wheel[0].data() + Slots;
+    }
+
+    void
+    Link(timer* t, timer** slot)
+    {
+      t->slot = slot;
+      t->prev = nullptr;
+      t->next = *slot;
+      if(t->next)
+        t->next->prev = t;
+      *slot = t;
+    }
+
+    void
+    Place(timer* t)
+    {
+      const uint64_t when  = t->expires();
+      const uint64_t delta = when > m_Now ? when - m_Now : 0;
+      size_t level         = 0;
+      while(level + 1 < Levels && (delta >> (SlotBits * (level + 1))))
+        ++level;
+      if(level == 0)
+        ++m_Level0;
+      Link(t, &m_Wheel[level][(when >> (SlotBits * level)) & SlotMask]);
+    }
+
+    /// redistribute higher levels into lower ones when the lower level wraps
+    void
+    Cascade()
+    {
+      size_t level = 1;
+      while(level < Levels
+            && (m_Now & ((uint64_t(1) << (SlotBits * level)) - 1)) == 0)
+        ++level;
+      // cascade from the highest level that wrapped down to level 1
+      while(--level > 0)
+      {
+        const size_t idx    = (m_Now >> (SlotBits * level)) & SlotMask;
+        timer* t            = m_Wheel[level][idx];
+        m_Wheel[level][idx] = nullptr;
+        while(t)
+        {
+          timer* next = t->next;
+          Place(t);
+          t = next;
+        }
+      }
+    }
+
+    void
+    Drain(timer** slot, std::function< void(timer*) >& visit)
+    {
+      while(*slot)
+      {
+        timer* t = *slot;
+        Unlink(t);
+        visit(t);
+      }
+    }
+
+    std::array< Level_t, Levels > m_Wheel;
+    /// timers that are due on the next advance
+    timer* m_Expired;
+    uint64_t m_Now;
+    size_t m_Size;
+    /// number of timers in level 0, lets us skip empty stretches
+    size_t m_Level0;
+  };
+}  // namespace llarp
+
+#endif
@@ -64,10 +64,24 @@ namespace llarp
     {
       if(!strcmp(key, "worker-threads") && !ctx->singleThreaded)
       {
+        // worker-threads=N or worker-threads=N:cpu,cpu,... to pin workers
         int workers = atoi(val);
+        std::vector< int > cpus;
+        const char *pin = strchr(val, ':');
+        while(pin && *pin)
+        {
+          ++pin;
+          if(*pin >= '0' && *pin <= '9')
+            cpus.push_back(atoi(pin));
+          pin = strchr(pin, ',');
+        }
         if(workers > 0 && ctx->worker == nullptr)
         {
-          ctx->worker = llarp_init_threadpool(workers, "llarp-worker");
+          if(cpus.size())
+            ctx->worker = llarp_init_pinned_threadpool(
+                workers, "llarp-worker", cpus.data(), cpus.size());
+          else
+            ctx->worker = llarp_init_threadpool(workers, "llarp-worker");
         }
       }
       else if(!strcmp(key, "net-threads"))
@@ -85,6 +99,10 @@ namespace llarp
       {
         ctx->nodedb_dir = val;
       }
+      if(!strcmp(key, "snapshot"))
+      {
+        ctx->nodedb_snapshot = atoi(val) > 0;
+      }
     }
   }
 
@@ -100,7 +118,8 @@ namespace llarp
       return 0;
     }
     // llarp::LogInfo("nodedb_dir [", nodedb_dir, "] configured!");
-    ssize_t loaded = llarp_nodedb_load_dir(nodedb, nodedb_dir.c_str());
+    ssize_t loaded = llarp_nodedb_load_dir_parallel(
+        nodedb, nodedb_dir.c_str(), singleThreaded ? nullptr : worker);
     llarp::LogInfo("nodedb_dir loaded ", loaded, " RCs from [", nodedb_dir,
                    "]");
     if(loaded < 0)
@@ -117,11 +136,7 @@ namespace llarp
   {
     llarp::LogInfo(LLARP_VERSION, " ", LLARP_RELEASE_MOTTO);
     llarp::LogInfo("starting up");
-    if(!this->LoadDatabase())
-      return -1;
-    llarp_ev_loop_alloc(&mainloop);
-
-    // ensure worker thread pool
+    // ensure worker thread pool, we load the nodedb on it
     if(!worker && !singleThreaded)
       worker = llarp_init_threadpool(2, "llarp-worker");
     else if(singleThreaded)
@@ -129,6 +144,12 @@ namespace llarp
       llarp::LogInfo("running in single threaded mode");
       worker = llarp_init_same_process_threadpool();
     }
+    if(!this->LoadDatabase())
+      return -1;
+    llarp_ev_loop_alloc(&mainloop);
+    // other net threads bind our link addresses too
+    if(num_nethreads > 1)
+      llarp_ev_loop_set_reuseport(mainloop, true);
     // ensure netio thread
     if(singleThreaded)
     {
@@ -147,6 +168,21 @@ namespace llarp
     // set nodedb, load our RC, establish DHT
     llarp_run_router(router, nodedb);
 
+    for(int idx = 1; idx < num_nethreads; ++idx)
+    {
+      llarp_ev_loop *loop = nullptr;
+      llarp_ev_loop_alloc(&loop);
+      if(router->MirrorInboundLinks(loop) == 0)
+      {
+        llarp_ev_loop_free(&loop);
+        break;
+      }
+      netloops.push_back(loop);
+    }
+    if(netloops.size())
+      llarp::LogInfo("reading inbound links on ", netloops.size() + 1,
+                     " net threads");
+
     return 0;  // success
   }
 
@@ -165,6 +201,10 @@ namespace llarp
       }
     }
 
+    // extra net threads only read datagrams, the links run on the mainloop
+    for(auto loop : netloops)
+      netio_threads.emplace_back([loop]() { llarp_ev_loop_run(loop, nullptr); });
+
     // run net io thread
     llarp::LogInfo("running mainloop");
     llarp_ev_loop_run_single_process(mainloop, worker, logic);
@@ -198,6 +238,19 @@ namespace llarp
   void
   Context::Close()
   {
+    // net threads hand datagrams to our links so stop them first
+    for(auto loop : netloops)
+      llarp_ev_loop_stop(loop);
+    for(auto &t : netio_threads)
+    {
+      llarp::LogDebug("join netio thread");
+      t.join();
+    }
+    netio_threads.clear();
+    for(auto &loop : netloops)
+      llarp_ev_loop_free(&loop);
+    netloops.clear();
+
     llarp::LogDebug("stop router");
     if(router)
       llarp_stop_router(router);
@@ -221,6 +274,9 @@ namespace llarp
     llarp::LogDebug("free workers");
     llarp_free_threadpool(&worker);
 
+    if(nodedb && nodedb_snapshot && llarp_nodedb_write_snapshot(nodedb))
+      llarp::LogInfo("wrote nodedb snapshot");
+
     llarp::LogDebug("free nodedb");
     llarp_nodedb_free(&nodedb);
 
@@ -232,14 +288,6 @@ namespace llarp
 
     llarp::LogDebug("free logic");
     llarp_free_logic(&logic);
-
-    for(auto &t : netio_threads)
-    {
-      llarp::LogDebug("join netio thread");
-      t.join();
-    }
-
-    netio_threads.clear();
   }
 
   bool
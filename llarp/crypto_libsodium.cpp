@@ -1,10 +1,21 @@
 #include <assert.h>
 #include <llarp/crypto.h>
 #include <sodium.h>
+#include <sodium/crypto_core_hchacha20.h>
+#include <sodium/crypto_stream_chacha20.h>
 #include <sodium/crypto_stream_xchacha20.h>
 #include <llarp/crypto.hpp>
 #include "mem.hpp"
 
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
 namespace llarp
 {
   namespace sodium
@@ -16,6 +27,52 @@ namespace llarp
           == 0;
     }
 
+    /// layers we derive subkeys for at once
+    static constexpr size_t MaxLayers = 8;
+    /// bytes of the buffer that go through every layer at once, a multiple
+    /// of the chacha20 block so the counters line up
+    static constexpr size_t LayerChunk = 1024;
+
+    static bool
+    xchacha20_layers(llarp_buffer_t buff, const byte_t *const *k,
+                     const byte_t *const *n, size_t layers)
+    {
+      // xchacha20 is hchacha20 for a subkey then chacha20 on the last 8
+      // bytes of the nonce. we xor every layer's keystream into a chunk
+      // that stays in cache so the buffer goes through memory once, the
+      // keystream itself is libsodium's simd chacha20
+      byte_t subkeys[MaxLayers][32];
+      byte_t chunk[LayerChunk];
+      bool result = true;
+      while(layers && result)
+      {
+        const size_t num = std::min(layers, MaxLayers);
+        for(size_t idx = 0; idx < num; ++idx)
+          crypto_core_hchacha20(subkeys[idx], n[idx], k[idx], nullptr);
+        for(size_t off = 0; off < buff.sz && result; off += LayerChunk)
+        {
+          const size_t sz    = std::min(LayerChunk, buff.sz - off);
+          const uint64_t ic  = off / 64;
+          const byte_t *from = buff.base + off;
+          for(size_t idx = 0; idx < num; ++idx)
+          {
+            if(crypto_stream_chacha20_xor_ic(chunk, from, sz, n[idx] + 16, ic,
+                                             subkeys[idx])
+               != 0)
+              result = false;
+            from = chunk;
+          }
+          memcpy(buff.base + off, chunk, sz);
+        }
+        k += num;
+        n += num;
+        layers -= num;
+      }
+      sodium_memzero(subkeys, sizeof(subkeys));
+      sodium_memzero(chunk, sizeof(chunk));
+      return result;
+    }
+
     static bool
     dh(uint8_t *out, const uint8_t *client_pk, const uint8_t *server_pk,
        const uint8_t *themPub, const uint8_t *usSec)
@@ -95,16 +152,123 @@ namespace llarp
       return crypto_sign_verify_detached(sig, buff.base, buff.sz, pub) != -1;
     }
 
+    /// bumped in the child after fork so every thread's rng reseeds there
+    /// instead of repeating what the parent draws
+    static std::atomic< uint64_t > forks{0};
+
     static void
-    randomize(llarp_buffer_t buff)
+    on_fork_child()
     {
-      randombytes((unsigned char *)buff.base, buff.sz);
+      ++forks;
     }
 
-    static inline void
+    /// buffered csprng for one thread, fast key erasure over chacha20: each
+    /// refill makes a buffer of keystream whose first 32 bytes key the next
+    /// refill, and what we hand out is wiped from the buffer
+    struct ThreadRNG
+    {
+      static constexpr size_t KeySize = 32;
+      static constexpr size_t BufSize = 2048;
+      /// output between mixing in fresh seed from the system rng
+      static constexpr uint64_t ReseedBytes = 1024 * 1024;
+
+      ~ThreadRNG()
+      {
+        sodium_memzero(buf, sizeof(buf));
+      }
+
+      void
+      Fill(byte_t *out, size_t sz)
+      {
+        if(!seeded || seenForks != forks.load() || sinceSeed >= ReseedBytes)
+          Reseed();
+        sinceSeed += sz;
+        if(sz > BufSize - KeySize)
+        {
+          // too big to buffer, stream it with a key of its own
+          byte_t key[KeySize];
+          Take(key, KeySize);
+          crypto_stream_chacha20(out, sz, nonce, key);
+          sodium_memzero(key, KeySize);
+          return;
+        }
+        Take(out, sz);
+      }
+
+     private:
+      void
+      Take(byte_t *out, size_t sz)
+      {
+        while(sz)
+        {
+          if(avail == 0)
+            Refill();
+          const size_t n = std::min(sz, avail);
+          byte_t *ptr    = buf + BufSize - avail;
+          memcpy(out, ptr, n);
+          sodium_memzero(ptr, n);
+          avail -= n;
+          out += n;
+          sz -= n;
+        }
+      }
+
+      void
+      Refill()
+      {
+        byte_t key[KeySize];
+        memcpy(key, buf, KeySize);
+        crypto_stream_chacha20(buf, BufSize, nonce, key);
+        sodium_memzero(key, KeySize);
+        avail = BufSize - KeySize;
+      }
+
+      /// mix system entropy into the key and drop whatever is buffered
+      void
+      Reseed()
+      {
+#ifndef _WIN32
+        static std::once_flag atfork;
+        std::call_once(atfork, []() {
+          pthread_atfork(nullptr, nullptr, &on_fork_child);
+        });
+#endif
+        byte_t seed[KeySize];
+        randombytes_buf(seed, KeySize);
+        for(size_t idx = 0; idx < KeySize; ++idx)
+          buf[idx] ^= seed[idx];
+        sodium_memzero(seed, KeySize);
+        Refill();
+        seenForks = forks.load();
+        sinceSeed = 0;
+        seeded    = true;
+      }
+
+      /// a fresh key every refill, the nonce never needs to change
+      static constexpr byte_t nonce[8] = {0};
+
+      byte_t buf[BufSize] = {0};
+      /// bytes at the end of buf not handed out yet
+      size_t avail       = 0;
+      uint64_t sinceSeed = 0;
+      uint64_t seenForks = 0;
+      bool seeded        = false;
+    };
+
+    constexpr byte_t ThreadRNG::nonce[8];
+
+    static thread_local ThreadRNG rng;
+
+    static void
     randbytes(void *ptr, size_t sz)
     {
-      randombytes((unsigned char *)ptr, sz);
+      rng.Fill(static_cast< byte_t * >(ptr), sz);
+    }
+
+    static void
+    randomize(llarp_buffer_t buff)
+    {
+      randbytes(buff.base, buff.sz);
     }
 
     static void
@@ -171,6 +335,7 @@ llarp_crypto_init(struct llarp_crypto *c)
   else
     ntru_init(0);
   c->xchacha20           = llarp::sodium::xchacha20;
+  c->xchacha20_layers    = llarp::sodium::xchacha20_layers;
   c->dh_client           = llarp::sodium::dh_client;
   c->dh_server           = llarp::sodium::dh_server;
   c->transport_dh_client = llarp::sodium::dh_client;
@@ -196,6 +361,12 @@ uint64_t
 llarp_randint()
 {
   uint64_t i;
-  randombytes((byte_t *)&i, sizeof(i));
+  llarp::sodium::randbytes(&i, sizeof(i));
   return i;
 }
+
+void
+llarp_randbytes(void *ptr, size_t sz)
+{
+  llarp::sodium::randbytes(ptr, sz);
+}
@@ -115,19 +115,7 @@ namespace llarp
       if(ctx->services)
       {
         // expire intro sets
-        auto now    = llarp_time_now_ms();
-        auto &nodes = ctx->services->nodes;
-        auto itr    = nodes.begin();
-        while(itr != nodes.end())
-        {
-          if(itr->second.introset.IsExpired(now))
-          {
-            llarp::LogDebug("introset expired ", itr->second.introset.A.Addr());
-            itr = nodes.erase(itr);
-          }
-          else
-            ++itr;
-        }
+        ctx->services->Expire(llarp_time_now_ms());
       }
       ctx->ScheduleCleanupTimer();
     }
@@ -143,46 +131,7 @@ namespace llarp
         const service::Tag &tag, size_t max,
         const std::set< service::IntroSet > &exclude)
     {
-      std::set< service::IntroSet > found;
-      auto &nodes = services->nodes;
-      if(nodes.size() == 0)
-      {
-        return found;
-      }
-      auto itr = nodes.begin();
-      // start at random middle point
-      auto start = llarp_randint() % nodes.size();
-      std::advance(itr, start);
-      auto end            = itr;
-      std::string tagname = tag.ToString();
-      while(itr != nodes.end())
-      {
-        if(itr->second.introset.topic.ToString() == tagname)
-        {
-          if(exclude.count(itr->second.introset) == 0)
-          {
-            found.insert(itr->second.introset);
-            if(found.size() == max)
-              return found;
-          }
-        }
-        ++itr;
-      }
-      itr = nodes.begin();
-      while(itr != end)
-      {
-        if(itr->second.introset.topic.ToString() == tagname)
-        {
-          if(exclude.count(itr->second.introset) == 0)
-          {
-            found.insert(itr->second.introset);
-            if(found.size() == max)
-              return found;
-          }
-        }
-        ++itr;
-      }
-      return found;
+      return services->FindRandomWithTagExcluding(tag, max, exclude);
     }
 
     void
@@ -205,7 +154,7 @@ namespace llarp
         {
           // we know it
           replies.emplace_back(new GotRouterMessage(
-              requester, txid, {nodes->nodes[target].rc}, false));
+              requester, txid, {nodes->GetNode(target)->rc}, false));
         }
         else if(recursive)  // are we doing a recursive lookup?
         {
@@ -241,10 +190,7 @@ namespace llarp
     Context::GetIntroSetByServiceAddress(
         const llarp::service::Address &addr) const
     {
-      auto itr = services->nodes.find(addr.data());
-      if(itr == services->nodes.end())
-        return nullptr;
-      return &itr->second.introset;
+      return services->Get(addr.data());
     }
 
     void
@@ -266,7 +212,8 @@ namespace llarp
       router   = r;
       ourKey   = us;
       nodes    = new Bucket< RCNode >(ourKey);
-      services = new Bucket< ISNode >(ourKey);
+      services = new IntroSetStore(ourKey, maxIntroSets);
+      verifier.Init(&r->crypto, r->tp, r->logic);
       llarp::LogDebug("intialize dht with key ", ourKey);
       // start exploring
       llarp_logic_call_later(
@@ -294,6 +241,29 @@ namespace llarp
       }
     }
 
+    void
+    Context::SendReplies(const IMessage *request,
+                         std::vector< std::unique_ptr< IMessage > > &replies)
+    {
+      if(replies.size() == 0)
+        return;
+      if(request->From == ourKey)
+      {
+        // relayed from a path we are the end of
+        llarp::routing::DHTMessage reply;
+        reply.M = std::move(replies);
+        auto path = router->paths.GetByUpstream(router->pubkey(),
+                                                request->pathID);
+        if(path == nullptr || !path->SendRoutingMessage(&reply, router))
+          llarp::LogWarn("could not reply to dht request on path ",
+                         request->pathID);
+        return;
+      }
+      llarp::DHTImmeidateMessage reply;
+      reply.msgs = std::move(replies);
+      router->SendToOrQueue(request->From, &reply);
+    }
+
     bool
     Context::RelayRequestForPath(const llarp::PathID_t &id, const IMessage *msg)
     {
@@ -327,7 +297,7 @@ namespace llarp
       bool
       Validate(const service::IntroSet &value) const
       {
-        if(!value.Verify(parent->Crypto()))
+        if(!parent->verifier.Verify(value))
         {
           llarp::LogWarn("Got invalid introset from service lookup");
           return false;
@@ -551,7 +521,7 @@ namespace llarp
       bool
       Validate(const service::IntroSet &introset) const
       {
-        if(!introset.Verify(parent->Crypto()))
+        if(!parent->verifier.Verify(introset))
         {
           llarp::LogWarn("got invalid introset from tag lookup");
           return false;
@@ -665,7 +635,7 @@ namespace llarp
       bool
       Validate(const RouterContact &rc) const
       {
-        if(!rc.VerifySignature(parent->Crypto()))
+        if(!parent->verifier.Verify(rc))
         {
           llarp::LogWarn("rc has invalid signature from lookup result");
           return false;
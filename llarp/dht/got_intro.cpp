@@ -23,38 +23,48 @@ namespace llarp
         llarp_dht_context *ctx,
         std::vector< std::unique_ptr< IMessage > > &replies) const
     {
-      auto &dht   = ctx->impl;
-      auto crypto = &dht.router->crypto;
+      auto &dht = ctx->impl;
+      TXOwner owner(From, T);
+      Verifier::Job job;
+      job.introsets = I;
+      job.result    = [&dht, owner](Verifier::Job &j) {
+        HandleVerified(dht, owner, j.valid, j.introsets);
+      };
+      dht.verifier.Queue(std::move(job));
+      return true;
+    }
 
-      for(const auto &introset : I)
+    void
+    GotIntroMessage::HandleVerified(
+        Context &dht, const TXOwner &owner, bool valid,
+        const std::vector< llarp::service::IntroSet > &introsets)
+    {
+      if(!valid)
       {
-        if(!introset.Verify(crypto))
-        {
-          llarp::LogWarn(
-              "Invalid introset while handling direct GotIntro "
-              "from ",
-              From);
-          return false;
-        }
-        else
-          dht.services->PutNode(introset);
+        llarp::LogWarn(
+            "Invalid introset while handling direct GotIntro "
+            "from ",
+            owner.node);
+        return;
       }
-      TXOwner owner(From, T);
+      for(const auto &introset : introsets)
+        dht.services->Put(introset);
       auto tagLookup = dht.pendingTagLookups.GetPendingLookupFrom(owner);
       if(tagLookup)
       {
-        dht.pendingTagLookups.Inform(owner, tagLookup->target, I);
-        return true;
+        dht.pendingTagLookups.Inform(owner, tagLookup->target, introsets);
+        return;
       }
       auto serviceLookup =
           dht.pendingIntrosetLookups.GetPendingLookupFrom(owner);
       if(serviceLookup)
       {
-        dht.pendingIntrosetLookups.Inform(owner, serviceLookup->target, I);
-        return true;
+        dht.pendingIntrosetLookups.Inform(owner, serviceLookup->target,
+                                          introsets);
+        return;
       }
-      llarp::LogError("no pending TX for GIM from ", From, " txid=", T);
-      return false;
+      llarp::LogError("no pending TX for GIM from ", owner.node,
+                      " txid=", owner.txid);
     }
 
     bool
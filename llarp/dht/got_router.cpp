@@ -95,10 +95,26 @@ namespace llarp
         llarp::LogWarn("Unwarrented GRM from ", From, " txid=", txid);
         return false;
       }
-      if(R.size() == 1)
-        dht.pendingRouterLookups.Found(owner, R[0].pubkey, R);
-      else
+      if(R.size() != 1)
+      {
         dht.pendingRouterLookups.NotFound(owner);
+        return true;
+      }
+      // check the signature on the worker pool first so the lookup's own
+      // check hits the cache
+      Verifier::Job job;
+      job.rcs    = R;
+      job.result = [&dht, owner](Verifier::Job &j) {
+        // it may have timed out in the meantime
+        if(!dht.pendingRouterLookups.HasPendingLookupFrom(owner))
+          return;
+        if(!j.valid)
+          llarp::LogWarn("rc has invalid signature from ", owner.node);
+        dht.pendingRouterLookups.Found(
+            owner, j.rcs[0].pubkey,
+            j.valid ? j.rcs : std::vector< RouterContact >{});
+      };
+      dht.verifier.Queue(std::move(job));
       return true;
     }
   }  // namespace dht
@@ -0,0 +1,158 @@
+#include <llarp/crypto.h>
+#include <llarp/dht/introset_store.hpp>
+#include "logger.hpp"
+
+namespace llarp
+{
+  namespace dht
+  {
+    IntroSetStore::IntroSetStore(const Key_t& us, size_t max)
+        : maxIntroSets(max), m_Us(us)
+    {
+    }
+
+    service::Tag
+    IntroSetStore::TopicOf(const service::Tag& tag)
+    {
+      return service::Tag(tag.ToString());
+    }
+
+    bool
+    IntroSetStore::Put(const service::IntroSet& introset)
+    {
+      Key_t addr;
+      if(!introset.A.CalculateAddress(addr))
+        return false;
+      const llarp_time_t expiresAt = introset.GetNewestIntroExpiration();
+      auto itr                     = m_IntroSets.find(addr);
+      if(itr != m_IntroSets.end())
+      {
+        Entry& entry = itr->second;
+        if(!entry.introset.OtherIsNewer(introset))
+          return true;
+        entry.introset = introset;
+        auto topic     = TopicOf(introset.topic);
+        if(topic != entry.topic)
+        {
+          RemoveFromTag(entry);
+          entry.topic = topic;
+          AddToTag(addr, entry);
+        }
+        if(expiresAt != entry.expiresAt)
+        {
+          entry.expiresAt = expiresAt;
+          m_Expiry.emplace(expiresAt, addr);
+        }
+        return true;
+      }
+
+      const Key_t dist = addr ^ m_Us;
+      if(maxIntroSets && m_IntroSets.size() >= maxIntroSets)
+      {
+        auto farthest = m_ByDistance.rbegin();
+        if(farthest == m_ByDistance.rend() || !(dist < *farthest))
+          return false;
+        const Key_t evict = *farthest ^ m_Us;
+        llarp::LogDebug("introset store full, dropping ", evict);
+        Remove(evict);
+      }
+      Entry& entry    = m_IntroSets[addr];
+      entry.introset  = introset;
+      entry.topic     = TopicOf(introset.topic);
+      entry.expiresAt = expiresAt;
+      AddToTag(addr, entry);
+      m_Expiry.emplace(expiresAt, addr);
+      m_ByDistance.insert(dist);
+      return true;
+    }
+
+    const service::IntroSet*
+    IntroSetStore::Get(const Key_t& addr) const
+    {
+      auto itr = m_IntroSets.find(addr);
+      if(itr == m_IntroSets.end())
+        return nullptr;
+      return &itr->second.introset;
+    }
+
+    size_t
+    IntroSetStore::Expire(llarp_time_t now)
+    {
+      size_t expired = 0;
+      while(m_Expiry.size() && m_Expiry.top().first <= now)
+      {
+        const Expiry_t top = m_Expiry.top();
+        m_Expiry.pop();
+        auto itr = m_IntroSets.find(top.second);
+        // skip entries that were replaced or evicted since
+        if(itr == m_IntroSets.end() || itr->second.expiresAt != top.first)
+          continue;
+        llarp::LogDebug("introset expired ", itr->second.introset.A.Addr());
+        Remove(top.second);
+        ++expired;
+      }
+      return expired;
+    }
+
+    std::set< service::IntroSet >
+    IntroSetStore::FindRandomWithTagExcluding(
+        const service::Tag& tag, size_t max,
+        const std::set< service::IntroSet >& exclude) const
+    {
+      std::set< service::IntroSet > found;
+      auto itr = m_ByTag.find(TopicOf(tag));
+      if(itr == m_ByTag.end() || max == 0)
+        return found;
+      const auto& addrs = itr->second;
+      // start at random middle point
+      const size_t start = llarp_randint() % addrs.size();
+      for(size_t idx = 0; idx < addrs.size(); ++idx)
+      {
+        const auto& introset =
+            m_IntroSets.at(addrs[(start + idx) % addrs.size()]).introset;
+        if(exclude.count(introset))
+          continue;
+        found.insert(introset);
+        if(found.size() == max)
+          break;
+      }
+      return found;
+    }
+
+    void
+    IntroSetStore::Remove(const Key_t& addr)
+    {
+      auto itr = m_IntroSets.find(addr);
+      if(itr == m_IntroSets.end())
+        return;
+      RemoveFromTag(itr->second);
+      m_ByDistance.erase(addr ^ m_Us);
+      m_IntroSets.erase(itr);
+    }
+
+    void
+    IntroSetStore::AddToTag(const Key_t& addr, Entry& entry)
+    {
+      auto& addrs   = m_ByTag[entry.topic];
+      entry.tagSlot = addrs.size();
+      addrs.push_back(addr);
+    }
+
+    void
+    IntroSetStore::RemoveFromTag(const Entry& entry)
+    {
+      auto itr = m_ByTag.find(entry.topic);
+      if(itr == m_ByTag.end())
+        return;
+      auto& addrs = itr->second;
+      // move the last one into our slot
+      const Key_t moved    = addrs.back();
+      addrs[entry.tagSlot] = moved;
+      addrs.pop_back();
+      if(addrs.empty())
+        m_ByTag.erase(itr);
+      else if(entry.tagSlot < addrs.size())
+        m_IntroSets[moved].tagSlot = entry.tagSlot;
+    }
+  }  // namespace dht
+}  // namespace llarp
@@ -50,26 +50,45 @@ namespace llarp
         return false;
       }
       auto &dht = ctx->impl;
-      if(!I.Verify(&dht.router->crypto))
+      // the signature is checked on the worker pool, we carry on from
+      // HandleVerified once it is back
+      auto self = std::make_shared< PublishIntroMessage >(*this);
+      Verifier::Job job;
+      job.introsets.push_back(I);
+      job.result = [&dht, self](Verifier::Job &j) {
+        std::vector< std::unique_ptr< IMessage > > later;
+        self->HandleVerified(dht, j.valid, later);
+        dht.SendReplies(self.get(), later);
+      };
+      dht.verifier.Queue(std::move(job));
+      return true;
+    }
+
+    void
+    PublishIntroMessage::HandleVerified(
+        Context &dht, bool valid,
+        std::vector< std::unique_ptr< IMessage > > &replies) const
+    {
+      if(!valid)
       {
         llarp::LogWarn("invalid introset: ", I);
         // don't propogate or store
         replies.emplace_back(new GotIntroMessage({}, txID));
-        return true;
+        return;
       }
       if(I.W && !I.W->IsValid(dht.router->crypto.shorthash))
       {
         llarp::LogWarn("proof of work not good enough for IntroSet");
         // don't propogate or store
         replies.emplace_back(new GotIntroMessage({}, txID));
-        return true;
+        return;
       }
       llarp::dht::Key_t addr;
       if(!I.A.CalculateAddress(addr))
       {
         llarp::LogWarn(
             "failed to calculate hidden service address for PubIntro message");
-        return false;
+        return;
       }
       auto now = llarp_time_now_ms();
       now += llarp::service::MAX_INTROSET_TIME_DELTA;
@@ -77,9 +96,9 @@ namespace llarp
       {
         // don't propogate or store
         replies.emplace_back(new GotIntroMessage({}, txID));
-        return true;
+        return;
       }
-      dht.services->PutNode(I);
+      dht.services->Put(I);
       replies.emplace_back(new GotIntroMessage({I}, txID));
       Key_t peer;
       std::set< Key_t > exclude;
@@ -91,7 +110,6 @@ namespace llarp
       {
         dht.PropagateIntroSetTo(From, txID, I, peer, S - 1, exclude);
       }
-      return true;
     }
 
     bool
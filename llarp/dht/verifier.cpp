@@ -0,0 +1,167 @@
+#include <llarp/buffer.hpp>
+#include <llarp/dht/verifier.hpp>
+
+namespace llarp
+{
+  namespace dht
+  {
+    template < typename Blob_t, size_t MaxSize >
+    static bool
+    HashBlob(llarp_crypto* crypto, const Blob_t& blob, ShortHash& h)
+    {
+      byte_t tmp[MaxSize];
+      auto buf = llarp::StackBuffer< decltype(tmp) >(tmp);
+      if(!blob.BEncode(&buf))
+        return false;
+      buf.sz  = buf.cur - buf.base;
+      buf.cur = buf.base;
+      return crypto->shorthash(h.data(), buf);
+    }
+
+    void
+    Verifier::Init(llarp_crypto* crypto, llarp_threadpool* worker,
+                   llarp_logic* logic)
+    {
+      m_Crypto = crypto;
+      m_Worker = worker;
+      m_Logic  = logic;
+    }
+
+    size_t
+    Verifier::Pending() const
+    {
+      return m_Pending.size() + m_InFlight;
+    }
+
+    size_t
+    Verifier::CacheSize() const
+    {
+      util::Lock lock(m_CacheAccess);
+      return m_Good.size();
+    }
+
+    bool
+    Verifier::HasGoodSignature(const ShortHash& h)
+    {
+      util::Lock lock(m_CacheAccess);
+      return m_Good.find(h) != m_Good.end();
+    }
+
+    void
+    Verifier::PutGoodSignature(const ShortHash& h)
+    {
+      if(cacheSize == 0)
+        return;
+      util::Lock lock(m_CacheAccess);
+      if(!m_Good.insert(h).second)
+        return;
+      m_GoodOrder.push_back(h);
+      while(m_GoodOrder.size() > cacheSize)
+      {
+        m_Good.erase(m_GoodOrder.front());
+        m_GoodOrder.pop_front();
+      }
+    }
+
+    bool
+    Verifier::Verify(const service::IntroSet& introset)
+    {
+      ShortHash h;
+      if(!HashBlob< service::IntroSet, service::MAX_INTROSET_SIZE >(
+             m_Crypto, introset, h))
+        return false;
+      if(!HasGoodSignature(h))
+      {
+        if(!introset.VerifySignature(m_Crypto))
+          return false;
+        PutGoodSignature(h);
+      }
+      // these depend on the time so they are checked every time
+      return introset.VerifyContents(m_Crypto);
+    }
+
+    bool
+    Verifier::Verify(const RouterContact& rc)
+    {
+      ShortHash h;
+      if(!HashBlob< RouterContact, MAX_RC_SIZE >(m_Crypto, rc, h))
+        return false;
+      if(HasGoodSignature(h))
+        return true;
+      if(!rc.VerifySignature(m_Crypto))
+        return false;
+      PutGoodSignature(h);
+      return true;
+    }
+
+    bool
+    Verifier::Verify(const Job& job)
+    {
+      for(const auto& introset : job.introsets)
+        if(!Verify(introset))
+          return false;
+      for(const auto& rc : job.rcs)
+        if(!Verify(rc))
+          return false;
+      return true;
+    }
+
+    void
+    Verifier::Queue(Job job)
+    {
+      if(batchSize == 0)
+      {
+        job.valid = Verify(job);
+        job.result(job);
+        return;
+      }
+      m_Pending.emplace_back(std::move(job));
+      if(m_Pending.size() >= batchSize)
+        Dispatch();
+      else if(!m_FlushScheduled)
+      {
+        // send a short batch after everything read this tick
+        m_FlushScheduled = true;
+        llarp_logic_queue_job(m_Logic, {this, &HandleFlush});
+      }
+    }
+
+    void
+    Verifier::HandleFlush(void* user)
+    {
+      Verifier* self         = static_cast< Verifier* >(user);
+      self->m_FlushScheduled = false;
+      if(self->m_Pending.size())
+        self->Dispatch();
+    }
+
+    void
+    Verifier::Dispatch()
+    {
+      Batch* batch  = new Batch();
+      batch->parent = this;
+      std::swap(batch->jobs, m_Pending);
+      m_InFlight += batch->jobs.size();
+      llarp_threadpool_queue_job(m_Worker, {batch, &HandleWork});
+    }
+
+    void
+    Verifier::HandleWork(void* user)
+    {
+      Batch* batch = static_cast< Batch* >(user);
+      for(auto& job : batch->jobs)
+        job.valid = batch->parent->Verify(job);
+      llarp_logic_queue_job(batch->parent->m_Logic, {batch, &HandleDone});
+    }
+
+    void
+    Verifier::HandleDone(void* user)
+    {
+      Batch* batch = static_cast< Batch* >(user);
+      batch->parent->m_InFlight -= batch->jobs.size();
+      for(auto& job : batch->jobs)
+        job.result(job);
+      delete batch;
+    }
+  }  // namespace dht
+}  // namespace llarp
@@ -40,13 +40,35 @@ namespace llarp
                                  const byte_t* otherPubkey,
                                  llarp_crypto* crypto)
   {
+    return EncryptInPlace(*Buffer(), ourSecretKey, otherPubkey, crypto);
+  }
+
+  bool
+  EncryptedFrame::DecryptInPlace(const byte_t* ourSecretKey,
+                                 llarp_crypto* crypto)
+  {
+    return DecryptInPlace(*Buffer(), ourSecretKey, crypto);
+  }
+
+  bool
+  EncryptedFrame::EncryptInPlace(llarp_buffer_t frame,
+                                 const byte_t* ourSecretKey,
+                                 const byte_t* otherPubkey,
+                                 llarp_crypto* crypto)
+  {
+    if(frame.sz <= size_t(EncryptedFrame::OverheadSize))
+    {
+      llarp::LogWarn("encrypted frame too small, ", frame.sz,
+                     " <= ", size_t(EncryptedFrame::OverheadSize));
+      return false;
+    }
     // format of frame is
     // <32 bytes keyed hash of following data>
     // <32 bytes nonce>
     // <32 bytes pubkey>
     // <N bytes encrypted payload>
     //
-    byte_t* hash   = data();
+    byte_t* hash   = frame.base;
     byte_t* nonce  = hash + SHORTHASHSIZE;
     byte_t* pubkey = nonce + TUNNONCESIZE;
     byte_t* body   = pubkey + PUBKEYSIZE;
@@ -60,7 +82,7 @@ namespace llarp
     llarp_buffer_t buf;
     buf.base = body;
     buf.cur  = buf.base;
-    buf.sz   = size() - EncryptedFrame::OverheadSize;
+    buf.sz   = frame.sz - EncryptedFrame::OverheadSize;
 
     // set our pubkey
     memcpy(pubkey, llarp::seckey_topublic(ourSecretKey), PUBKEYSIZE);
@@ -84,7 +106,7 @@ namespace llarp
     // generate message auth
     buf.base = nonce;
     buf.cur  = buf.base;
-    buf.sz   = size() - SHORTHASHSIZE;
+    buf.sz   = frame.sz - SHORTHASHSIZE;
 
     if(!MDS(hash, buf, shared))
     {
@@ -95,12 +117,13 @@ namespace llarp
   }
 
   bool
-  EncryptedFrame::DecryptInPlace(const byte_t* ourSecretKey,
+  EncryptedFrame::DecryptInPlace(llarp_buffer_t frame,
+                                 const byte_t* ourSecretKey,
                                  llarp_crypto* crypto)
   {
-    if(size() <= size_t(EncryptedFrame::OverheadSize))
+    if(frame.sz <= size_t(EncryptedFrame::OverheadSize))
     {
-      llarp::LogWarn("encrypted frame too small, ", size(),
+      llarp::LogWarn("encrypted frame too small, ", frame.sz,
                      " <= ", size_t(EncryptedFrame::OverheadSize));
       return false;
     }
@@ -110,7 +133,7 @@ namespace llarp
     // <32 bytes pubkey>
     // <N bytes encrypted payload>
     //
-    byte_t* hash        = data();
+    byte_t* hash        = frame.base;
     byte_t* nonce       = hash + SHORTHASHSIZE;
     byte_t* otherPubkey = nonce + TUNNONCESIZE;
     byte_t* body        = otherPubkey + PUBKEYSIZE;
@@ -123,7 +146,7 @@ namespace llarp
     llarp_buffer_t buf;
     buf.base = nonce;
     buf.cur  = buf.base;
-    buf.sz   = size() - SHORTHASHSIZE;
+    buf.sz   = frame.sz - SHORTHASHSIZE;
 
     SharedSecret shared;
     ShortHash digest;
@@ -148,7 +171,7 @@ namespace llarp
 
     buf.base = body;
     buf.cur  = body;
-    buf.sz   = size() - EncryptedFrame::OverheadSize;
+    buf.sz   = frame.sz - EncryptedFrame::OverheadSize;
 
     if(!Decrypt(buf, shared, nonce))
     {
@@ -45,7 +45,7 @@ llarp_ev_loop_run(struct llarp_ev_loop *ev, struct llarp_logic *logic)
   while(ev->running())
   {
     ev->tick(EV_TICK_INTERVAL);
-    if(ev->running())
+    if(ev->running() && logic)
       llarp_logic_tick(logic);
   }
   return 0;
@@ -77,6 +77,20 @@ llarp_ev_add_udp(struct llarp_ev_loop *ev, struct llarp_udp_io *udp,
   return -1;
 }
 
+void
+llarp_ev_loop_set_reuseport(struct llarp_ev_loop *ev, bool enable)
+{
+  ev->reuseport = enable;
+}
+
+int
+llarp_ev_udp_mirror(struct llarp_ev_loop *ev, struct llarp_udp_io *udp)
+{
+  if(ev->udp_mirror(udp))
+    return 0;
+  return -1;
+}
+
 int
 llarp_ev_close_udp(struct llarp_udp_io *udp)
 {
@@ -104,6 +118,15 @@ llarp_ev_udp_sendto(struct llarp_udp_io *udp, const sockaddr *to,
   return ret;
 }
 
+void
+llarp_ev_udp_get_stats(struct llarp_udp_io *udp, struct llarp_udp_stats *stats)
+{
+  if(udp->impl)
+    *stats = static_cast< llarp::ev_io * >(udp->impl)->stats;
+  else
+    *stats = {0, 0, 0, 0};
+}
+
 bool
 llarp_ev_add_tun(struct llarp_ev_loop *loop, struct llarp_tun_io *tun)
 {
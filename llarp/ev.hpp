@@ -33,6 +33,9 @@ namespace llarp
     ULONG_PTR listener_id = 0;
     ev_io(SOCKET f) : fd(f), m_writeq("writequeue"){};
 #endif
+    /// datagram and syscall counters
+    llarp_udp_stats stats = {0, 0, 0, 0};
+
     virtual int
     read(void* buf, size_t sz) = 0;
 
@@ -163,6 +166,18 @@ struct llarp_ev_loop
 
   virtual bool
   udp_close(llarp_udp_io* l) = 0;
+
+  /// bind another socket to the address of a udp handler that lives on
+  /// another loop and read datagrams for it on this loop's thread
+  virtual bool
+  udp_mirror(llarp_udp_io*)
+  {
+    return false;
+  }
+
+  /// set SO_REUSEPORT on udp sockets so they can be mirrored
+  bool reuseport = false;
+
   virtual bool
   close_ev(llarp::ev_io* ev) = 0;
 
@@ -180,12 +195,21 @@ struct llarp_ev_loop
   std::list< llarp_udp_io* > udp_listeners;
   std::list< llarp_tun_io* > tun_listeners;
 
+  /// send any batched datagrams
+  void
+  flush_udp()
+  {
+    for(auto& l : udp_listeners)
+      static_cast< llarp::ev_io* >(l->impl)->flush_write();
+  }
+
   void
   tick_listeners()
   {
     for(auto& l : udp_listeners)
       if(l->tick)
         l->tick(l);
+    flush_udp();
     for(auto& l : tun_listeners)
     {
       if(l->tick)
@@ -2,20 +2,143 @@
 #define EV_EPOLL_HPP
 #include <fcntl.h>
 #include <llarp/buffer.h>
+#include <llarp/lockfree.hpp>
 #include <llarp/net.h>
 #include <signal.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <tuntap.h>
 #include <unistd.h>
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <vector>
 #include "buffer.hpp"
 #include "ev.hpp"
 #include "llarp/net.hpp"
 #include "logger.hpp"
 #include "mem.hpp"
 
+#ifdef __linux__
+// batch datagrams with recvmmsg and sendmmsg
+#define EV_UDP_BATCH
+#endif
+
+#ifndef EV_UDP_BATCH_SIZE
+#define EV_UDP_BATCH_SIZE 32
+#endif
+
+/// reads per ready fd per tick before we move on to the others
+#ifndef EV_READS_PER_TICK
+#define EV_READS_PER_TICK 64
+#endif
+
+/// largest datagram a mirror socket hands to the owning loop
+#ifndef EV_MIRROR_DGRAM_SZ
+#define EV_MIRROR_DGRAM_SZ 2048
+#endif
+
+#ifndef EV_MIRROR_RING_SIZE
+#define EV_MIRROR_RING_SIZE 512
+#endif
+
 namespace llarp
 {
+#ifdef EV_UDP_BATCH
+  /// a ring of datagram buffers for one recvmmsg or sendmmsg call
+  struct udp_batch
+  {
+    mmsghdr msgs[EV_UDP_BATCH_SIZE];
+    iovec iovs[EV_UDP_BATCH_SIZE];
+    sockaddr_in6 addrs[EV_UDP_BATCH_SIZE];
+    byte_t bufs[EV_UDP_BATCH_SIZE][EV_READ_BUF_SZ];
+    size_t count = 0;
+
+    udp_batch()
+    {
+      memset(msgs, 0, sizeof(msgs));
+      for(size_t idx = 0; idx < EV_UDP_BATCH_SIZE; ++idx)
+      {
+        iovs[idx].iov_base            = bufs[idx];
+        iovs[idx].iov_len             = sizeof(bufs[idx]);
+        msgs[idx].msg_hdr.msg_iov     = &iovs[idx];
+        msgs[idx].msg_hdr.msg_iovlen  = 1;
+        msgs[idx].msg_hdr.msg_name    = &addrs[idx];
+        msgs[idx].msg_hdr.msg_namelen = sizeof(addrs[idx]);
+      }
+    }
+
+    /// reset lengths clobbered by the last recvmmsg
+    void
+    prepare_recv(size_t num)
+    {
+      for(size_t idx = 0; idx < num; ++idx)
+      {
+        iovs[idx].iov_len             = sizeof(bufs[idx]);
+        msgs[idx].msg_hdr.msg_namelen = sizeof(addrs[idx]);
+      }
+    }
+
+    /// forget the first num queued datagrams and move the rest to the front
+    void
+    consume(size_t num)
+    {
+      if(num == 0)
+        return;
+      for(size_t idx = num; idx < count; ++idx)
+      {
+        const size_t to = idx - num;
+        memcpy(bufs[to], bufs[idx], iovs[idx].iov_len);
+        memcpy(&addrs[to], &addrs[idx], msgs[idx].msg_hdr.msg_namelen);
+        iovs[to].iov_len             = iovs[idx].iov_len;
+        msgs[to].msg_hdr.msg_namelen = msgs[idx].msg_hdr.msg_namelen;
+      }
+      count = num < count ? count - num : 0;
+    }
+  };
+#endif
+
+  /// a datagram read by a mirror socket for the loop that owns the handler
+  struct udp_datagram
+  {
+    sockaddr_in6 from;
+    size_t sz = 0;
+    byte_t buf[EV_MIRROR_DGRAM_SZ];
+  };
+
+  typedef util::MPSCRing< udp_datagram, EV_MIRROR_RING_SIZE > udp_inbound_ring;
+
+  /// eventfd another thread pokes to wake us out of epoll_wait
+  struct ev_waker : public ev_io
+  {
+    ev_waker() : ev_io(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    {
+    }
+
+    void
+    wake()
+    {
+      uint64_t one = 1;
+      if(::write(fd, &one, sizeof(one)) == -1 && errno != EAGAIN)
+        llarp::LogWarn("failed to wake event loop: ", strerror(errno));
+    }
+
+    virtual int
+    read(void*, size_t)
+    {
+      uint64_t count;
+      if(::read(fd, &count, sizeof(count)) == -1)
+        return -1;
+      return 1;
+    }
+
+    virtual int
+    sendto(const sockaddr*, const void*, size_t)
+    {
+      return -1;
+    }
+  };
+
   struct udp_listener : public ev_io
   {
     llarp_udp_io* udp;
@@ -26,17 +149,134 @@ namespace llarp
     {
     }
 
+    /// datagrams read by mirror sockets on other net threads
+    std::unique_ptr< udp_inbound_ring > inbound;
+    /// datagrams mirrors dropped because inbound was full
+    std::atomic< uint64_t > inbound_drops{0};
+
+    /// hand datagrams the mirrors read to the handler on our thread
+    void
+    drain_inbound()
+    {
+      if(!inbound)
+        return;
+      udp_datagram pkt;
+      while(inbound->TryPop(pkt))
+        udp->recvfrom(udp, (const sockaddr*)&pkt.from, pkt.buf, pkt.sz);
+      uint64_t drops = inbound_drops.exchange(0);
+      if(drops)
+        llarp::LogWarn("dropped ", drops, " datagrams from net threads");
+    }
+
+#ifdef EV_UDP_BATCH
+    std::unique_ptr< udp_batch > rx{new udp_batch()};
+    std::unique_ptr< udp_batch > tx{new udp_batch()};
+
+    /// read up to a batch of datagrams and hand them to the handler in a burst
+    /// return the number of datagrams read or -1 on error
+    virtual int
+    read(void*, size_t)
+    {
+      rx->prepare_recv(EV_UDP_BATCH_SIZE);
+      int ret = ::recvmmsg(fd, rx->msgs, EV_UDP_BATCH_SIZE, MSG_DONTWAIT,
+                           nullptr);
+      if(ret == -1)
+        return -1;
+      ++stats.rx_calls;
+      stats.rx_pkts += ret;
+      for(int idx = 0; idx < ret; ++idx)
+      {
+        udp->recvfrom(udp, (const sockaddr*)&rx->addrs[idx], rx->bufs[idx],
+                      rx->msgs[idx].msg_len);
+      }
+      return ret;
+    }
+
+    /// queue a datagram to go out with the next sendmmsg
+    virtual int
+    sendto(const sockaddr* to, const void* data, size_t sz)
+    {
+      socklen_t slen;
+      switch(to->sa_family)
+      {
+        case AF_INET:
+          slen = sizeof(struct sockaddr_in);
+          break;
+        case AF_INET6:
+          slen = sizeof(struct sockaddr_in6);
+          break;
+        default:
+          return -1;
+      }
+      if(sz > sizeof(tx->bufs[0]))
+      {
+        // too big to batch, keep ordering and send it now
+        flush_write();
+        ++stats.tx_calls;
+        ssize_t sent = ::sendto(fd, data, sz, SOCK_NONBLOCK, to, slen);
+        if(sent == -1)
+          llarp::LogWarn(strerror(errno));
+        else
+          ++stats.tx_pkts;
+        return sent;
+      }
+      if(tx->count == EV_UDP_BATCH_SIZE)
+        flush_write();
+      if(tx->count == EV_UDP_BATCH_SIZE)
+      {
+        // the socket still won't take what we have queued
+        llarp::LogWarn("dropping datagram, send buffer full");
+        errno = EAGAIN;
+        return -1;
+      }
+      const size_t idx = tx->count++;
+      memcpy(&tx->addrs[idx], to, slen);
+      memcpy(tx->bufs[idx], data, sz);
+      tx->iovs[idx].iov_len             = sz;
+      tx->msgs[idx].msg_hdr.msg_namelen = slen;
+      return sz;
+    }
+
+    /// send everything queued since the last flush, what the socket won't
+    /// take now stays queued for the next one
+    virtual void
+    flush_write()
+    {
+      size_t off = 0;
+      while(off < tx->count)
+      {
+        int ret =
+            ::sendmmsg(fd, tx->msgs + off, tx->count - off, MSG_DONTWAIT);
+        ++stats.tx_calls;
+        if(ret == -1)
+        {
+          if(errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+          // skip the datagram that failed
+          llarp::LogWarn(strerror(errno));
+          ++off;
+          continue;
+        }
+        stats.tx_pkts += ret;
+        off += ret;
+      }
+      tx->consume(off);
+      errno = 0;
+    }
+#else
     virtual int
     read(void* buf, size_t sz)
     {
       sockaddr_in6 src;
       socklen_t slen = sizeof(sockaddr_in6);
       sockaddr* addr = (sockaddr*)&src;
-      int ret        = ::recvfrom(fd, buf, sz, 0, addr, &slen);
+      int ret        = ::recvfrom(fd, buf, sz, MSG_DONTWAIT, addr, &slen);
       if(ret == -1)
         return -1;
+      ++stats.rx_calls;
+      ++stats.rx_pkts;
       udp->recvfrom(udp, addr, buf, ret);
-      return 0;
+      return 1;
     }
 
     virtual int
@@ -54,14 +294,71 @@ namespace llarp
         default:
           return -1;
       }
+      ++stats.tx_calls;
       ssize_t sent = ::sendto(fd, data, sz, SOCK_NONBLOCK, to, slen);
       if(sent == -1)
       {
         llarp::LogWarn(strerror(errno));
       }
+      else
+        ++stats.tx_pkts;
       return sent;
     }
+#endif
+  };
+
+#ifdef EV_UDP_BATCH
+  /// another socket bound to the address of a udp_listener on another loop
+  /// the kernel spreads flows across SO_REUSEPORT sockets by 4-tuple hash so
+  /// each remote always lands on the same net thread, we do the syscalls and
+  /// copies here and the handler runs on the owner's thread
+  struct udp_mirror : public ev_io
+  {
+    udp_listener* owner;
+    ev_waker* waker;
+    std::unique_ptr< udp_batch > rx{new udp_batch()};
+
+    udp_mirror(int fd, udp_listener* l, ev_waker* w)
+        : ev_io(fd), owner(l), waker(w)
+    {
+    }
+
+    virtual int
+    read(void*, size_t)
+    {
+      rx->prepare_recv(EV_UDP_BATCH_SIZE);
+      int ret = ::recvmmsg(fd, rx->msgs, EV_UDP_BATCH_SIZE, MSG_DONTWAIT,
+                           nullptr);
+      if(ret == -1)
+        return -1;
+      ++stats.rx_calls;
+      stats.rx_pkts += ret;
+      udp_datagram pkt;
+      for(int idx = 0; idx < ret; ++idx)
+      {
+        if(rx->msgs[idx].msg_len > sizeof(pkt.buf))
+        {
+          ++owner->inbound_drops;
+          continue;
+        }
+        memcpy(&pkt.from, &rx->addrs[idx], sizeof(pkt.from));
+        memcpy(pkt.buf, rx->bufs[idx], rx->msgs[idx].msg_len);
+        pkt.sz = rx->msgs[idx].msg_len;
+        if(!owner->inbound->TryPush(std::move(pkt)))
+          ++owner->inbound_drops;
+      }
+      waker->wake();
+      return ret;
+    }
+
+    /// replies go out through the owner's socket
+    virtual int
+    sendto(const sockaddr*, const void*, size_t)
+    {
+      return -1;
+    }
   };
+#endif
 
   struct tun : public ev_io
   {
@@ -95,11 +392,19 @@ namespace llarp
     int
     read(void* buf, size_t sz)
     {
+      if(t->recvbuf)
+      {
+        size_t slotsz = 0;
+        void* slot    = t->recvbuf(t, &slotsz);
+        if(slot)
+        {
+          buf = slot;
+          sz  = slotsz;
+        }
+      }
       ssize_t ret = tuntap_read(tunif, buf, sz);
       if(ret > 0 && t->recvpkt)
-      {
         t->recvpkt(t, buf, ret);
-      }
       return ret;
     }
 
@@ -143,6 +448,15 @@ namespace llarp
 struct llarp_epoll_loop : public llarp_ev_loop
 {
   int epollfd;
+  /// drain fds until EAGAIN on edge triggered wakeups
+  bool edge_triggered = true;
+  /// fds that still had data when they used up their reads last tick
+  std::vector< llarp::ev_io* > backlog;
+  /// wakes us when mirrors on other loops queued datagrams for us
+  std::unique_ptr< llarp::ev_waker > waker;
+  /// sockets we read on behalf of udp handlers on other loops
+  std::vector< std::unique_ptr< llarp::ev_io > > mirrors;
+
   llarp_epoll_loop() : epollfd(-1)
   {
   }
@@ -167,53 +481,96 @@ struct llarp_epoll_loop : public llarp_ev_loop
     return false;
   }
 
-  int
-  tick(int ms)
+  /// read from ev until it would block or it used up its share of this tick,
+  /// in which case it goes on the backlog so others get a turn
+  void
+  drain(llarp::ev_io* ev)
   {
-    epoll_event events[1024];
-    int result;
-    result = epoll_wait(epollfd, events, 1024, ms);
-    if(result > 0)
+    if(!edge_triggered)
+    {
+      ev->read(readbuf, sizeof(readbuf));
+      return;
+    }
+    for(size_t n = 0; n < EV_READS_PER_TICK; ++n)
     {
-      int idx = 0;
-      while(idx < result)
+      int ret = ev->read(readbuf, sizeof(readbuf));
+      if(ret > 0)
+        continue;
+      if(ret == -1)
       {
-        llarp::ev_io* ev = static_cast< llarp::ev_io* >(events[idx].data.ptr);
-        if(events[idx].events & EPOLLIN)
+        switch(errno)
         {
-          ev->read(readbuf, sizeof(readbuf));
+          case EINTR:
+          case ECONNREFUSED:
+          case EHOSTUNREACH:
+          case ENETUNREACH:
+            // queued icmp error, there may be datagrams behind it
+            continue;
+          case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+          case EWOULDBLOCK:
+#endif
+            break;
+          default:
+            llarp::LogWarn("read failed: ", strerror(errno));
         }
-        ++idx;
+        errno = 0;
       }
+      return;
     }
-    if(result != -1)
-      tick_listeners();
+    backlog.push_back(ev);
+  }
+
+  /// deliver datagrams mirrors on other loops read for our handlers
+  void
+  drain_mirrored()
+  {
+    if(!waker)
+      return;
+    for(auto& l : udp_listeners)
+      static_cast< llarp::udp_listener* >(l->impl)->drain_inbound();
+  }
+
+  /// wait up to ms for events and read everything that is ready
+  int
+  poll(int ms)
+  {
+    epoll_event events[1024];
+    // send what logic queued since the last tick before we block
+    flush_udp();
+    // don't sleep when a fd still has data from last tick
+    if(!backlog.empty())
+      ms = 0;
+    int result = epoll_wait(epollfd, events, 1024, ms);
+    if(result == -1)
+      return -1;
+    std::vector< llarp::ev_io* > pending;
+    pending.swap(backlog);
+    for(auto ev : pending)
+      drain(ev);
+    for(int idx = 0; idx < result; ++idx)
+    {
+      if(events[idx].events & EPOLLIN)
+        drain(static_cast< llarp::ev_io* >(events[idx].data.ptr));
+    }
+    drain_mirrored();
+    tick_listeners();
     return result;
   }
 
+  int
+  tick(int ms)
+  {
+    return poll(ms);
+  }
+
   int
   run()
   {
-    epoll_event events[1024];
     int result;
     do
     {
-      result = epoll_wait(epollfd, events, 1024, EV_TICK_INTERVAL);
-      if(result > 0)
-      {
-        int idx = 0;
-        while(idx < result)
-        {
-          llarp::ev_io* ev = static_cast< llarp::ev_io* >(events[idx].data.ptr);
-          if(events[idx].events & EPOLLIN)
-          {
-            ev->read(readbuf, sizeof(readbuf));
-          }
-          ++idx;
-        }
-      }
-      if(result != -1)
-        tick_listeners();
+      result = poll(EV_TICK_INTERVAL);
     } while(epollfd != -1);
     return result;
   }
@@ -252,6 +609,17 @@ struct llarp_epoll_loop : public llarp_ev_loop
         return -1;
       }
     }
+    if(reuseport)
+    {
+      // let mirrors on other net threads bind the same address
+      int one = 1;
+      if(setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) == -1)
+      {
+        perror("setsockopt()");
+        close(fd);
+        return -1;
+      }
+    }
     llarp::Addr a(*addr);
     llarp::LogDebug("bind to ", a);
     if(bind(fd, addr, slen) == -1)
@@ -267,6 +635,8 @@ struct llarp_epoll_loop : public llarp_ev_loop
   bool
   close_ev(llarp::ev_io* ev)
   {
+    backlog.erase(std::remove(backlog.begin(), backlog.end(), ev),
+                  backlog.end());
     return epoll_ctl(epollfd, EPOLL_CTL_DEL, ev->fd, nullptr) != -1;
   }
 
@@ -297,7 +667,7 @@ struct llarp_epoll_loop : public llarp_ev_loop
   {
     epoll_event ev;
     ev.data.ptr = e;
-    ev.events   = EPOLLIN;
+    ev.events   = edge_triggered ? EPOLLIN | EPOLLET : EPOLLIN;
     // if(write)
     //   ev.events |= EPOLLOUT;
     if(epoll_ctl(epollfd, EPOLL_CTL_ADD, e->fd, &ev) == -1)
@@ -308,6 +678,64 @@ struct llarp_epoll_loop : public llarp_ev_loop
     return true;
   }
 
+  bool
+  udp_mirror(llarp_udp_io* udp)
+  {
+#ifdef EV_UDP_BATCH
+    llarp_epoll_loop* owner = static_cast< llarp_epoll_loop* >(udp->parent);
+    llarp::udp_listener* listener =
+        static_cast< llarp::udp_listener* >(udp->impl);
+    if(owner == this || listener == nullptr || !owner->reuseport)
+      return false;
+    sockaddr_in6 addr;
+    socklen_t slen = sizeof(addr);
+    if(getsockname(listener->fd, (sockaddr*)&addr, &slen) == -1)
+      return false;
+    reuseport = true;
+    int fd    = udp_bind((const sockaddr*)&addr);
+    if(fd == -1)
+      return false;
+    llarp::ev_waker* w = owner->get_waker();
+    if(w == nullptr)
+    {
+      close(fd);
+      return false;
+    }
+    if(!listener->inbound)
+      listener->inbound.reset(new llarp::udp_inbound_ring());
+    // owns fd from here, closing it if we can't poll it so it doesn't keep
+    // taking a share of the port's datagrams
+    std::unique_ptr< llarp::ev_io > m(new llarp::udp_mirror(fd, listener, w));
+    epoll_event ev;
+    ev.data.ptr = m.get();
+    ev.events   = edge_triggered ? EPOLLIN | EPOLLET : EPOLLIN;
+    if(epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &ev) == -1)
+      return false;
+    mirrors.emplace_back(std::move(m));
+    return true;
+#else
+    (void)udp;
+    return false;
+#endif
+  }
+
+  llarp::ev_waker*
+  get_waker()
+  {
+    if(waker)
+      return waker.get();
+    std::unique_ptr< llarp::ev_waker > w(new llarp::ev_waker());
+    if(w->fd == -1)
+      return nullptr;
+    epoll_event ev;
+    ev.data.ptr = w.get();
+    ev.events   = edge_triggered ? EPOLLIN | EPOLLET : EPOLLIN;
+    if(epoll_ctl(epollfd, EPOLL_CTL_ADD, w->fd, &ev) == -1)
+      return nullptr;
+    waker = std::move(w);
+    return waker.get();
+  }
+
   bool
   udp_close(llarp_udp_io* l)
   {
@@ -43,6 +43,8 @@ namespace llarp
       ssize_t ret    = ::recvfrom(fd, buf, sz, 0, addr, &slen);
       if(ret == -1)
         return -1;
+      ++stats.rx_calls;
+      ++stats.rx_pkts;
       udp->recvfrom(udp, addr, buf, ret);
       return 0;
     }
@@ -67,9 +69,12 @@ namespace llarp
         printf("kqueue sendto fd empty\n");
         return -1;
       }
+      ++stats.tx_calls;
       ssize_t sent = ::sendto(fd, data, sz, 0, to, slen);
       if(sent == -1)
         perror("kqueue sendto()");
+      else
+        ++stats.tx_pkts;
       return sent;
     }
   };
@@ -106,6 +111,16 @@ namespace llarp
     int
     read(void* buf, size_t sz)
     {
+      if(t->recvbuf)
+      {
+        size_t slotsz = 0;
+        void* slot    = t->recvbuf(t, &slotsz);
+        if(slot)
+        {
+          buf = slot;
+          sz  = slotsz;
+        }
+      }
       ssize_t ret = tuntap_read(tunif, buf, sz);
       if(ret > 0 && t->recvpkt)
         t->recvpkt(t, buf, ret);
@@ -9,7 +9,6 @@ namespace llarp
   {
     TunEndpoint::TunEndpoint(const std::string &nickname, llarp_router *r)
         : service::Endpoint(nickname, r)
-        , m_UserToNetworkPktQueue(nickname + "_sendq")
         , m_NetworkToUserPktQueue(nickname + "_recvq")
     {
       tunif.user    = this;
@@ -19,6 +18,7 @@ namespace llarp
       tunif.tick         = nullptr;
       tunif.before_write = &tunifBeforeWrite;
       tunif.recvpkt      = &tunifRecvPkt;
+      tunif.recvbuf      = &tunifRecvBuf;
     }
 
     bool
@@ -180,20 +180,22 @@ namespace llarp
     void
     TunEndpoint::FlushSend()
     {
-      m_UserToNetworkPktQueue.Process([&](net::IPv4Packet &pkt) {
-        auto itr = m_IPToAddr.find(pkt.dst());
+      net::IPv4Packet *pkt;
+      while((pkt = m_UserToNetworkPktQueue.Front()))
+      {
+        auto itr = m_IPToAddr.find(pkt->dst());
         if(itr == m_IPToAddr.end())
         {
           llarp::LogWarn(Name(), " has no endpoint for ",
-                         inet_ntoa({htonl(pkt.dst())}));
-          return true;
+                         inet_ntoa({htonl(pkt->dst())}));
         }
-        if(!SendToOrQueue(itr->second, pkt.Buffer(), service::eProtocolTraffic))
+        else if(!SendToOrQueue(itr->second, pkt->Buffer(),
+                               service::eProtocolTraffic))
         {
           llarp::LogWarn(Name(), " did not flush packets");
         }
-        return true;
-      });
+        m_UserToNetworkPktQueue.Pop();
+      }
     }
 
     bool
@@ -324,29 +326,63 @@ namespace llarp
         if(!llarp_ev_tun_async_write(tun, pkt.buf, pkt.sz))
           llarp::LogWarn("packet dropped");
       });
-      if(self->m_UserToNetworkPktQueue.Size())
+      // one flush for everything read this event loop tick, and none while
+      // one is still pending
+      if(self->m_UserToNetworkPktQueue.SizeApprox()
+         && !self->m_NetSendQueued.exchange(true))
         llarp_logic_queue_job(self->RouterLogic(), {self, &handleNetSend});
     }
 
     void
     TunEndpoint::handleNetSend(void *user)
     {
-      TunEndpoint *self = static_cast< TunEndpoint * >(user);
+      TunEndpoint *self     = static_cast< TunEndpoint * >(user);
+      self->m_NetSendQueued = false;
       self->FlushSend();
     }
 
+    void *
+    TunEndpoint::tunifRecvBuf(llarp_tun_io *tun, size_t *sz)
+    {
+      // called in the isolated network thread
+      TunEndpoint *self    = static_cast< TunEndpoint * >(tun->user);
+      net::IPv4Packet *pkt = self->m_UserToNetworkPktQueue.Reserve();
+      if(pkt == nullptr)
+        return nullptr;
+      *sz = sizeof(pkt->buf);
+      return pkt->buf;
+    }
+
     void
     TunEndpoint::tunifRecvPkt(llarp_tun_io *tun, const void *buf, ssize_t sz)
     {
       // called for every packet read from user in isolated network thread
       TunEndpoint *self = static_cast< TunEndpoint * >(tun->user);
       llarp::LogDebug("got pkt ", sz, " bytes");
-      if(!self->m_UserToNetworkPktQueue.EmplaceIf(
-             [self, buf, sz](net::IPv4Packet &pkt) -> bool {
-               return pkt.Load(llarp::InitBuffer(buf, sz))
-                   && pkt.Header()->version == 4;
-             }))
+      net::IPv4Packet *pkt = self->m_UserToNetworkPktQueue.Reserve();
+      if(pkt == nullptr)
+      {
+        llarp::LogDebug(self->Name(), " send ring full, dropping packet");
+        return;
+      }
+      // usually it was read right into the slot from tunifRecvBuf
+      bool loaded;
+      if(buf == pkt->buf)
+      {
+        pkt->sz = sz;
+        loaded  = sz >= ssize_t(sizeof(ip_header))
+            && size_t(sz) <= sizeof(pkt->buf);
+      }
+      else
+        loaded = sz > 0 && pkt->Load(llarp::InitBuffer(buf, sz));
+      // not pushed, so the next packet takes the slot again
+      if(!loaded || pkt->Header()->version != 4)
+      {
         llarp::LogDebug("Failed to parse ipv4 packet");
+        return;
+      }
+      pkt->timestamp = llarp_time_now_ms();
+      self->m_UserToNetworkPktQueue.Push();
     }
 
     TunEndpoint::~TunEndpoint()
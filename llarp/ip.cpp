@@ -16,11 +16,10 @@ namespace llarp
     bool
     IPv4Packet::Load(llarp_buffer_t pkt)
     {
-#ifndef MIN
-#define MIN(a, b) (a < b ? a : b)
-      sz = MIN(pkt.sz, sizeof(buf));
-#undef MIN
-#endif
+      // too short for a header or too big to hold
+      if(pkt.sz < sizeof(ip_header) || pkt.sz > sizeof(buf))
+        return false;
+      sz = pkt.sz;
       memcpy(buf, pkt.base, sz);
       return true;
     }
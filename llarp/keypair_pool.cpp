@@ -0,0 +1,111 @@
+#include <llarp/keypair_pool.hpp>
+
+namespace llarp
+{
+  KeypairPool::KeypairPool(llarp_crypto* crypto, size_t cap)
+      : capacity(cap), m_Crypto(crypto)
+  {
+  }
+
+  KeypairPool::~KeypairPool()
+  {
+    for(auto& k : m_Keys)
+      k.Zero();
+  }
+
+  void
+  KeypairPool::Init(llarp_threadpool* worker)
+  {
+    bool refill = false;
+    {
+      util::Lock lock(m_Access);
+      m_Worker = worker;
+      if(m_Worker && capacity && !m_Refilling)
+      {
+        m_Refilling = true;
+        refill      = true;
+      }
+    }
+    if(refill)
+      llarp_threadpool_queue_job(m_Worker, {this, &HandleRefill});
+  }
+
+  void
+  KeypairPool::Take(SecretKey& k)
+  {
+    bool have   = false;
+    bool refill = false;
+    {
+      util::Lock lock(m_Access);
+      if(m_Keys.size())
+      {
+        k = m_Keys.back();
+        m_Keys.back().Zero();
+        m_Keys.pop_back();
+        have = true;
+      }
+      else
+        ++m_Misses;
+      if(m_Worker && !m_Refilling && m_Keys.size() <= capacity / 2)
+      {
+        m_Refilling = true;
+        refill      = true;
+      }
+    }
+    if(refill)
+      llarp_threadpool_queue_job(m_Worker, {this, &HandleRefill});
+    if(!have)
+      m_Crypto->encryption_keygen(k);
+  }
+
+  size_t
+  KeypairPool::Size() const
+  {
+    util::Lock lock(m_Access);
+    return m_Keys.size();
+  }
+
+  size_t
+  KeypairPool::Misses() const
+  {
+    util::Lock lock(m_Access);
+    return m_Misses;
+  }
+
+  void
+  KeypairPool::HandleRefill(void* user)
+  {
+    static_cast< KeypairPool* >(user)->Refill();
+  }
+
+  void
+  KeypairPool::Refill()
+  {
+    // Take may drain it again while we make keys, go until it is full
+    for(;;)
+    {
+      size_t want = 0;
+      {
+        util::Lock lock(m_Access);
+        if(m_Keys.size() < capacity)
+          want = capacity - m_Keys.size();
+        if(want == 0)
+        {
+          m_Refilling = false;
+          return;
+        }
+      }
+      // keygen outside the lock so Take never waits on it
+      std::vector< SecretKey > keys(want);
+      for(auto& k : keys)
+        m_Crypto->encryption_keygen(k);
+      util::Lock lock(m_Access);
+      for(auto& k : keys)
+      {
+        if(m_Keys.size() < capacity)
+          m_Keys.push_back(k);
+        k.Zero();
+      }
+    }
+  }
+}  // namespace llarp
@@ -86,6 +86,18 @@ namespace llarp
     }
   }
 
+  void
+  ILinkLayer::GetUDPStats(llarp_udp_stats& stats)
+  {
+    llarp_ev_udp_get_stats(&m_udp, &stats);
+  }
+
+  bool
+  ILinkLayer::Mirror(llarp_ev_loop* loop)
+  {
+    return llarp_ev_udp_mirror(loop, &m_udp) == 0;
+  }
+
   bool
   ILinkLayer::PickAddress(const RouterContact& rc,
                           llarp::AddressInfo& picked) const
@@ -7,7 +7,8 @@
 #include <utp.h>
 #include <cassert>
 #include <tuple>
-#include <deque>
+#include <algorithm>
+#include <array>
 
 #ifdef __linux__
 #include <linux/errqueue.h>
@@ -27,18 +28,95 @@ namespace llarp
     constexpr size_t FragmentBodySize =
         FragmentBodyOverhead + FragmentBodyPayloadSize;
 
+    /// fixed size fragments, always padded to a full body
     constexpr size_t FragmentBufferSize =
         FragmentOverheadSize + FragmentBodySize;
-    typedef llarp::AlignedBuffer< FragmentBufferSize > FragmentBuffer;
 
+    /// variable size fragments carry their body size after the nonce
+    constexpr size_t FragmentLengthSize = sizeof(uint16_t);
+    constexpr size_t FragmentVarHeaderSize =
+        FragmentOverheadSize + FragmentLengthSize;
+    constexpr size_t MaxFragmentSize = FragmentVarHeaderSize + FragmentBodySize;
+    typedef llarp::AlignedBuffer< MaxFragmentSize > FragmentBuffer;
+
+    /// LIM feature bit for variable size fragments. the dialer offers it in
+    /// its LIM, the other side answers with a LIM echoing what it takes up
+    /// and switches what it sends, the dialer then switches after a LIM of
+    /// its own. each side follows when it gets the other's LIM.
+    constexpr uint64_t FeatureVariableFragments = 1 << 0;
+
+    /// most fragments we hand to utp_writev at once
     constexpr size_t MaxSend = 64;
+    static_assert(MaxSend <= UTP_IOV_MAX, "iovec window too big for libutp");
 
     /// maximum size for send queue for a session before we drop
     constexpr size_t MaxSendQueueSize = 128;
+    static_assert((MaxSendQueueSize & (MaxSendQueueSize - 1)) == 0,
+                  "send queue size must be a power of 2");
 
-    typedef llarp::AlignedBuffer< MAX_LINK_MSG_SIZE > MessageBuffer;
+    /// most unused fragment buffers a link layer keeps for reuse
+    constexpr size_t MaxFreeFragments = 1024;
+
+    /// encrypt the body of the framed fragment at buf then hash it
+    static bool
+    SealFragment(llarp_crypto* crypto, byte_t* buf, size_t sz, size_t header,
+                 const SharedSecret& key)
+    {
+      byte_t* nonce = buf + FragmentHashSize;
+      if(!crypto->xchacha20(InitBuffer(buf + header, sz - header), key, nonce))
+        return false;
+      // key'd hash over nonce, size and body
+      return crypto->hmac(buf, InitBuffer(nonce, sz - FragmentHashSize), key);
+    }
+
+    /// check the hash of the fragment at buf then decrypt its body in place,
+    /// false if it was not sent with key
+    static bool
+    OpenFragment(llarp_crypto* crypto, byte_t* buf, size_t sz, size_t header,
+                 const SharedSecret& key)
+    {
+      ShortHash digest;
+      auto hbuf = InitBuffer(buf + FragmentHashSize, sz - FragmentHashSize);
+      if(!crypto->hmac(digest.data(), hbuf, key))
+        return false;
+      if(ShortHash(buf) != digest)
+        return false;
+      return crypto->xchacha20(InitBuffer(buf + header, sz - header), key,
+                               buf + FragmentHashSize);
+    }
 
     struct LinkLayer;
+    struct BaseSession;
+
+    /// a run of one session's fragments out with a worker, sealed or opened
+    /// in order and handed back to the session on the logic thread
+    struct CryptoBatch
+    {
+      struct Frag
+      {
+        std::unique_ptr< FragmentBuffer > buf;
+        size_t sz     = 0;
+        size_t header = 0;
+        bool ok       = false;
+      };
+
+      /// null if the session went away while a worker had us
+      BaseSession* session = nullptr;
+      llarp_crypto* crypto = nullptr;
+      llarp_logic* logic   = nullptr;
+      SharedSecret key;
+      /// seal for sending, otherwise open what we got
+      bool send = false;
+      /// send queue index of the first fragment when sending
+      size_t first = 0;
+      std::vector< Frag > frags;
+
+      static void
+      HandleWork(void* user);
+
+      static void
+      HandleDone(void* user);
+    };
 
     struct BaseSession : public ILinkSession
     {
@@ -52,14 +130,50 @@ namespace llarp
       llarp_time_t lastActive;
       const static llarp_time_t sessionTimeout = 30 * 1000;
 
-      std::deque< utp_iovec > vecq;
-      std::deque< FragmentBuffer > sendq;
+      /// a fragment waiting for utp to take it
+      struct SendFragment
+      {
+        std::unique_ptr< FragmentBuffer > buf;
+        size_t sz     = 0;
+        size_t header = 0;
+      };
+      /// ring of queued fragments, sendHead and sendTail only ever grow
+      std::array< SendFragment, MaxSendQueueSize > sendq;
+      size_t sendHead = 0;
+      size_t sendTail = 0;
+      /// fragments before this are sealed and may go to utp
+      size_t sendSealed = 0;
+      /// fragments before this are sealed or with a worker
+      size_t sendCrypting = 0;
+      /// with a worker to be sealed, their slots hold no buffer until then
+      CryptoBatch* sendBatch = nullptr;
+      /// fragments we got waiting for the worker to open them
+      std::vector< CryptoBatch::Frag > recvPending;
+      /// with a worker to be opened
+      CryptoBatch* recvBatch = nullptr;
+      /// link crypto goes to the workers, set once the session is ready
+      bool cryptoOffload = false;
+      /// are we in our link layer's list of sessions with crypto to dispatch
+      bool cryptoQueued = false;
+      /// bytes of the fragment at sendHead utp already took
+      size_t sendOffset = 0;
+      /// iovecs for the next utp_writev, reused every call
+      std::array< utp_iovec, MaxSend > sendVecs;
+      /// are we in our link layer's list of sessions with writes pending
+      bool pumpQueued = false;
 
       FragmentBuffer recvBuf;
       size_t recvBufOffset;
-      MessageBuffer recvMsg;
+      /// send variable size fragments
+      bool txVariable = false;
+      /// expect variable size fragments
+      bool rxVariable = false;
+      /// the size of what we get changes at a LIM we are waiting for, so
+      /// fragments are opened inline until then
+      bool rxPendingSwitch = false;
+      /// pooled so relayed payloads can share it instead of being copied
+      PacketRef recvMsg;
       size_t recvMsgOffset;
-      bool stalled = false;
 
       void
       Alive();
@@ -103,59 +217,17 @@ namespace llarp
       BaseSession();
       ~BaseSession();
 
-      void
-      PumpWrite()
+      size_t
+      SendQueueSize() const
       {
-        if(!sock)
-          return;
-        ssize_t expect = 0;
-        std::vector< utp_iovec > vecs;
-        for(const auto& vec : vecq)
-        {
-          expect += vec.iov_len;
-          vecs.push_back(vec);
-        }
-        if(expect)
-        {
-          ssize_t s = utp_writev(sock, vecs.data(), vecs.size());
-          llarp::LogDebug("utp_writev wrote=", s, " expect=", expect,
-                          " to=", remoteAddr);
-
-          while(s > vecq.front().iov_len)
-          {
-            s -= vecq.front().iov_len;
-            vecq.pop_front();
-            sendq.pop_front();
-          }
-          if(vecq.size())
-          {
-            auto& front = vecq.front();
-            front.iov_len -= s;
-            front.iov_base = ((byte_t*)front.iov_base) + s;
-          }
-        }
-
-        /*
-        while(sendq.size() > 0 && !stalled)
-        {
-          ssize_t expect = FragmentBufferSize - sendBufOffset;
-          ssize_t s      = write_ll(sendq.front().data() + sendBufOffset,
-        expect); if(s != expect)
-          {
-            llarp::LogDebug("stalled at offset=", sendBufOffset, " sz=", s,
-                            " to ", remoteAddr);
-            sendBufOffset += s;
-            stalled = true;
-          }
-          else
-          {
-            sendBufOffset = 0;
-            sendq.pop_front();
-          }
-        }
-        */
+        return sendTail - sendHead;
       }
 
+      /// hand as much of the send queue to utp as it takes
+      /// return true if we have nothing left to write
+      bool
+      PumpWrite();
+
       ssize_t
       write_ll(byte_t* buf, size_t sz)
       {
@@ -170,7 +242,45 @@ namespace llarp
       }
 
       bool
-      VerifyThenDecrypt(byte_t* buf);
+      VerifyThenDecrypt(byte_t* buf, size_t sz);
+
+      /// take a whole fragment we got, opened inline or by a worker
+      bool
+      RecvFragment(byte_t* buf, size_t sz);
+
+      /// add the opened fragment at buf to recvMsg, sets ended if that was
+      /// the last of a message, false if it is bad
+      bool
+      Reassemble(const byte_t* buf, size_t sz, size_t header, bool& ended);
+
+      void
+      DeliverMessage(const PacketRef& msg, size_t sz);
+
+      /// hand fragments waiting on crypto to a worker unless one has ours
+      void
+      DispatchSend();
+
+      void
+      DispatchRecv();
+
+      /// a worker is done with batch, called on the logic thread
+      void
+      CryptoDone(CryptoBatch* batch);
+
+      /// size of the fragment at buf given sz bytes of it, the header size if
+      /// we need more to tell, 0 if it is bad
+      size_t
+      RecvFragmentSize(const byte_t* buf, size_t sz) const
+      {
+        if(!rxVariable)
+          return FragmentBufferSize;
+        if(sz < FragmentVarHeaderSize)
+          return FragmentVarHeaderSize;
+        size_t len = bufbe16toh(buf + FragmentOverheadSize);
+        if(len < FragmentBodyOverhead || len > FragmentBodySize)
+          return 0;
+        return FragmentVarHeaderSize + len;
+      }
 
       void
       EncryptThenHash(const byte_t* ptr, uint32_t sz, bool isLastFragment);
@@ -178,7 +288,9 @@ namespace llarp
       bool
       QueueWriteBuffers(llarp_buffer_t buf)
       {
-        if(sendq.size() >= MaxSendQueueSize)
+        const size_t frags =
+            (buf.sz + FragmentBodyPayloadSize - 1) / FragmentBodyPayloadSize;
+        if(SendQueueSize() + frags > MaxSendQueueSize)
           return false;
         llarp::LogDebug("write ", buf.sz, " bytes to ", remoteAddr);
         lastActive  = llarp_time_now_ms();
@@ -191,9 +303,23 @@ namespace llarp
           ptr += s;
           sz -= s;
         }
+        if(!cryptoOffload)
+          QueuePump();
+        else if(sendTail - sendCrypting >= Router()->linkCryptoBatch)
+          DispatchSend();
+        else
+          QueueCrypto();
         return true;
       }
 
+      /// get pumped every tick until our send queue drains
+      void
+      QueuePump();
+
+      /// dispatch our crypto once everything this tick is in
+      void
+      QueueCrypto();
+
       void
       Connect()
       {
@@ -253,39 +379,42 @@ namespace llarp
         byte_t* ptr = (byte_t*)buf;
         llarp::LogDebug("utp read ", sz, " from ", remoteAddr);
         size_t s = sz;
-        // process leftovers
-        if(recvBufOffset)
+        while(s)
         {
-          auto left = FragmentBufferSize - recvBufOffset;
-          if(s >= left)
+          if(recvBufOffset == 0)
           {
-            // yes it fills it
-            llarp::LogDebug("process leftovers, offset=", recvBufOffset,
-                            " sz=", s, " left=", left);
-            memcpy(recvBuf.data() + recvBufOffset, ptr, left);
-            s -= left;
-            recvBufOffset = 0;
-            ptr += left;
-            if(!VerifyThenDecrypt(recvBuf.data()))
+            // whole fragments are handled in place
+            size_t need = RecvFragmentSize(ptr, s);
+            if(need == 0)
               return false;
+            if(s >= need)
+            {
+              llarp::LogDebug("process full sz=", need);
+              if(!RecvFragment(ptr, need))
+                return false;
+              ptr += need;
+              s -= need;
+              continue;
+            }
           }
-        }
-        // process full fragments
-        while(s >= FragmentBufferSize)
-        {
-          recvBufOffset = 0;
-          llarp::LogDebug("process full sz=", s);
-          if(!VerifyThenDecrypt(ptr))
+          // hold onto leftovers until we have the rest of the fragment
+          size_t need = RecvFragmentSize(recvBuf.data(), recvBufOffset);
+          if(need == 0)
             return false;
-          ptr += FragmentBufferSize;
-          s -= FragmentBufferSize;
-        }
-        if(s)
-        {
-          // hold onto leftovers
-          llarp::LogDebug("leftovers sz=", s);
-          memcpy(recvBuf.data() + recvBufOffset, ptr, s);
-          recvBufOffset += s;
+          size_t take = std::min(need - recvBufOffset, s);
+          memcpy(recvBuf.data() + recvBufOffset, ptr, take);
+          recvBufOffset += take;
+          ptr += take;
+          s -= take;
+          // the header might have been all we needed to know the size
+          if(RecvFragmentSize(recvBuf.data(), recvBufOffset) == recvBufOffset)
+          {
+            llarp::LogDebug("process leftovers sz=", recvBufOffset);
+            size_t fragsz = recvBufOffset;
+            recvBufOffset = 0;
+            if(!RecvFragment(recvBuf.data(), fragsz))
+              return false;
+          }
         }
         return true;
       }
@@ -296,6 +425,14 @@ namespace llarp
       bool
       OutboundLIM(const LinkIntroMessage* msg);
 
+      /// link features our config lets us take up
+      uint64_t
+      LocalFeatures();
+
+      /// sign and queue a LIM with our RC, the caller sets N and F
+      bool
+      SendLIM(LinkIntroMessage& msg);
+
       bool
       IsTimedOut(llarp_time_t now) const
       {
@@ -342,8 +479,8 @@ namespace llarp
             static_cast< LinkLayer* >(utp_context_get_userdata(arg->context));
         llarp::LogDebug("utp_sendto ", Addr(*arg->address), " ", arg->len,
                         " bytes");
-        if(sendto(l->m_udp.fd, arg->buf, arg->len, arg->flags, arg->address,
-                  arg->address_len)
+        // goes out with the rest of this tick's datagrams
+        if(llarp_ev_udp_sendto(&l->m_udp, arg->address, arg->buf, arg->len)
            == -1)
         {
           llarp::LogError("sendto failed: ", strerror(errno));
@@ -493,6 +630,78 @@ namespace llarp
       }
 #endif
 
+      /// sessions with writes pending
+      std::vector< BaseSession* > m_Writers;
+      /// fragment buffers sessions are done with
+      std::vector< std::unique_ptr< FragmentBuffer > > m_FreeFragments;
+
+      std::unique_ptr< FragmentBuffer >
+      GetFragment()
+      {
+        if(m_FreeFragments.empty())
+          return std::unique_ptr< FragmentBuffer >(new FragmentBuffer());
+        auto buf = std::move(m_FreeFragments.back());
+        m_FreeFragments.pop_back();
+        return buf;
+      }
+
+      void
+      PutFragment(std::unique_ptr< FragmentBuffer > buf)
+      {
+        if(m_FreeFragments.size() < MaxFreeFragments)
+          m_FreeFragments.emplace_back(std::move(buf));
+      }
+
+      void
+      RemoveWriter(BaseSession* s)
+      {
+        m_Writers.erase(std::remove(m_Writers.begin(), m_Writers.end(), s),
+                        m_Writers.end());
+      }
+
+      /// sessions with fragments waiting to go to a worker
+      std::vector< BaseSession* > m_Crypting;
+      bool m_CryptoFlushQueued = false;
+
+      void
+      QueueCrypto(BaseSession* s)
+      {
+        m_Crypting.push_back(s);
+        if(m_CryptoFlushQueued)
+          return;
+        m_CryptoFlushQueued = true;
+        // runs after everything the event loop read this tick
+        llarp_logic_queue_job(router->logic, {this, &HandleCryptoFlush});
+      }
+
+      void
+      RemoveCrypting(BaseSession* s)
+      {
+        m_Crypting.erase(
+            std::remove(m_Crypting.begin(), m_Crypting.end(), s),
+            m_Crypting.end());
+      }
+
+      static void
+      HandleCryptoFlush(void* user);
+
+      /// pump sessions with something to write, dropping the ones that drain
+      void
+      PumpWriters()
+      {
+        auto itr = m_Writers.begin();
+        while(itr != m_Writers.end())
+        {
+          if((*itr)->PumpWrite())
+          {
+            (*itr)->pumpQueued = false;
+            itr                = m_Writers.erase(itr);
+          }
+          else
+            ++itr;
+        }
+      }
+
       void
       Pump()
       {
@@ -500,6 +709,7 @@ namespace llarp
 #ifdef __linux__
         ProcessICMP();
 #endif
+        PumpWriters();
         std::set< PubKey > sessions;
         {
           Lock l(m_AuthedLinksMutex);
@@ -571,12 +781,13 @@ namespace llarp
     {
       parent = p;
       remoteTransportPubKey.Zero();
+      recvMsg       = PacketPool::Global().Get();
       recvMsgOffset = 0;
 
-      SendQueueBacklog = [&]() -> size_t { return sendq.size(); };
+      SendQueueBacklog = [&]() -> size_t { return SendQueueSize(); };
 
       SendKeepAlive = [&]() -> bool {
-        if(sendq.size() == 0 && state == eSessionReady)
+        if(SendQueueSize() == 0 && state == eSessionReady)
         {
           DiscardMessage msg;
           byte_t tmp[128] = {0};
@@ -597,8 +808,8 @@ namespace llarp
       };
       GetPubKey  = std::bind(&BaseSession::RemotePubKey, this);
       lastActive = llarp_time_now_ms();
-      // Pump       = []() {};
-      Pump = std::bind(&BaseSession::PumpWrite, this);
+      // our link layer pumps us only while we have something to write
+      Pump = []() {};
       Tick = std::bind(&BaseSession::TickImpl, this, std::placeholders::_1);
       SendMessageBuffer = std::bind(&BaseSession::QueueWriteBuffers, this,
                                     std::placeholders::_1);
@@ -644,15 +855,34 @@ namespace llarp
     bool
     BaseSession::InboundLIM(const LinkIntroMessage* msg)
     {
-      if(gotLIM && remoteRC.pubkey != msg->rc.pubkey)
+      if(gotLIM)
       {
-        return false;
+        // the only LIM after the first says they switched to what we took
+        // up from their offer
+        if(!rxPendingSwitch || remoteRC.pubkey != msg->rc.pubkey)
+          return false;
+        rxPendingSwitch = false;
+        rxVariable      = (msg->F & FeatureVariableFragments) != 0;
+        return true;
       }
       remoteRC = msg->rc;
       gotLIM   = true;
       if(!DoKeyExchange(Router()->crypto.transport_dh_server, msg->N,
                         remoteRC.enckey, parent->TransportSecretKey()))
         return false;
+      // routers that offer nothing might not decode an answer
+      if(msg->F)
+      {
+        // answer with what we take up, we switch right after it and they
+        // tell us when they have
+        LinkIntroMessage reply;
+        reply.N.Randomize();
+        reply.F = msg->F & LocalFeatures();
+        if(!SendLIM(reply))
+          return false;
+        txVariable = rxPendingSwitch =
+            (reply.F & FeatureVariableFragments) != 0;
+      }
       EnterState(eSessionReady);
       return true;
     }
@@ -660,60 +890,89 @@ namespace llarp
     bool
     BaseSession::OutboundLIM(const LinkIntroMessage* msg)
     {
-      if(gotLIM && remoteRC.pubkey != msg->rc.pubkey)
+      // they answer our offer once with what they take up
+      if(!rxPendingSwitch || remoteRC.pubkey != msg->rc.pubkey)
       {
         return false;
       }
-      remoteRC = msg->rc;
-      gotLIM   = true;
-      // TODO: update address info pubkey
-      return DoKeyExchange(Router()->crypto.transport_dh_client, msg->N,
-                           remoteTransportPubKey, Router()->encryption);
+      remoteRC        = msg->rc;
+      gotLIM          = true;
+      rxPendingSwitch = false;
+      rxVariable =
+          (msg->F & LocalFeatures() & FeatureVariableFragments) != 0;
+      if(!rxVariable)
+        return true;
+      // tell them we switch too
+      LinkIntroMessage reply;
+      reply.N.Randomize();
+      reply.F = FeatureVariableFragments;
+      if(!SendLIM(reply))
+        return false;
+      txVariable = true;
+      return true;
     }
 
-    void
-    BaseSession::OutboundHandshake()
+    uint64_t
+    BaseSession::LocalFeatures()
     {
-      // set session key
-      Router()->crypto.shorthash(sessionKey, ConstBuffer(remoteRC.pubkey));
+      return Router()->linkVariableFragments ? FeatureVariableFragments : 0;
+    }
 
+    bool
+    BaseSession::SendLIM(LinkIntroMessage& msg)
+    {
       byte_t tmp[LinkIntroMessage::MaxSize];
       auto buf = StackBuffer< decltype(tmp) >(tmp);
       // build our RC
-      LinkIntroMessage msg;
       msg.rc = Router()->rc();
       if(!msg.rc.VerifySignature(&Router()->crypto))
       {
         llarp::LogError("our RC is invalid? closing session to", remoteAddr);
-        Close();
-        return;
+        return false;
       }
-      msg.N.Randomize();
       msg.P = DefaultLinkSessionLifetime;
       if(!msg.Sign(&Router()->crypto, Router()->identity))
       {
-        llarp::LogError("failed to sign LIM for outbound handshake to ",
-                        remoteAddr);
-        Close();
-        return;
+        llarp::LogError("failed to sign LIM to ", remoteAddr);
+        return false;
       }
       // encode
       if(!msg.BEncode(&buf))
       {
-        llarp::LogError("failed to encode LIM for handshake to ", remoteAddr);
-        Close();
-        return;
+        llarp::LogError("failed to encode LIM to ", remoteAddr);
+        return false;
       }
       // rewind
       buf.sz  = buf.cur - buf.base;
       buf.cur = buf.base;
       // send
       if(!SendMessageBuffer(buf))
+      {
+        llarp::LogError("failed to send LIM to ", remoteAddr);
+        return false;
+      }
+      return true;
+    }
+
+    void
+    BaseSession::OutboundHandshake()
+    {
+      // set session key
+      Router()->crypto.shorthash(sessionKey, ConstBuffer(remoteRC.pubkey));
+      // fixed size fragments both ways until both sides took up the offer
+      txVariable = rxVariable = false;
+
+      LinkIntroMessage msg;
+      msg.N.Randomize();
+      msg.F = LocalFeatures();
+      if(!SendLIM(msg))
       {
         llarp::LogError("failed to send handshake to ", remoteAddr);
         Close();
         return;
       }
+      // what they send changes size once they answer our offer
+      rxPendingSwitch = msg.F != 0;
       // mix keys
       if(!DoKeyExchange(Router()->crypto.transport_dh_client, msg.N,
                         remoteTransportPubKey, Router()->encryption))
@@ -734,6 +993,15 @@ namespace llarp
 
     BaseSession::~BaseSession()
     {
+      if(pumpQueued)
+        parent->RemoveWriter(this);
+      if(cryptoQueued)
+        parent->RemoveCrypting(this);
+      // whatever the workers have for us is thrown away when it comes back
+      if(sendBatch)
+        sendBatch->session = nullptr;
+      if(recvBatch)
+        recvBatch->session = nullptr;
       if(sock)
       {
         utp_shutdown(sock, SHUT_RDWR);
@@ -820,42 +1088,252 @@ namespace llarp
       return 0;
     }
 
+    void
+    BaseSession::QueuePump()
+    {
+      if(pumpQueued)
+        return;
+      pumpQueued = true;
+      parent->m_Writers.push_back(this);
+    }
+
+    void
+    BaseSession::QueueCrypto()
+    {
+      if(cryptoQueued)
+        return;
+      cryptoQueued = true;
+      parent->QueueCrypto(this);
+    }
+
+    void
+    LinkLayer::HandleCryptoFlush(void* user)
+    {
+      LinkLayer* self           = static_cast< LinkLayer* >(user);
+      self->m_CryptoFlushQueued = false;
+      std::vector< BaseSession* > sessions;
+      std::swap(sessions, self->m_Crypting);
+      for(auto session : sessions)
+      {
+        session->cryptoQueued = false;
+        session->DispatchSend();
+        session->DispatchRecv();
+      }
+    }
+
+    void
+    BaseSession::DispatchSend()
+    {
+      // one batch each way at a time keeps the session in order, the rest
+      // goes out when it comes back
+      if(sendBatch || sendCrypting == sendTail)
+        return;
+      sendBatch          = new CryptoBatch();
+      sendBatch->send    = true;
+      sendBatch->first   = sendCrypting;
+      sendBatch->crypto  = &Router()->crypto;
+      sendBatch->logic   = Router()->logic;
+      sendBatch->key     = sessionKey;
+      sendBatch->session = this;
+      sendBatch->frags.resize(sendTail - sendCrypting);
+      for(auto& frag : sendBatch->frags)
+      {
+        auto& slot  = sendq[sendCrypting++ % MaxSendQueueSize];
+        frag.buf    = std::move(slot.buf);
+        frag.sz     = slot.sz;
+        frag.header = slot.header;
+      }
+      llarp_threadpool_queue_job(Router()->tp,
+                                 {sendBatch, &CryptoBatch::HandleWork});
+    }
+
+    void
+    BaseSession::DispatchRecv()
+    {
+      if(recvBatch || recvPending.empty())
+        return;
+      recvBatch          = new CryptoBatch();
+      recvBatch->crypto  = &Router()->crypto;
+      recvBatch->logic   = Router()->logic;
+      recvBatch->key     = sessionKey;
+      recvBatch->session = this;
+      std::swap(recvBatch->frags, recvPending);
+      llarp_threadpool_queue_job(Router()->tp,
+                                 {recvBatch, &CryptoBatch::HandleWork});
+    }
+
+    void
+    CryptoBatch::HandleWork(void* user)
+    {
+      CryptoBatch* self = static_cast< CryptoBatch* >(user);
+      for(auto& frag : self->frags)
+      {
+        if(self->send)
+          frag.ok = SealFragment(self->crypto, frag.buf->data(), frag.sz,
+                                 frag.header, self->key);
+        else
+        {
+          frag.ok = OpenFragment(self->crypto, frag.buf->data(), frag.sz,
+                                 frag.header, self->key);
+          // the session closes on the first bad one
+          if(!frag.ok)
+            break;
+        }
+      }
+      llarp_logic_queue_job(self->logic, {self, &HandleDone});
+    }
+
+    void
+    CryptoBatch::HandleDone(void* user)
+    {
+      CryptoBatch* self = static_cast< CryptoBatch* >(user);
+      if(self->session)
+        self->session->CryptoDone(self);
+      delete self;
+    }
+
+    void
+    BaseSession::CryptoDone(CryptoBatch* batch)
+    {
+      if(batch->send)
+      {
+        sendBatch  = nullptr;
+        size_t idx = batch->first;
+        for(auto& frag : batch->frags)
+          sendq[idx++ % MaxSendQueueSize].buf = std::move(frag.buf);
+        sendSealed = idx;
+        QueuePump();
+        DispatchSend();
+        return;
+      }
+      recvBatch = nullptr;
+      // reassemble in order then hand over every message that completed
+      std::vector< std::pair< PacketRef, size_t > > msgs;
+      bool ok = true;
+      for(auto& frag : batch->frags)
+      {
+        bool ended = false;
+        if(!frag.ok)
+        {
+          llarp::LogError("Message Integrity Failed from ", remoteAddr);
+          llarp::DumpBuffer(InitBuffer(frag.buf->data(), frag.sz));
+          ok = false;
+        }
+        else
+          ok = Reassemble(frag.buf->data(), frag.sz, frag.header, ended);
+        if(!ok)
+          break;
+        if(ended)
+        {
+          msgs.emplace_back(std::move(recvMsg), recvMsgOffset);
+          recvMsg       = PacketPool::Global().Get();
+          recvMsgOffset = 0;
+        }
+        parent->PutFragment(std::move(frag.buf));
+      }
+      if(msgs.size())
+        llarp::LogDebug(msgs.size(), " messages from ", remoteAddr);
+      for(const auto& msg : msgs)
+        DeliverMessage(msg.first, msg.second);
+      if(!ok)
+      {
+        Close();
+        return;
+      }
+      if(state != eClose)
+        DispatchRecv();
+    }
+
+    bool
+    BaseSession::PumpWrite()
+    {
+      if(!sock)
+        return true;
+      // whatever a worker still has goes out once it is sealed
+      while(sendSealed != sendHead)
+      {
+        // iovecs for as much of the queue as utp takes in one call
+        size_t num    = 0;
+        size_t expect = 0;
+        for(size_t idx = sendHead; idx != sendSealed && num < MaxSend; ++idx)
+        {
+          auto& frag    = sendq[idx % MaxSendQueueSize];
+          auto& vec     = sendVecs[num++];
+          size_t offset = idx == sendHead ? sendOffset : 0;
+          vec.iov_base  = frag.buf->data() + offset;
+          vec.iov_len   = frag.sz - offset;
+          expect += vec.iov_len;
+        }
+        ssize_t s = utp_writev(sock, sendVecs.data(), num);
+        llarp::LogDebug("utp_writev wrote=", s, " expect=", expect,
+                        " to=", remoteAddr);
+        if(s <= 0)
+          return false;
+        // let go of every fragment utp took all of
+        size_t wrote = s;
+        while(wrote)
+        {
+          auto& frag  = sendq[sendHead % MaxSendQueueSize];
+          size_t left = frag.sz - sendOffset;
+          if(wrote < left)
+          {
+            sendOffset += wrote;
+            break;
+          }
+          wrote -= left;
+          sendOffset = 0;
+          parent->PutFragment(std::move(frag.buf));
+          ++sendHead;
+        }
+        // utp is full, it tells us when it is writable again
+        if(size_t(s) < expect)
+          return false;
+      }
+      return true;
+    }
+
     void
     BaseSession::EncryptThenHash(const byte_t* ptr, uint32_t sz,
                                  bool isLastFragment)
 
     {
-      sendq.emplace_back();
-      auto& buf = sendq.back();
-      vecq.emplace_back();
-      auto& vec    = vecq.back();
-      vec.iov_base = buf.data();
-      vec.iov_len  = FragmentBufferSize;
+      size_t header = FragmentOverheadSize;
+      size_t bodysz = FragmentBodySize;
+      if(txVariable)
+      {
+        const size_t pad = Router()->linkFragmentPadding;
+        header           = FragmentVarHeaderSize;
+        bodysz           = FragmentBodyOverhead + sz;
+        if(pad)
+          bodysz = std::min(((bodysz + pad - 1) / pad) * pad, FragmentBodySize);
+      }
+      auto& frag = sendq[sendTail++ % MaxSendQueueSize];
+      if(!frag.buf)
+        frag.buf = parent->GetFragment();
+      frag.sz     = header + bodysz;
+      frag.header = header;
+      auto& buf = *frag.buf;
       llarp::LogDebug("encrypt then hash ", sz, " bytes last=", isLastFragment);
-      buf.Randomize();
       byte_t* nonce = buf.data() + FragmentHashSize;
-      byte_t* body  = nonce + FragmentNonceSize;
-      byte_t* base  = body;
+      byte_t* body  = buf.data() + header;
+      // only the nonce and the padding need to be random
+      const size_t used = FragmentBodyOverhead + sz;
+      Router()->crypto.randbytes(nonce, FragmentNonceSize);
+      if(bodysz > used)
+        Router()->crypto.randbytes(body + used, bodysz - used);
+      if(txVariable)
+        htobe16buf(nonce + FragmentNonceSize, bodysz);
       if(isLastFragment)
         htobe32buf(body, 0);
       else
         htobe32buf(body, 1);
-      body += sizeof(uint32_t);
-      htobe32buf(body, sz);
-      body += sizeof(uint32_t);
-      memcpy(body, ptr, sz);
-
-      auto payload =
-          InitBuffer(base, FragmentBufferSize - FragmentOverheadSize);
-
-      // encrypt
-      Router()->crypto.xchacha20(payload, sessionKey, nonce);
-
-      payload.base = nonce;
-      payload.cur  = payload.base;
-      payload.sz   = FragmentBufferSize - FragmentHashSize;
-      // key'd hash
-      Router()->crypto.hmac(buf.data(), payload, sessionKey);
+      htobe32buf(body + sizeof(uint32_t), sz);
+      memcpy(body + FragmentBodyOverhead, ptr, sz);
+      // a worker seals it with the rest of this tick's
+      if(cryptoOffload)
+        return;
+      SealFragment(&Router()->crypto, buf.data(), frag.sz, header, sessionKey);
+      sendSealed = sendCrypting = sendTail;
     }
 
     void
@@ -864,6 +1342,8 @@ namespace llarp
       state = st;
       if(st == eSessionReady)
       {
+        // the session key stays put from here on
+        cryptoOffload = Router()->linkCryptoBatch != 0;
         parent->MapAddr(remoteRC.pubkey, this);
         Router()->HandleLinkSessionEstablished(remoteRC);
       }
@@ -871,58 +1351,85 @@ namespace llarp
     }
 
     bool
-    BaseSession::VerifyThenDecrypt(byte_t* buf)
+    BaseSession::VerifyThenDecrypt(byte_t* buf, size_t sz)
     {
       llarp::LogDebug("verify then decrypt ", remoteAddr);
-      ShortHash digest;
-
-      auto hbuf = InitBuffer(buf + FragmentHashSize,
-                             FragmentBufferSize - FragmentHashSize);
-      if(!Router()->crypto.hmac(digest.data(), hbuf, sessionKey))
+      const size_t header =
+          rxVariable ? FragmentVarHeaderSize : FragmentOverheadSize;
+      if(!OpenFragment(&Router()->crypto, buf, sz, header, sessionKey))
       {
-        llarp::LogError("keyed hash failed");
+        llarp::LogError("Message Integrity Failed from ", remoteAddr);
+        llarp::DumpBuffer(InitBuffer(buf, sz));
         return false;
       }
-      ShortHash expected(buf);
-      if(expected != digest)
-      {
-        llarp::LogError("Message Integrity Failed: got ", digest, " from ",
-                        remoteAddr, " instead of ", expected);
-        llarp::DumpBuffer(InitBuffer(buf, FragmentBufferSize));
+      bool ended = false;
+      if(!Reassemble(buf, sz, header, ended))
         return false;
+      if(ended)
+      {
+        DeliverMessage(recvMsg, recvMsgOffset);
+        // someone held on to the bytes, take a fresh buffer for the next one
+        if(recvMsg.use_count() > 1)
+          recvMsg = PacketPool::Global().Get();
+        recvMsgOffset = 0;
       }
+      return true;
+    }
 
-      auto body = InitBuffer(buf + FragmentOverheadSize,
-                             FragmentBufferSize - FragmentOverheadSize);
-
-      Router()->crypto.xchacha20(body, sessionKey, buf + FragmentHashSize);
+    bool
+    BaseSession::RecvFragment(byte_t* buf, size_t sz)
+    {
+      if(!cryptoOffload || rxPendingSwitch)
+        return VerifyThenDecrypt(buf, sz);
+      // utp wants its buffer back, keep a copy for the worker
+      recvPending.emplace_back();
+      auto& frag  = recvPending.back();
+      frag.buf    = parent->GetFragment();
+      frag.sz     = sz;
+      frag.header = rxVariable ? FragmentVarHeaderSize : FragmentOverheadSize;
+      memcpy(frag.buf->data(), buf, sz);
+      if(recvPending.size() >= Router()->linkCryptoBatch)
+        DispatchRecv();
+      else
+        QueueCrypto();
+      return true;
+    }
 
+    bool
+    BaseSession::Reassemble(const byte_t* buf, size_t sz, size_t header,
+                            bool& ended)
+    {
+      auto body = InitBuffer((byte_t*)buf + header, sz - header);
       uint32_t upper, lower;
       if(!(llarp_buffer_read_uint32(&body, &upper)
            && llarp_buffer_read_uint32(&body, &lower)))
         return false;
-      bool fragmentEnd = upper == 0;
+      ended = upper == 0;
       llarp::LogDebug("fragment size ", lower, " from ", remoteAddr);
-      if(lower + recvMsgOffset > recvMsg.size())
+      if(lower > llarp_buffer_size_left(body))
+      {
+        llarp::LogError("Fragment size ", lower, " bigger than its body");
+        return false;
+      }
+      if(lower + recvMsgOffset > recvMsg.capacity())
       {
         llarp::LogError("Fragment too big: ", lower, " bytes");
         return false;
       }
       memcpy(recvMsg.data() + recvMsgOffset, body.cur, lower);
       recvMsgOffset += lower;
-      if(fragmentEnd)
+      return true;
+    }
+
+    void
+    BaseSession::DeliverMessage(const PacketRef& msg, size_t sz)
+    {
+      llarp::LogDebug("end of message from ", remoteAddr);
+      if(!Router()->HandleRecvLinkMessage(this, msg, sz))
       {
-        // got a message
-        llarp::LogDebug("end of message from ", remoteAddr);
-        auto mbuf = InitBuffer(recvMsg.data(), recvMsgOffset);
-        if(!Router()->HandleRecvLinkMessageBuffer(this, mbuf))
-        {
-          llarp::LogWarn("failed to handle message from ", remoteAddr);
-          llarp::DumpBuffer(mbuf);
-        }
-        recvMsgOffset = 0;
+        llarp::LogWarn("failed to handle message from ", remoteAddr);
+        llarp::DumpBuffer(InitBuffer(msg.data(), sz));
       }
-      return true;
     }
 
     void
@@ -22,6 +22,10 @@ namespace llarp
         return false;
       return *strbuf.cur == 'i';
     }
+    if(llarp_buffer_eq(key, "f"))
+    {
+      return bencode_read_integer(buf, &F);
+    }
     if(llarp_buffer_eq(key, "n"))
     {
       if(N.BDecode(buf))
@@ -76,6 +80,14 @@ namespace llarp
     if(!bencode_write_bytestring(buf, "i", 1))
       return false;
 
+    if(F)
+    {
+      if(!bencode_write_bytestring(buf, "f", 1))
+        return false;
+      if(!bencode_write_uint64(buf, F))
+        return false;
+    }
+
     if(!bencode_write_bytestring(buf, "n", 1))
       return false;
     if(!N.BEncode(buf))
@@ -110,6 +122,7 @@ namespace llarp
     rc      = msg.rc;
     N       = msg.N;
     P       = msg.P;
+    F       = msg.F;
     return *this;
   }
 
@@ -6,8 +6,18 @@
 
 namespace llarp
 {
+  struct InboundMessageParser::msg_holder_t
+  {
+    RelayUpstreamMessage u;
+    RelayDownstreamMessage d;
+  };
+
   InboundMessageParser::InboundMessageParser(llarp_router* _router)
-      : router(_router)
+      : router(_router), holder(new msg_holder_t())
+  {
+  }
+
+  InboundMessageParser::~InboundMessageParser()
   {
   }
 
@@ -47,28 +57,33 @@ namespace llarp
       switch(*strbuf.cur)
       {
         case 'i':
-          handler->msg = std::make_unique< LinkIntroMessage >(handler->from);
+          handler->allocated =
+              std::make_unique< LinkIntroMessage >(handler->from);
           break;
         case 'd':
-          handler->msg =
-              std::make_unique< RelayDownstreamMessage >(handler->from);
+          handler->holder->d.Reset(handler->from, handler->packet);
+          handler->msg = &handler->holder->d;
           break;
         case 'u':
-          handler->msg =
-              std::make_unique< RelayUpstreamMessage >(handler->from);
+          handler->holder->u.Reset(handler->from, handler->packet);
+          handler->msg = &handler->holder->u;
           break;
         case 'm':
-          handler->msg = std::make_unique< DHTImmeidateMessage >(handler->from);
+          handler->allocated =
+              std::make_unique< DHTImmeidateMessage >(handler->from);
           break;
         case 'c':
-          handler->msg = std::make_unique< LR_CommitMessage >(handler->from);
+          handler->allocated =
+              std::make_unique< LR_CommitMessage >(handler->from);
           break;
         case 'x':
-          handler->msg = std::make_unique< DiscardMessage >(handler->from);
+          handler->allocated = std::make_unique< DiscardMessage >(handler->from);
           break;
         default:
           return false;
       }
+      if(handler->allocated)
+        handler->msg = handler->allocated.get();
       handler->firstkey = false;
       return true;
     }
@@ -97,12 +112,27 @@ namespace llarp
     reader.on_key = &OnKey;
     from          = src;
     firstkey      = true;
-    return bencode_read_dict(&buf, &reader);
+    bool result   = bencode_read_dict(&buf, &reader);
+    Reset();
+    return result;
+  }
+
+  bool
+  InboundMessageParser::ProcessFrom(ILinkSession* src, const PacketRef& pkt,
+                                    size_t sz)
+  {
+    packet = pkt;
+    return ProcessFrom(src, InitBuffer(pkt.data(), sz));
   }
 
   void
   InboundMessageParser::Reset()
   {
-    msg.reset(nullptr);
+    // let go of the link buffer so the session can reuse it
+    holder->u.Reset(nullptr, PacketRef());
+    holder->d.Reset(nullptr, PacketRef());
+    packet.reset();
+    allocated.reset(nullptr);
+    msg = nullptr;
   }
 }  // namespace llarp
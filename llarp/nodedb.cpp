@@ -2,17 +2,263 @@
 #include <llarp/nodedb.hpp>
 #include <llarp/router_contact.hpp>
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <cstdio>
 #include <fstream>
 #include <llarp/crypto.hpp>
+#include <llarp/endian.h>
 #include <unordered_map>
+#include <vector>
 #include "buffer.hpp"
 #include "encode.hpp"
 #include "fs.hpp"
 #include "logger.hpp"
 #include "mem.hpp"
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 static const char skiplist_subdirs[] = "0123456789abcdef";
 static const std::string RC_FILE_EXT = ".signed";
+static const std::string SNAPSHOT_FILE = "rcs.snapshot";
+static const byte_t SNAPSHOT_MAGIC[8] = {'l', 'l', 'r', 'c',
+                                        's', 'n', 'p', '2'};
+/// magic then big endian uint32 count
+static const size_t SNAPSHOT_HEADER_SIZE = sizeof(SNAPSHOT_MAGIC) + 4;
+/// rc files read and verified per worker job on load
+static const size_t FilesPerBatch = 128;
+/// snapshot rc verified per worker job on load
+static const size_t RCsPerBatch = 256;
+
+/// encode rc into buf and hash the encoding
+static bool
+EncodeRC(llarp_crypto *crypto, const llarp::RouterContact &rc,
+         llarp_buffer_t &buf, llarp::ShortHash &h)
+{
+  if(!rc.BEncode(&buf))
+    return false;
+  buf.sz  = buf.cur - buf.base;
+  buf.cur = buf.base;
+  return crypto->shorthash(h, buf);
+}
+
+/// the loader waits on this for all batches to finish
+struct LoadWait
+{
+  llarp::util::Mutex access;
+  llarp::util::Condition done;
+  size_t pending = 0;
+};
+
+struct LoadBatch
+{
+  llarp_crypto *crypto;
+  LoadWait *wait;
+  const fs::path *begin;
+  const fs::path *end;
+  std::vector< llarp::RouterContact > loaded;
+  /// hash of what is on disk for each loaded rc
+  std::vector< llarp::ShortHash > hashes;
+};
+
+/// read and verify a batch of rc files, called in the worker
+static void
+HandleLoadBatch(void *user)
+{
+  LoadBatch *batch = static_cast< LoadBatch * >(user);
+  batch->loaded.reserve(batch->end - batch->begin);
+  batch->hashes.reserve(batch->end - batch->begin);
+  for(auto fpath = batch->begin; fpath != batch->end; ++fpath)
+  {
+    llarp::RouterContact rc;
+    if(!rc.Read(fpath->string().c_str()))
+    {
+      llarp::LogError("failed to read file ", *fpath);
+      continue;
+    }
+    if(!rc.VerifySignature(batch->crypto))
+    {
+      llarp::LogError("Signature verify failed", *fpath);
+      continue;
+    }
+    byte_t tmp[MAX_RC_SIZE];
+    auto buf = llarp::StackBuffer< decltype(tmp) >(tmp);
+    batch->hashes.emplace_back();
+    if(!EncodeRC(batch->crypto, rc, buf, batch->hashes.back()))
+    {
+      batch->hashes.pop_back();
+      continue;
+    }
+    batch->loaded.push_back(rc);
+  }
+  llarp::util::Lock lock(batch->wait->access);
+  if(--batch->wait->pending == 0)
+    batch->wait->done.NotifyAll();
+}
+
+struct VerifyBatch
+{
+  llarp_crypto *crypto;
+  LoadWait *wait;
+  const llarp::RouterContact *begin;
+  const llarp::RouterContact *end;
+  /// how many did not verify
+  size_t bad = 0;
+};
+
+/// verify the signatures of a batch of rc from a snapshot, called in the
+/// worker
+static void
+HandleVerifyBatch(void *user)
+{
+  VerifyBatch *batch = static_cast< VerifyBatch * >(user);
+  for(auto rc = batch->begin; rc != batch->end; ++rc)
+  {
+    if(!rc->VerifySignature(batch->crypto))
+      ++batch->bad;
+  }
+  llarp::util::Lock lock(batch->wait->access);
+  if(--batch->wait->pending == 0)
+    batch->wait->done.NotifyAll();
+}
+
+/// modification time of path in ns, 0 if there is nothing there
+static uint64_t
+ModifiedNS(const std::string &path)
+{
+  struct stat st;
+  if(stat(path.c_str(), &st) == -1)
+    return 0;
+#if defined(__APPLE__)
+  return uint64_t(st.st_mtimespec.tv_sec) * 1000000000
+      + st.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+  return uint64_t(st.st_mtime) * 1000000000;
+#else
+  return uint64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+/// routers we can use as path hops picked in proportion to their weight
+///
+/// a dense array with a fenwick tree of the weights over it, so picking,
+/// adding, reweighting and removing are all O(log n) and removing swaps the
+/// last one into the hole
+struct HopSampler
+{
+  /// set weight of pk, adding it if new
+  void
+  Put(const llarp::PubKey &pk, uint64_t weight)
+  {
+    auto itr = slots.find(pk);
+    if(itr != slots.end())
+    {
+      Set(itr->second, weight);
+      return;
+    }
+    slots.emplace(pk, keys.size());
+    keys.push_back(pk);
+    weights.push_back(weight);
+    // the node for index i covers (i - lowbit(i), i]
+    const size_t idx = weights.size();
+    tree.push_back(weight + Prefix(idx - 1) - Prefix(idx - (idx & -idx)));
+    total += weight;
+  }
+
+  void
+  Remove(const llarp::PubKey &pk)
+  {
+    auto itr = slots.find(pk);
+    if(itr == slots.end())
+      return;
+    const size_t slot = itr->second;
+    slots.erase(itr);
+    Set(slot, 0);
+    const size_t last = keys.size() - 1;
+    if(slot != last)
+    {
+      keys[slot]        = keys[last];
+      slots[keys[slot]] = slot;
+      Set(slot, weights[last]);
+    }
+    // nothing before the last node depends on it
+    total -= weights[last];
+    keys.pop_back();
+    weights.pop_back();
+    tree.pop_back();
+  }
+
+  void
+  Clear()
+  {
+    slots.clear();
+    keys.clear();
+    weights.clear();
+    tree.assign(1, 0);
+    total = 0;
+  }
+
+  /// pick one at random by weight, false if all weights are 0
+  bool
+  Pick(llarp::PubKey &pk) const
+  {
+    if(total == 0)
+      return false;
+    uint64_t target = llarp_randint() % total;
+    size_t pos      = 0;
+    size_t step     = 1;
+    while(step * 2 < tree.size())
+      step *= 2;
+    for(; step; step /= 2)
+    {
+      if(pos + step < tree.size() && tree[pos + step] <= target)
+      {
+        pos += step;
+        target -= tree[pos];
+      }
+    }
+    pk = keys[pos];
+    return true;
+  }
+
+  size_t
+  Size() const
+  {
+    return keys.size();
+  }
+
+ private:
+  void
+  Set(size_t slot, uint64_t weight)
+  {
+    // wraps around when it goes down, which comes out right
+    const uint64_t delta = weight - weights[slot];
+    weights[slot]        = weight;
+    total += delta;
+    for(size_t idx = slot + 1; idx < tree.size(); idx += idx & -idx)
+      tree[idx] += delta;
+  }
+
+  /// sum of the first num weights
+  uint64_t
+  Prefix(size_t num) const
+  {
+    uint64_t sum = 0;
+    for(; num; num -= num & -num)
+      sum += tree[num];
+    return sum;
+  }
+
+  std::unordered_map< llarp::PubKey, size_t, llarp::PubKey::Hash > slots;
+  std::vector< llarp::PubKey > keys;
+  std::vector< uint64_t > weights;
+  /// 1 based
+  std::vector< uint64_t > tree = {0};
+  uint64_t total               = 0;
+};
 
 struct llarp_nodedb
 {
@@ -26,15 +272,95 @@ struct llarp_nodedb
   std::unordered_map< llarp::PubKey, llarp::RouterContact, llarp::PubKey::Hash >
       entries;
   fs::path nodePath;
+  /// false once we know there is no snapshot in nodePath, one may be left
+  /// over from an earlier run until then
+  bool snapshotMayExist = true;
+  /// rc waiting to be written by the next flush
+  std::unordered_map< llarp::PubKey, llarp::RouterContact,
+                      llarp::PubKey::Hash >
+      dirty;
+  /// hash of the encoded rc in each file we know is up to date
+  std::unordered_map< llarp::PubKey, llarp::ShortHash, llarp::PubKey::Hash >
+      onDisk;
+  /// flushes go here if set, otherwise Insert writes right away
+  llarp_threadpool *disk = nullptr;
+  bool flushQueued       = false;
+  /// held for a whole flush, taken before access
+  llarp::util::Mutex flushAccess;
+  /// routers with addresses, the ones we use as path hops
+  HopSampler hops;
+  llarp_nodedb_hop_weight_func hopWeight;
+
+  /// access must be held
+  void
+  InsertEntry(const llarp::RouterContact &rc)
+  {
+    auto &entry = entries[rc.pubkey];
+    entry       = rc;
+    UpdateHop(entry);
+  }
+
+  /// access must be held
+  void
+  UpdateHop(const llarp::RouterContact &rc)
+  {
+    if(rc.addrs.size())
+      hops.Put(rc.pubkey, hopWeight ? hopWeight(rc) : 1);
+    else
+      hops.Remove(rc.pubkey);
+  }
+
+  void
+  SetHopWeight(llarp_nodedb_hop_weight_func func)
+  {
+    llarp::util::Lock lock(access);
+    hopWeight = func;
+    for(const auto &item : entries)
+      UpdateHop(item.second);
+  }
+
+  void
+  UpdateHopWeight(const llarp::PubKey &pk)
+  {
+    llarp::util::Lock lock(access);
+    auto itr = entries.find(pk);
+    if(itr != entries.end())
+      UpdateHop(itr->second);
+  }
+
+  /// pick a hop by weight that isn't prev
+  bool
+  SelectHop(const llarp::RouterContact &prev, llarp::RouterContact &result)
+  {
+    llarp::util::Lock lock(access);
+    if(entries.size() < 3)
+      return false;
+    size_t tries = 5;
+    llarp::PubKey pk;
+    while(tries-- && hops.Pick(pk))
+    {
+      if(pk == prev.pubkey)
+        continue;
+      result = entries[pk];
+      return true;
+    }
+    return false;
+  }
 
   bool
   Remove(const llarp::PubKey &pk)
   {
+    // so a flush in progress can't put the file back
+    llarp::util::Lock flushLock(flushAccess);
     llarp::util::Lock lock(access);
     auto itr = entries.find(pk);
     if(itr == entries.end())
       return false;
     entries.erase(itr);
+    dirty.erase(pk);
+    onDisk.erase(pk);
+    hops.Remove(pk);
+    DropSnapshot();
     fs::remove(fs::path(getRCFilePath(pk)));
     return true;
   }
@@ -44,6 +370,9 @@ struct llarp_nodedb
   {
     llarp::util::Lock lock(access);
     entries.clear();
+    dirty.clear();
+    onDisk.clear();
+    hops.Clear();
   }
 
   bool
@@ -78,71 +407,176 @@ struct llarp_nodedb
     return filepath.string();
   }
 
-  /// insert and write to disk
+  /// insert and write to disk later on the disk thread
   bool
   Insert(const llarp::RouterContact &rc)
   {
-    byte_t tmp[MAX_RC_SIZE];
-    auto buf = llarp::StackBuffer< decltype(tmp) >(tmp);
     {
       llarp::util::Lock lock(access);
-      entries.insert(std::make_pair(rc.pubkey, rc));
+      InsertEntry(rc);
+      DropSnapshot();
+      dirty[rc.pubkey] = rc;
+      if(disk)
+      {
+        if(!flushQueued)
+        {
+          flushQueued = true;
+          llarp_threadpool_queue_job(disk, {this, &HandleFlush});
+        }
+        return true;
+      }
     }
-    if(!rc.BEncode(&buf))
-      return false;
+    return Flush();
+  }
+
+  static void
+  HandleFlush(void *user)
+  {
+    static_cast< llarp_nodedb * >(user)->Flush();
+  }
+
+  /// write every dirty rc whose encoding changed since we last wrote it
+  /// each goes to a temp file first and is renamed over the old one
+  bool
+  Flush()
+  {
+    llarp::util::Lock flushLock(flushAccess);
+    std::vector< llarp::RouterContact > batch;
+    {
+      llarp::util::Lock lock(access);
+      flushQueued = false;
+      batch.reserve(dirty.size());
+      for(auto &item : dirty)
+        batch.emplace_back(item.second);
+      dirty.clear();
+    }
+    bool ok        = true;
+    size_t written = 0;
+    for(const auto &rc : batch)
+    {
+      byte_t tmp[MAX_RC_SIZE];
+      auto buf = llarp::StackBuffer< decltype(tmp) >(tmp);
+      llarp::ShortHash h;
+      if(!EncodeRC(crypto, rc, buf, h))
+      {
+        ok = false;
+        continue;
+      }
+      {
+        llarp::util::Lock lock(access);
+        auto itr = onDisk.find(rc.pubkey);
+        if(itr != onDisk.end() && itr->second == h)
+          continue;
+      }
+      const std::string filepath = getRCFilePath(rc.pubkey);
+      if(!WriteAtomic(filepath, buf))
+      {
+        ok = false;
+        continue;
+      }
+      ++written;
+      llarp::util::Lock lock(access);
+      onDisk[rc.pubkey] = h;
+    }
+    if(batch.size())
+      llarp::LogDebug("flushed ", written, " of ", batch.size(), " RC");
+    return ok;
+  }
 
-    buf.sz        = buf.cur - buf.base;
-    auto filepath = getRCFilePath(rc.pubkey);
-    llarp::LogDebug("saving RC.pubkey ", filepath);
-    std::ofstream ofs(
-        filepath,
-        std::ofstream::out & std::ofstream::binary & std::ofstream::trunc);
-    ofs.write((char *)buf.base, buf.sz);
-    ofs.close();
-    if(!ofs)
-    {
-      llarp::LogError("Failed to write: ", filepath);
+  static bool
+  WriteAtomic(const std::string &filepath, llarp_buffer_t buf)
+  {
+    const std::string tmppath = filepath + ".tmp";
+    {
+      std::ofstream ofs(tmppath,
+                        std::ofstream::out | std::ofstream::binary
+                            | std::ofstream::trunc);
+      ofs.write((char *)buf.base, buf.sz);
+      ofs.close();
+      if(!ofs)
+      {
+        llarp::LogError("Failed to write: ", tmppath);
+        return false;
+      }
+    }
+#ifdef _WIN32
+    // rename does not replace on windows
+    std::remove(filepath.c_str());
+#endif
+    if(std::rename(tmppath.c_str(), filepath.c_str()) == -1)
+    {
+      llarp::LogError("Failed to write: ", filepath, " ", strerror(errno));
+      std::remove(tmppath.c_str());
       return false;
     }
-    llarp::LogDebug("saved RC.pubkey: ", filepath);
     return true;
   }
 
+  /// load everything at path, reading and verifying the rc files on worker
+  /// if we have one, a good snapshot is used instead of the files
   ssize_t
-  Load(const fs::path &path)
+  Load(const fs::path &path, llarp_threadpool *worker)
   {
     std::error_code ec;
     if(!fs::exists(path, ec))
     {
       return -1;
     }
-    ssize_t loaded = 0;
+    ssize_t loaded = LoadSnapshot(path, worker);
+    if(loaded >= 0)
+      return loaded;
+    loaded = 0;
 
+    std::vector< fs::path > files;
     for(const char &ch : skiplist_subdirs)
     {
       if(!ch)
         continue;
       std::string p;
       p += ch;
-      fs::path sub = path / p;
+      llarp::util::IterDir(path / p, [&](const fs::path &f) -> bool {
+        if(f.extension() == RC_FILE_EXT)
+          files.emplace_back(f);
+        return true;
+      });
+    }
 
-      ssize_t l = loadSubdir(sub);
-      if(l > 0)
-        loaded += l;
+    std::vector< LoadBatch > batches((files.size() + FilesPerBatch - 1)
+                                     / FilesPerBatch);
+    LoadWait wait;
+    wait.pending = batches.size();
+    for(size_t idx = 0; idx < batches.size(); ++idx)
+    {
+      const size_t end = std::min(files.size(), (idx + 1) * FilesPerBatch);
+      auto &batch      = batches[idx];
+      batch.crypto     = crypto;
+      batch.wait       = &wait;
+      batch.begin      = files.data() + idx * FilesPerBatch;
+      batch.end        = files.data() + end;
+      if(worker)
+        llarp_threadpool_queue_job(worker, {&batch, &HandleLoadBatch});
+      else
+        HandleLoadBatch(&batch);
+    }
+    {
+      llarp::util::Lock lock(wait.access);
+      wait.done.WaitUntil(lock, [&]() -> bool { return wait.pending == 0; });
     }
-    return loaded;
-  }
 
-  ssize_t
-  loadSubdir(const fs::path &dir)
-  {
-    ssize_t sz = 0;
-    llarp::util::IterDir(dir, [&](const fs::path &f) -> bool {
-      if(fs::is_regular_file(f) && loadfile(f))
-        sz++;
-      return true;
-    });
-    return sz;
+    llarp::util::Lock lock(access);
+    // whatever snapshot is there did not get used
+    DropSnapshot();
+    entries.reserve(entries.size() + files.size());
+    for(auto &batch : batches)
+    {
+      for(size_t idx = 0; idx < batch.loaded.size(); ++idx)
+      {
+        InsertEntry(batch.loaded[idx]);
+        onDisk[batch.loaded[idx].pubkey] = batch.hashes[idx];
+        ++loaded;
+      }
+    }
+    return loaded;
   }
 
   bool
@@ -163,8 +597,202 @@ struct llarp_nodedb
     }
     {
       llarp::util::Lock lock(access);
-      entries.insert(std::make_pair(rc.pubkey, rc));
+      InsertEntry(rc);
+    }
+    return true;
+  }
+
+  /// remove the snapshot once entries change so we don't load a stale one,
+  /// access must be held
+  void
+  DropSnapshot()
+  {
+    if(!snapshotMayExist)
+      return;
+    snapshotMayExist = false;
+    std::error_code ec;
+    fs::remove(nodePath / SNAPSHOT_FILE, ec);
+  }
+
+  /// load every rc from the snapshot in dir, verifying them on worker if we
+  /// have one
+  /// return -1 if there is none, it is older than the rc files or anything
+  /// in it is bad
+  ssize_t
+  LoadSnapshot(const fs::path &dir, llarp_threadpool *worker)
+  {
+    const std::string fpath = (dir / SNAPSHOT_FILE).string();
+    struct stat st;
+    if(stat(fpath.c_str(), &st) == -1)
+      return -1;
+    // something put rc files in by hand since we wrote it, the fs clock is
+    // coarse so a flush right before the snapshot can have the same time
+    const uint64_t written = ModifiedNS(fpath);
+    for(const char &ch : skiplist_subdirs)
+    {
+      if(!ch)
+        continue;
+      std::string p;
+      p += ch;
+      if(ModifiedNS((dir / p).string()) > written)
+      {
+        llarp::LogInfo("ignoring out of date snapshot ", fpath);
+        return -1;
+      }
+    }
+    const byte_t *data = nullptr;
+    size_t sz          = st.st_size;
+#ifndef _WIN32
+    int fd = open(fpath.c_str(), O_RDONLY);
+    if(fd == -1)
+      return -1;
+    void *ptr = sz ? mmap(nullptr, sz, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    close(fd);
+    if(ptr == MAP_FAILED)
+      return -1;
+    data = static_cast< const byte_t * >(ptr);
+#else
+    std::vector< byte_t > copy;
+    {
+      std::ifstream f(fpath, std::ios::binary);
+      copy.resize(sz);
+      if(!f.read((char *)copy.data(), sz))
+        return -1;
+      data = copy.data();
+    }
+#endif
+    ssize_t loaded = LoadSnapshot(data, sz, worker);
+#ifndef _WIN32
+    if(ptr)
+      munmap(ptr, sz);
+#endif
+    if(loaded < 0)
+      llarp::LogWarn("bad snapshot ", fpath);
+    return loaded;
+  }
+
+  /// records are a big endian uint16 size then the encoded rc, every one
+  /// gets its signature checked like the rc files do since anyone who can
+  /// write the snapshot could put anything in it
+  ssize_t
+  LoadSnapshot(const byte_t *data, size_t sz, llarp_threadpool *worker)
+  {
+    if(sz < SNAPSHOT_HEADER_SIZE
+       || memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)))
+      return -1;
+    uint32_t count;
+    memcpy(&count, data + sizeof(SNAPSHOT_MAGIC), 4);
+    count = be32toh(count);
+    if((sz - SNAPSHOT_HEADER_SIZE) / 2 < count)
+      return -1;
+    const byte_t *end = data + sz;
+    const byte_t *cur = data + SNAPSHOT_HEADER_SIZE;
+
+    std::vector< llarp::RouterContact > loaded(count);
+    std::vector< llarp::ShortHash > hashes(count);
+    for(uint32_t idx = 0; idx < count; ++idx)
+    {
+      uint16_t len;
+      if(end - cur < 2)
+        return -1;
+      memcpy(&len, cur, 2);
+      len = be16toh(len);
+      cur += 2;
+      if(end - cur < len || len > MAX_RC_SIZE)
+        return -1;
+      byte_t tmp[MAX_RC_SIZE];
+      memcpy(tmp, cur, len);
+      cur += len;
+      auto buf = llarp::InitBuffer(tmp, len);
+      if(!crypto->shorthash(hashes[idx], buf))
+        return -1;
+      if(!loaded[idx].BDecode(&buf))
+        return -1;
+    }
+    if(cur != end)
+      return -1;
+
+    std::vector< VerifyBatch > batches((count + RCsPerBatch - 1)
+                                       / RCsPerBatch);
+    LoadWait wait;
+    wait.pending = batches.size();
+    for(size_t idx = 0; idx < batches.size(); ++idx)
+    {
+      auto &batch  = batches[idx];
+      batch.crypto = crypto;
+      batch.wait   = &wait;
+      batch.begin  = loaded.data() + idx * RCsPerBatch;
+      batch.end    = loaded.data()
+          + std::min< size_t >(count, (idx + 1) * RCsPerBatch);
+      if(worker)
+        llarp_threadpool_queue_job(worker, {&batch, &HandleVerifyBatch});
+      else
+        HandleVerifyBatch(&batch);
+    }
+    {
+      llarp::util::Lock lock(wait.access);
+      wait.done.WaitUntil(lock, [&]() -> bool { return wait.pending == 0; });
+    }
+    size_t bad = 0;
+    for(const auto &batch : batches)
+      bad += batch.bad;
+    if(bad)
+    {
+      llarp::LogWarn(bad, " rc in snapshot did not verify");
+      return -1;
+    }
+
+    llarp::util::Lock lock(access);
+    entries.reserve(entries.size() + count);
+    for(uint32_t idx = 0; idx < count; ++idx)
+    {
+      InsertEntry(loaded[idx]);
+      onDisk[loaded[idx].pubkey] = hashes[idx];
+    }
+    return count;
+  }
+
+  /// pack every rc into one file next to the skiplist, after writing what
+  /// is still dirty so the rc files are not newer than it
+  bool
+  WriteSnapshot()
+  {
+    const fs::path fpath   = nodePath / SNAPSHOT_FILE;
+    const fs::path tmppath = nodePath / (SNAPSHOT_FILE + ".tmp");
+    if(!Flush())
+      return false;
+    llarp::util::Lock lock(access);
+    {
+      std::ofstream ofs(tmppath.string(),
+                        std::ofstream::out | std::ofstream::binary
+                            | std::ofstream::trunc);
+      uint32_t count = htobe32(entries.size());
+      ofs.write((const char *)SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+      ofs.write((const char *)&count, sizeof(count));
+      for(const auto &item : entries)
+      {
+        byte_t tmp[MAX_RC_SIZE];
+        auto buf = llarp::StackBuffer< decltype(tmp) >(tmp);
+        if(!item.second.BEncode(&buf))
+          return false;
+        buf.sz       = buf.cur - buf.base;
+        uint16_t len = htobe16(buf.sz);
+        ofs.write((const char *)&len, sizeof(len));
+        ofs.write((const char *)buf.base, buf.sz);
+      }
+      ofs.close();
+      if(!ofs)
+      {
+        llarp::LogError("Failed to write: ", tmppath);
+        return false;
+      }
+    }
+    if(std::rename(tmppath.string().c_str(), fpath.string().c_str()) == -1)
+    {
+      llarp::LogError("Failed to write: ", fpath, " ", strerror(errno));
+      return false;
     }
+    snapshotMayExist = true;
     return true;
   }
 
@@ -295,6 +923,7 @@ llarp_nodedb_free(struct llarp_nodedb **n)
   {
     auto i = *n;
     *n     = nullptr;
+    i->Flush();
     i->Clear();
     delete i;
   }
@@ -353,7 +982,40 @@ llarp_nodedb_load_dir(struct llarp_nodedb *n, const char *dir)
     return -1;
   }
   llarp_nodedb_set_dir(n, dir);
-  return n->Load(dir);
+  return n->Load(dir, nullptr);
+}
+
+ssize_t
+llarp_nodedb_load_dir_parallel(struct llarp_nodedb *n, const char *dir,
+                               struct llarp_threadpool *worker)
+{
+  std::error_code ec;
+  if(!fs::exists(dir, ec))
+  {
+    return -1;
+  }
+  llarp_nodedb_set_dir(n, dir);
+  return n->Load(dir, worker);
+}
+
+void
+llarp_nodedb_set_disk_worker(struct llarp_nodedb *n,
+                             struct llarp_threadpool *disk)
+{
+  llarp::util::Lock lock(n->access);
+  n->disk = disk;
+}
+
+bool
+llarp_nodedb_flush(struct llarp_nodedb *n)
+{
+  return n->Flush();
+}
+
+bool
+llarp_nodedb_write_snapshot(struct llarp_nodedb *n)
+{
+  return n->WriteSnapshot();
 }
 
 int
@@ -418,45 +1080,20 @@ llarp_nodedb_select_random_hop(struct llarp_nodedb *n,
 {
   /// checking for "guard" status for N = 0 is done by caller inside of
   /// pathbuilder's scope
-  auto sz = n->entries.size();
-  if(sz < 3)
-    return false;
-  size_t tries = 5;
-  if(N)
-  {
-    do
-    {
-      auto itr = n->entries.begin();
-      if(sz > 1)
-      {
-        auto idx = llarp_randint() % sz;
-        if(idx)
-          std::advance(itr, idx - 1);
-      }
-      if(prev.pubkey == itr->second.pubkey)
-      {
-        if(tries--)
-          continue;
-        return false;
-      }
-      if(itr->second.addrs.size())
-      {
-        result = itr->second;
-        return true;
-      }
-    } while(tries--);
-    return false;
-  }
-  else
-  {
-    auto itr = n->entries.begin();
-    if(sz > 1)
-    {
-      auto idx = llarp_randint() % sz;
-      if(idx)
-        std::advance(itr, idx - 1);
-    }
-    result = itr->second;
-    return true;
-  }
+  (void)N;
+  return n->SelectHop(prev, result);
+}
+
+void
+llarp_nodedb_set_hop_weight_func(struct llarp_nodedb *n,
+                                 llarp_nodedb_hop_weight_func func)
+{
+  n->SetHopWeight(func);
+}
+
+void
+llarp_nodedb_update_hop_weight(struct llarp_nodedb *n,
+                               const llarp::RouterID &pk)
+{
+  n->UpdateHopWeight(pk);
 }
@@ -0,0 +1,128 @@
+#include <llarp/buffer.hpp>
+#include <llarp/packet_buffer.hpp>
+
+namespace llarp
+{
+  void
+  PacketRef::reset()
+  {
+    if(m_Buf && --m_Buf->refs == 0)
+      m_Buf->pool->Put(m_Buf);
+    m_Buf = nullptr;
+  }
+
+  PacketPool::PacketPool(size_t maxFree)
+      : m_MaxFree(maxFree), m_InUse(0), m_Allocations(0)
+  {
+  }
+
+  PacketPool::~PacketPool()
+  {
+    for(auto buf : m_Free)
+      delete buf;
+  }
+
+  PacketPool&
+  PacketPool::Global()
+  {
+    // never destroyed so buffers released during static teardown are safe
+    static PacketPool* pool = new PacketPool();
+    return *pool;
+  }
+
+  PacketRef
+  PacketPool::Get()
+  {
+    PacketBuffer* buf = nullptr;
+    {
+      util::Lock lock(m_Access);
+      if(m_Free.size())
+      {
+        buf = m_Free.back();
+        m_Free.pop_back();
+      }
+    }
+    if(buf == nullptr)
+    {
+      buf       = new PacketBuffer();
+      buf->pool = this;
+      ++m_Allocations;
+    }
+    ++m_InUse;
+    return PacketRef(buf);
+  }
+
+  void
+  PacketPool::Put(PacketBuffer* buf)
+  {
+    --m_InUse;
+    {
+      util::Lock lock(m_Access);
+      if(m_Free.size() < m_MaxFree)
+      {
+        m_Free.push_back(buf);
+        return;
+      }
+    }
+    delete buf;
+  }
+
+  void
+  PacketSlice::Share(const PacketRef& pkt, byte_t* ptr, size_t len)
+  {
+    packet = pkt;
+    base   = ptr;
+    sz     = len;
+  }
+
+  void
+  PacketSlice::Borrow(const llarp_buffer_t& buf)
+  {
+    packet.reset();
+    base = buf.base;
+    sz   = buf.sz;
+  }
+
+  bool
+  PacketSlice::Copy(const llarp_buffer_t& buf)
+  {
+    if(buf.sz > PacketRef::capacity())
+      return false;
+    packet = PacketPool::Global().Get();
+    base   = packet.data();
+    sz     = buf.sz;
+    if(sz)
+      memcpy(base, buf.base, sz);
+    return true;
+  }
+
+  void
+  PacketSlice::Clear()
+  {
+    packet.reset();
+    base = nullptr;
+    sz   = 0;
+  }
+
+  bool
+  PacketSlice::BDecode(llarp_buffer_t* buf, const PacketRef& src)
+  {
+    llarp_buffer_t strbuf;
+    if(!bencode_read_string(buf, &strbuf))
+      return false;
+    if(strbuf.sz == 0)
+      return false;
+    if(src.Contains(strbuf.base, strbuf.sz))
+    {
+      Share(src, strbuf.base, strbuf.sz);
+      return true;
+    }
+    return Copy(strbuf);
+  }
+
+  llarp_buffer_t
+  PacketSlice::Buffer() const
+  {
+    return InitBuffer(base, sz);
+  }
+}  // namespace llarp
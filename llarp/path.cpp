@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <deque>
 #include <llarp/encrypted_frame.hpp>
 #include <llarp/path.hpp>
@@ -12,12 +13,16 @@ namespace llarp
   namespace path
   {
     PathContext::PathContext(llarp_router* router)
-        : m_Router(router), m_AllowTransit(false)
+        : m_Router(router)
+        , m_AllowTransit(false)
+        , m_Relay([&](RelayPipeline::Job& job) { HandleRelayed(job); })
     {
     }
 
     PathContext::~PathContext()
     {
+      for(auto hop : m_RetiredHops)
+        delete hop;
     }
 
     void
@@ -63,12 +68,11 @@ namespace llarp
     }
 
     bool
-    PathContext::ForwardLRCM(const RouterID& nextHop,
-                             const std::array< EncryptedFrame, 8 >& frames)
+    PathContext::ForwardLRCM(const RouterID& nextHop, LR_CommitFrames frames)
     {
       llarp::LogDebug("fowarding LRCM to ", nextHop);
       LR_CommitMessage msg;
-      msg.frames = frames;
+      msg.frames = std::move(frames);
       return m_Router->SendToOrQueue(nextHop, &msg);
     }
     template < typename Map_t, typename Key_t, typename CheckValue_t,
@@ -143,9 +147,52 @@ namespace llarp
     bool
     PathContext::HasTransitHop(const TransitHopInfo& info)
     {
-      return MapHas(m_TransitPaths, info.txID, [info](TransitHop* hop) -> bool {
-        return info == hop->info;
-      });
+      return GetTransitHop(info) != nullptr;
+    }
+
+    TransitHop*
+    PathContext::GetTransitHop(const TransitHopInfo& info)
+    {
+      return m_TransitPaths.Find(info.txID,
+                                 [info](const TransitHop* hop) -> bool {
+                                   return info == hop->info;
+                                 });
+    }
+
+    void
+    PathContext::HandleRelayed(RelayPipeline::Job& job)
+    {
+      const auto& info = job.info;
+      if(!job.upstream)
+      {
+        RelayDownstreamMessage msg;
+        msg.pathid = info.rxID;
+        msg.Y      = job.nextY;
+        msg.X      = job.X;
+        llarp::LogDebug("relay ", msg.X.size(), " bytes downstream from ",
+                        info.upstream, " to ", info.downstream);
+        m_Router->SendToOrQueue(info.downstream, &msg);
+      }
+      else if(info.upstream == RouterID(m_Router->pubkey()))
+      {
+        // the hop may have expired while the crypto was in flight
+        auto hop = GetTransitHop(info);
+        if(hop == nullptr)
+          return;
+        if(!hop->m_MessageParser.ParseMessageBuffer(job.X.Buffer(), hop,
+                                                    info.rxID, m_Router))
+          llarp::LogWarn("failed to parse routing message on ", info);
+      }
+      else
+      {
+        RelayUpstreamMessage msg;
+        msg.pathid = info.txID;
+        msg.Y      = job.nextY;
+        msg.X      = job.X;
+        llarp::LogDebug("relay ", msg.X.size(), " bytes upstream from ",
+                        info.downstream, " to ", info.upstream);
+        m_Router->SendToOrQueue(info.upstream, &msg);
+      }
     }
 
     IHopHandler*
@@ -162,21 +209,17 @@ namespace llarp
       if(own)
         return own;
 
-      return MapGet(m_TransitPaths, id,
-                    [remote](const TransitHop* hop) -> bool {
-                      return hop->info.upstream == remote;
-                    },
-                    [](TransitHop* h) -> IHopHandler* { return h; });
+      return m_TransitPaths.Find(id, [remote](const TransitHop* hop) -> bool {
+        return hop->info.upstream == remote;
+      });
     }
 
     IHopHandler*
     PathContext::GetByDownstream(const RouterID& remote, const PathID_t& id)
     {
-      return MapGet(m_TransitPaths, id,
-                    [remote](const TransitHop* hop) -> bool {
-                      return hop->info.downstream == remote;
-                    },
-                    [](TransitHop* h) -> IHopHandler* { return h; });
+      return m_TransitPaths.Find(id, [remote](const TransitHop* hop) -> bool {
+        return hop->info.downstream == remote;
+      });
     }
 
     PathSet*
@@ -207,33 +250,34 @@ namespace llarp
     void
     PathContext::PutTransitHop(TransitHop* hop)
     {
-      MapPut(m_TransitPaths, hop->info.txID, hop);
-      MapPut(m_TransitPaths, hop->info.rxID, hop);
+      m_TransitPaths.Insert(hop->info.txID, hop);
+      m_TransitPaths.Insert(hop->info.rxID, hop);
+      util::Lock lock(m_TransitExpiry.first);
+      m_TransitExpiry.second.emplace(hop->ExpireTime(), hop);
     }
 
     void
     PathContext::ExpirePaths()
     {
-      util::Lock lock(m_TransitPaths.first);
-      auto now  = llarp_time_now_ms();
-      auto& map = m_TransitPaths.second;
-      auto itr  = map.begin();
-      std::set< TransitHop* > removePaths;
-      while(itr != map.end())
+      auto now = llarp_time_now_ms();
       {
-        if(itr->second->Expired(now))
+        util::Lock lock(m_TransitExpiry.first);
+        auto& heap = m_TransitExpiry.second;
+        // lookups off the logic thread take no lock and can still hold what
+        // we took out of the index last tick, so it goes only now
+        for(auto hop : m_RetiredHops)
+          delete hop;
+        m_RetiredHops.clear();
+        // hops never outlive the expire time they went in with
+        while(heap.size() && heap.top().first < now)
         {
-          TransitHop* path = itr->second;
-          llarp::LogDebug("transit path expired ", path->info);
-          removePaths.insert(path);
+          TransitHop* hop = heap.top().second;
+          heap.pop();
+          llarp::LogDebug("transit path expired ", hop->info);
+          m_TransitPaths.Remove(hop->info.txID, hop);
+          m_TransitPaths.Remove(hop->info.rxID, hop);
+          m_RetiredHops.push_back(hop);
         }
-        ++itr;
-      }
-      for(auto& p : removePaths)
-      {
-        map.erase(p->info.txID);
-        map.erase(p->info.rxID);
-        delete p;
       }
       for(auto& builder : m_PathBuilders)
       {
@@ -242,16 +286,99 @@ namespace llarp
       }
     }
 
+    size_t
+    PathBuildBudget::Take(llarp_time_t now, size_t want, size_t building)
+    {
+      size_t num = want;
+      if(maxBuilding)
+        num = building < maxBuilding ? std::min(num, maxBuilding - building)
+                                     : 0;
+      if(rate)
+      {
+        const uint64_t most = std::max(burst, size_t(1)) * 1000;
+        if(m_Last == 0)
+          m_Credit = most;
+        else if(now > m_Last)
+          m_Credit = std::min(most, m_Credit + (now - m_Last) * rate);
+        m_Last = now;
+        num    = std::min(num, size_t(m_Credit / 1000));
+        m_Credit -= num * 1000;
+      }
+      started += num;
+      deferred += want - num;
+      return num;
+    }
+
+    void
+    PathBuildBudget::Refund(size_t num)
+    {
+      started -= num;
+      if(rate)
+        m_Credit += num * 1000;
+    }
+
     void
     PathContext::BuildPaths()
     {
+      auto now = llarp_time_now_ms();
+      std::vector< std::pair< Builder*, size_t > > wants;
+      size_t want     = 0;
+      size_t building = 0;
       for(auto& builder : m_PathBuilders)
       {
-        if(builder->ShouldBuildMore())
+        building += builder->NumInStatus(ePathBuilding);
+        size_t num = builder->NumPathsWanted(now);
+        if(num == 0 && builder->ShouldBuildMore())
+          num = 1;
+        if(num == 0)
+          continue;
+        wants.emplace_back(builder, num);
+        want += num;
+      }
+      size_t num = buildBudget.Take(now, want, building);
+      if(num < want)
+        llarp::LogDebug("path build budget allows ", num, " of ", want,
+                        " builds with ", building, " building");
+      // take turns so one builder wanting many does not starve the rest,
+      // and whoever went first last time goes later this time
+      const size_t first = m_NextBuilder++;
+      bool progress      = true;
+      while(num && progress)
+      {
+        progress = false;
+        for(size_t idx = 0; idx < wants.size() && num; ++idx)
         {
-          builder->BuildOne();
+          auto& item = wants[(first + idx) % wants.size()];
+          if(item.second == 0)
+            continue;
+          // no point trying again this tick if it could not pick hops
+          if(item.first->BuildOne())
+          {
+            --item.second;
+            --num;
+            progress = true;
+          }
+          else
+            item.second = 0;
         }
       }
+      buildBudget.Refund(num);
+    }
+
+    PathBuildStats
+    PathContext::BuildStats() const
+    {
+      PathBuildStats st;
+      st.builders = m_PathBuilders.size();
+      for(const auto& builder : m_PathBuilders)
+      {
+        st.building += builder->NumInStatus(ePathBuilding);
+        st.established += builder->NumInStatus(ePathEstablished);
+        st.ready.Add(builder->ReadyStats());
+      }
+      st.started  = buildBudget.started;
+      st.deferred = buildBudget.deferred;
+      return st;
     }
 
     void
@@ -274,17 +401,9 @@ namespace llarp
       if(h)
         return h;
       RouterID us(OurRouterID());
-      auto& map = m_TransitPaths;
-      {
-        util::Lock lock(map.first);
-        auto range = map.second.equal_range(id);
-        for(auto i = range.first; i != range.second; ++i)
-        {
-          if(i->second->info.upstream == us)
-            return i->second;
-        }
-      }
-      return nullptr;
+      return m_TransitPaths.Find(id, [us](const TransitHop* hop) -> bool {
+        return hop->info.upstream == us;
+      });
     }
 
     void
@@ -424,8 +543,16 @@ namespace llarp
         latency.T             = llarp_randint();
         m_LastLatencyTestID   = latency.T;
         m_LastLatencyTestTime = now;
+        m_LatencyTestLost     = false;
         SendRoutingMessage(&latency, r);
       }
+      else if(m_LastLatencyTestID && !m_LatencyTestLost
+              && dlt > quality.BaseCost())
+      {
+        // the probe is overdue, count it once
+        quality.Lost();
+        m_LatencyTestLost = true;
+      }
       // check to see if this path is dead
       if(_status == ePathEstablished
          && (now > m_LastRecvMessage && now - m_LastRecvMessage > 1000))
@@ -434,6 +561,7 @@ namespace llarp
         {
           if(m_CheckForDead(this, dlt))
           {
+            quality.Lost();
             r->routerProfiling.MarkPathFail(this);
             EnterState(ePathTimeout);
           }
@@ -446,18 +574,42 @@ namespace llarp
       }
     }
 
+    /// every hop's layer in one pass, going down each hop mutates the nonce
+    /// before its layer and going up after
+    static bool
+    CryptHops(llarp_crypto* crypto, llarp_buffer_t buf, const TunnelNonce& Y,
+              const Path::HopList& hops, bool downstream)
+    {
+      const byte_t* keys[MAXHOPS];
+      const byte_t* nonces[MAXHOPS];
+      TunnelNonce n[MAXHOPS];
+      if(hops.size() > MAXHOPS)
+        return false;
+      TunnelNonce next = Y;
+      for(size_t idx = 0; idx < hops.size(); ++idx)
+      {
+        if(downstream)
+          next ^= hops[idx].nonceXOR;
+        n[idx]      = next;
+        keys[idx]   = hops[idx].shared;
+        nonces[idx] = n[idx];
+        if(!downstream)
+          next ^= hops[idx].nonceXOR;
+      }
+      return crypto->xchacha20_layers(buf, keys, nonces, hops.size());
+    }
+
     bool
-    Path::HandleUpstream(llarp_buffer_t buf, const TunnelNonce& Y,
+    Path::HandleUpstream(const PacketSlice& X, const TunnelNonce& Y,
                          llarp_router* r)
     {
-      TunnelNonce n = Y;
-      for(const auto& hop : hops)
+      if(!CryptHops(&r->crypto, X.Buffer(), Y, hops, false))
       {
-        r->crypto.xchacha20(buf, hop.shared, n);
-        n ^= hop.nonceXOR;
+        llarp::LogError("failed to encrypt upstream on ", Name());
+        return false;
       }
       RelayUpstreamMessage msg;
-      msg.X      = buf;
+      msg.X      = X;
       msg.Y      = Y;
       msg.pathid = TXID();
       if(r->SendToOrQueue(Upstream(), &msg))
@@ -486,14 +638,14 @@ namespace llarp
     }
 
     bool
-    Path::HandleDownstream(llarp_buffer_t buf, const TunnelNonce& Y,
+    Path::HandleDownstream(const PacketSlice& X, const TunnelNonce& Y,
                            llarp_router* r)
     {
-      TunnelNonce n = Y;
-      for(const auto& hop : hops)
+      auto buf = X.Buffer();
+      if(!CryptHops(&r->crypto, buf, Y, hops, true))
       {
-        n ^= hop.nonceXOR;
-        r->crypto.xchacha20(buf, hop.shared, n);
+        llarp::LogError("failed to decrypt downstream on ", Name());
+        return false;
       }
       return HandleRoutingMessage(buf, r);
     }
@@ -532,8 +684,11 @@ namespace llarp
         r->crypto.randbytes(buf.cur, MESSAGE_PAD_SIZE - buf.sz);
         buf.sz = MESSAGE_PAD_SIZE;
       }
+      quality.Sent(buf.sz, llarp_time_now_ms());
       buf.cur = buf.base;
-      return HandleUpstream(buf, N, r);
+      PacketSlice X;
+      X.Borrow(buf);
+      return HandleUpstream(X, N, r);
     }
 
     bool
@@ -549,6 +704,7 @@ namespace llarp
     Path::HandleDataDiscardMessage(
         const llarp::routing::DataDiscardMessage* msg, llarp_router* r)
     {
+      quality.Lost();
       if(m_DropHandler)
         return m_DropHandler(this, msg->P, msg->S);
       return true;
@@ -611,8 +767,11 @@ namespace llarp
       if(msg->L == m_LastLatencyTestID && _status == ePathEstablished)
       {
         intro.latency = now - m_LastLatencyTestTime;
-        llarp::LogDebug("path latency is ", intro.latency,
-                        " ms for tx=", TXID(), " rx=", RXID());
+        quality.SampleRTT(intro.latency);
+        llarp::LogDebug("path latency is ", intro.latency, " ms, smoothed ",
+                        quality.srtt, " ms, loss ", quality.loss,
+                        " for tx=", TXID(), " rx=", RXID());
+        r->routerProfiling.MarkPathLatency(this, intro.latency);
         m_LastLatencyTestID = 0;
         return true;
       }
@@ -5,6 +5,9 @@
 #include "buffer.hpp"
 #include "router.hpp"
 
+#include <array>
+#include <atomic>
+
 namespace llarp
 {
   template < typename User >
@@ -17,12 +20,25 @@ namespace llarp
     typedef void (*Handler)(AsyncPathKeyExchangeContext< User >*);
     User* user               = nullptr;
     Handler result           = nullptr;
-    size_t idx               = 0;
     llarp_threadpool* worker = nullptr;
     llarp_logic* logic       = nullptr;
     llarp_crypto* crypto     = nullptr;
+    /// where ephemeral keypairs come from, null to make our own
+    KeypairPool* keys = nullptr;
     LR_CommitMessage LRCM;
 
+    /// hops still being worked on
+    std::atomic< size_t > pending{0};
+    std::atomic< bool > failed{false};
+
+    struct HopJob
+    {
+      AsyncPathKeyExchangeContext< User >* ctx;
+      size_t idx;
+    };
+
+    std::array< HopJob, MAXHOPS > jobs;
+
     static void
     HandleDone(void* u)
     {
@@ -31,31 +47,36 @@ namespace llarp
       ctx->result(ctx);
     }
 
-    static void
-    GenerateNextKey(void* u)
+    void
+    NewKeypair(SecretKey& k)
     {
-      AsyncPathKeyExchangeContext< User >* ctx =
-          static_cast< AsyncPathKeyExchangeContext< User >* >(u);
+      if(keys)
+        keys->Take(k);
+      else
+        crypto->encryption_keygen(k);
+    }
 
-      // current hop
-      auto& hop   = ctx->path->hops[ctx->idx];
-      auto& frame = ctx->LRCM.frames[ctx->idx];
+    /// make the keys and commit record for hop idx, each hop only touches
+    /// its own hop and frame so they all run at once
+    bool
+    GenerateHop(size_t idx)
+    {
+      auto& hop  = path->hops[idx];
+      auto frame = LRCM.frames.Frame(idx);
       // generate key
-      ctx->crypto->encryption_keygen(hop.commkey);
+      NewKeypair(hop.commkey);
       hop.nonce.Randomize();
       // do key exchange
-      if(!ctx->crypto->dh_client(hop.shared, hop.rc.enckey, hop.commkey,
-                                 hop.nonce))
+      if(!crypto->dh_client(hop.shared, hop.rc.enckey, hop.commkey,
+                            hop.nonce))
       {
         llarp::LogError("Failed to generate shared key for path build");
-        delete ctx;
-        return;
+        return false;
       }
       // generate nonceXOR valueself->hop->pathKey
-      ctx->crypto->shorthash(hop.nonceXOR, llarp::Buffer(hop.shared));
-      ++ctx->idx;
+      crypto->shorthash(hop.nonceXOR, llarp::Buffer(hop.shared));
 
-      bool isFarthestHop = ctx->idx == ctx->path->hops.size();
+      bool isFarthestHop = idx + 1 == path->hops.size();
 
       if(isFarthestHop)
       {
@@ -63,7 +84,7 @@ namespace llarp
       }
       else
       {
-        hop.upstream = ctx->path->hops[ctx->idx].rc.pubkey;
+        hop.upstream = path->hops[idx + 1].rc.pubkey;
       }
 
       // build record
@@ -75,39 +96,47 @@ namespace llarp
       record.nextHop     = hop.upstream;
       record.commkey     = llarp::seckey_topublic(hop.commkey);
 
-      auto buf = frame.Buffer();
-      buf->cur = buf->base + EncryptedFrame::OverheadSize;
+      auto buf = frame;
+      buf.cur  = buf.base + EncryptedFrame::OverheadSize;
       // encode record
-      if(!record.BEncode(buf))
+      if(!record.BEncode(&buf))
       {
         // failed to encode?
         llarp::LogError("Failed to generate Commit Record");
-        delete ctx;
-        return;
+        return false;
       }
       // use ephameral keypair for frame
       SecretKey framekey;
-      ctx->crypto->encryption_keygen(framekey);
-      if(!frame.EncryptInPlace(framekey, hop.rc.enckey, ctx->crypto))
+      NewKeypair(framekey);
+      bool ok =
+          EncryptedFrame::EncryptInPlace(frame, framekey, hop.rc.enckey, crypto);
+      framekey.Zero();
+      if(!ok)
       {
         llarp::LogError("Failed to encrypt LRCR");
-        delete ctx;
-        return;
+        return false;
       }
+      return true;
+    }
 
-      if(isFarthestHop)
-      {
-        // farthest hop
-        llarp_logic_queue_job(ctx->logic, {ctx, &HandleDone});
-      }
+    static void
+    GenerateKey(void* u)
+    {
+      HopJob* job = static_cast< HopJob* >(u);
+      auto ctx    = job->ctx;
+      if(!ctx->GenerateHop(job->idx))
+        ctx->failed = true;
+      // the last one done hands it on
+      if(--ctx->pending)
+        return;
+      if(ctx->failed)
+        delete ctx;
       else
-      {
-        // next hop
-        llarp_threadpool_queue_job(ctx->worker, {ctx, &GenerateNextKey});
-      }
+        llarp_logic_queue_job(ctx->logic, {ctx, &HandleDone});
     }
 
-    AsyncPathKeyExchangeContext(llarp_crypto* c) : crypto(c)
+    AsyncPathKeyExchangeContext(llarp_crypto* c, KeypairPool* k = nullptr)
+        : crypto(c), keys(k)
     {
     }
 
@@ -122,11 +151,14 @@ namespace llarp
       result = func;
       worker = pool;
 
-      for(size_t idx = 0; idx < MAXHOPS; ++idx)
+      LRCM.frames.Randomize();
+      const size_t numHops = path->hops.size();
+      pending              = numHops;
+      for(size_t idx = 0; idx < numHops; ++idx)
       {
-        LRCM.frames[idx].Randomize();
+        jobs[idx] = {this, idx};
+        llarp_threadpool_queue_job(pool, {&jobs[idx], &GenerateKey});
       }
-      llarp_threadpool_queue_job(pool, {this, &GenerateNextKey});
     }
   };
 
@@ -194,9 +226,14 @@ namespace llarp
           || router->NumberOfConnectedRouters() == 0;
     }
 
-    void
+    bool
     Builder::BuildOne()
     {
+      if(numHops == 0 || numHops > MAXHOPS)
+      {
+        llarp::LogError("cannot build a path with ", numHops, " hops");
+        return false;
+      }
       // select hops
       std::vector< RouterContact > hops;
       hops.resize(numHops);
@@ -208,7 +245,7 @@ namespace llarp
           if(!SelectHop(router->nodedb, hops[0], hops[0], 0))
           {
             llarp::LogError("failed to select first hop");
-            return;
+            return false;
           }
         }
         else
@@ -217,20 +254,25 @@ namespace llarp
           {
             /// TODO: handle this failure properly
             llarp::LogWarn("Failed to select hop ", idx);
-            return;
+            return false;
           }
         }
         ++idx;
       }
       // async generate keys
       AsyncPathKeyExchangeContext< Builder >* ctx =
-          new AsyncPathKeyExchangeContext< Builder >(&router->crypto);
+          new AsyncPathKeyExchangeContext< Builder >(&router->crypto,
+                                                     &router->ephemeralKeys);
       ctx->pathset = this;
       auto path    = new llarp::path::Path(hops);
-      path->SetBuildResultHook(std::bind(&llarp::path::PathSet::HandlePathBuilt,
-                                         ctx->pathset, std::placeholders::_1));
+      PathSet* set = this;
+      path->SetBuildResultHook([set](Path* p) {
+        set->PathEstablished(llarp_time_now_ms());
+        set->HandlePathBuilt(p);
+      });
       ctx->AsyncGenerateKeys(path, router->logic, router->tp, this,
                              &pathbuilder_generated_keys);
+      return true;
     }
 
     void
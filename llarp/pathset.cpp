@@ -3,18 +3,113 @@
 #include <llarp/path.hpp>
 #include <llarp/pathset.hpp>
 
+#include <algorithm>
+#include <cmath>
+
 namespace llarp
 {
   namespace path
   {
-    PathSet::PathSet(size_t num) : m_NumPaths(num)
+    void
+    PathQuality::SampleRTT(llarp_time_t rtt)
+    {
+      if(srtt == 0)
+      {
+        srtt   = rtt;
+        rttvar = rtt / 2;
+        return;
+      }
+      const llarp_time_t dlt = rtt > srtt ? rtt - srtt : srtt - rtt;
+      rttvar                 = (3 * rttvar + dlt) / 4;
+      srtt                   = (7 * srtt + rtt) / 8;
+    }
+
+    void
+    PathQuality::Sent(size_t sz, llarp_time_t now)
+    {
+      m_Inflight = InflightBytes(now) + sz;
+      m_LastSent = now;
+      loss -= loss / 64;
+    }
+
+    void
+    PathQuality::Lost()
+    {
+      loss += (1.0 - loss) / 64;
+    }
+
+    double
+    PathQuality::InflightBytes(llarp_time_t now) const
+    {
+      if(now <= m_LastSent)
+        return m_Inflight;
+      const double rtt = srtt ? double(srtt) : double(DefaultRTT);
+      return m_Inflight * std::exp(-double(now - m_LastSent) / rtt);
+    }
+
+    double
+    PathQuality::BaseCost() const
+    {
+      const double rtt = srtt ? srtt + 4 * rttvar : DefaultRTT;
+      return rtt / (1.0 - std::min(loss, 0.9));
+    }
+
+    double
+    PathQuality::Cost(llarp_time_t now) const
+    {
+      return BaseCost() * (1.0 + InflightBytes(now) / InflightScale);
+    }
+
+    PathSet::PathSet(size_t num)
+        : m_NumPaths(num), m_WaitingSince(llarp_time_now_ms())
     {
     }
 
     bool
     PathSet::ShouldBuildMore() const
     {
-      return m_Paths.size() < m_NumPaths;
+      return NumPathsWanted(llarp_time_now_ms()) > 0;
+    }
+
+    bool
+    PathSet::ShouldReplace(const Path* p, llarp_time_t now) const
+    {
+      if(p->_status != ePathEstablished)
+        return false;
+      llarp_time_t ahead = rebuildAhead;
+      // spread by path id so a batch built together is replaced bit by bit
+      if(rebuildAhead)
+        ahead += p->RXID().data_l()[0] % rebuildAhead;
+      // never so early that a new path is due for replacement right away
+      ahead = std::min(ahead, p->hops[0].lifetime / 2);
+      return now + ahead >= p->ExpireTime();
+    }
+
+    size_t
+    PathSet::NumPathsWanted(llarp_time_t now) const
+    {
+      size_t have = 0;
+      for(const auto& item : m_Paths)
+      {
+        const auto st = item.second->_status;
+        if(st == ePathBuilding
+           || (st == ePathEstablished && !ShouldReplace(item.second, now)))
+          ++have;
+      }
+      const size_t want = m_NumPaths + numSpare;
+      return have < want ? want - have : 0;
+    }
+
+    void
+    PathSet::PathEstablished(llarp_time_t now)
+    {
+      if(m_WaitingSince == 0)
+        return;
+      if(now > m_WaitingSince)
+        m_ReadyStats.Add(now - m_WaitingSince);
+      else
+        m_ReadyStats.Add(0);
+      m_WaitingSince = 0;
     }
 
     void
@@ -29,8 +124,6 @@ namespace llarp
     void
     PathSet::ExpirePaths(llarp_time_t now)
     {
-      if(m_Paths.size() == 0)
-        return;
       auto itr = m_Paths.begin();
       while(itr != m_Paths.end())
       {
@@ -42,6 +135,8 @@ namespace llarp
         else
           ++itr;
       }
+      if(m_WaitingSince == 0 && NumInStatus(ePathEstablished) == 0)
+        m_WaitingSince = now;
     }
 
     Path*
@@ -90,6 +185,7 @@ namespace llarp
     PathSet::GetPathByRouter(const RouterID& id) const
     {
       Path* chosen = nullptr;
+      double cost  = 0.0;
       auto itr     = m_Paths.begin();
       while(itr != m_Paths.end())
       {
@@ -97,10 +193,12 @@ namespace llarp
         {
           if(itr->second->Endpoint() == id)
           {
-            if(chosen == nullptr)
-              chosen = itr->second;
-            else if(chosen->intro.latency > itr->second->intro.latency)
+            const double c = itr->second->quality.BaseCost();
+            if(chosen == nullptr || c < cost)
+            {
               chosen = itr->second;
+              cost   = c;
+            }
           }
         }
         ++itr;
@@ -108,6 +206,36 @@ namespace llarp
       return chosen;
     }
 
+    Path*
+    PathSet::PickPathByRouter(const RouterID& id, llarp_time_t now) const
+    {
+      std::vector< std::pair< double, Path* > > best;
+      for(const auto& item : m_Paths)
+      {
+        if(item.second->IsReady() && item.second->Endpoint() == id)
+          best.emplace_back(item.second->quality.BaseCost(), item.second);
+      }
+      if(best.empty())
+        return nullptr;
+      if(stripeWidth && best.size() > stripeWidth)
+      {
+        std::nth_element(best.begin(), best.begin() + stripeWidth, best.end());
+        best.resize(stripeWidth);
+      }
+      Path* chosen = nullptr;
+      double cost  = 0.0;
+      for(const auto& item : best)
+      {
+        const double c = item.second->quality.Cost(now);
+        if(chosen == nullptr || c < cost)
+        {
+          chosen = item.second;
+          cost   = c;
+        }
+      }
+      return chosen;
+    }
+
     Path*
     PathSet::GetPathByID(const PathID_t& id) const
     {
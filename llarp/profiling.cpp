@@ -1,4 +1,5 @@
 #include <llarp/profiling.hpp>
+#include <algorithm>
 #include <fstream>
 
 namespace llarp
@@ -11,6 +12,8 @@ namespace llarp
 
     if(!BEncodeWriteDictInt("g", connectGoodCount, buf))
       return false;
+    if(!BEncodeWriteDictInt("l", latency, buf))
+      return false;
     if(!BEncodeWriteDictInt("p", pathSuccessCount, buf))
       return false;
     if(!BEncodeWriteDictInt("s", pathFailCount, buf))
@@ -29,6 +32,8 @@ namespace llarp
     bool read = false;
     if(!BEncodeMaybeReadDictInt("g", connectGoodCount, read, k, buf))
       return false;
+    if(!BEncodeMaybeReadDictInt("l", latency, read, k, buf))
+      return false;
     if(!BEncodeMaybeReadDictInt("t", connectTimeoutCount, read, k, buf))
       return false;
     if(!BEncodeMaybeReadDictInt("v", version, read, k, buf))
@@ -48,6 +53,34 @@ namespace llarp
         && (pathSuccessCount * 4 * chances) >= (pathFailCount / chances);
   }
 
+  uint64_t
+  RouterProfile::HopWeight(uint64_t chances) const
+  {
+    // bad ones only get picked when nothing else is left
+    if(!IsGood(chances))
+      return 1;
+    // unknown routers weigh 1000, up to 2x for always building paths and 2x
+    // for being quick
+    double weight = 1000.0;
+    weight *= 2.0 * (pathSuccessCount + 1)
+        / (pathSuccessCount + pathFailCount + 2);
+    weight *= double(connectGoodCount + 1)
+        / (connectGoodCount + connectTimeoutCount + 1);
+    if(latency)
+      weight *= 2.0 * ReferenceLatency / (ReferenceLatency + latency);
+    return std::max(uint64_t(weight), uint64_t(1));
+  }
+
+  uint64_t
+  Profiling::HopWeight(const RouterID& r, uint64_t chances)
+  {
+    lock_t lock(m_ProfilesMutex);
+    auto itr = m_Profiles.find(r);
+    if(itr == m_Profiles.end())
+      return RouterProfile().HopWeight(chances);
+    return itr->second.HopWeight(chances);
+  }
+
   bool
   Profiling::IsBad(const RouterID& r, uint64_t chances)
   {
@@ -63,6 +96,7 @@ namespace llarp
   {
     lock_t lock(m_ProfilesMutex);
     m_Profiles[r].connectTimeoutCount += 1;
+    m_Changed.insert(r);
   }
 
   void
@@ -70,6 +104,7 @@ namespace llarp
   {
     lock_t lock(m_ProfilesMutex);
     m_Profiles[r].connectGoodCount += 1;
+    m_Changed.insert(r);
   }
 
   void
@@ -80,6 +115,7 @@ namespace llarp
     {
       // TODO: also mark bad?
       m_Profiles[hop.rc.pubkey].pathFailCount += 1;
+      m_Changed.insert(hop.rc.pubkey);
     }
   }
 
@@ -90,9 +126,37 @@ namespace llarp
     for(const auto& hop : p->hops)
     {
       m_Profiles[hop.rc.pubkey].pathSuccessCount += 1;
+      m_Changed.insert(hop.rc.pubkey);
     }
   }
 
+  void
+  Profiling::MarkPathLatency(path::Path* p, llarp_time_t latency)
+  {
+    if(p->hops.empty())
+      return;
+    const uint64_t share = std::max(latency / p->hops.size(), uint64_t(1));
+    lock_t lock(m_ProfilesMutex);
+    for(const auto& hop : p->hops)
+    {
+      auto& profile = m_Profiles[hop.rc.pubkey];
+      if(profile.latency)
+        profile.latency = ((profile.latency * 7) + share) / 8;
+      else
+        profile.latency = share;
+      m_Changed.insert(hop.rc.pubkey);
+    }
+  }
+
+  std::vector< RouterID >
+  Profiling::TakeChanged()
+  {
+    lock_t lock(m_ProfilesMutex);
+    std::vector< RouterID > changed(m_Changed.begin(), m_Changed.end());
+    m_Changed.clear();
+    return changed;
+  }
+
   bool
   Profiling::Save(const char* fname)
   {
@@ -7,6 +7,80 @@
 
 namespace llarp
 {
+  LR_CommitFrames::LR_CommitFrames(size_t frameSize)
+      : m_FrameSize(frameSize), m_Data(NumFrames * frameSize)
+  {
+  }
+
+  llarp_buffer_t
+  LR_CommitFrames::Frame(size_t idx)
+  {
+    const size_t slot = (m_First + idx) % NumFrames;
+    return llarp::InitBuffer(m_Data.data() + slot * m_FrameSize, m_FrameSize);
+  }
+
+  void
+  LR_CommitFrames::Randomize()
+  {
+    llarp_randbytes(m_Data.data(), m_Data.size());
+  }
+
+  void
+  LR_CommitFrames::Rotate()
+  {
+    // the first slot becomes the last
+    llarp_randbytes(m_Data.data() + m_First * m_FrameSize, m_FrameSize);
+    m_First = (m_First + 1) % NumFrames;
+  }
+
+  bool
+  LR_CommitFrames::BEncode(llarp_buffer_t* buf) const
+  {
+    if(!bencode_start_list(buf))
+      return false;
+    for(size_t idx = 0; idx < NumFrames; ++idx)
+    {
+      const size_t slot = (m_First + idx) % NumFrames;
+      if(!bencode_write_bytestring(buf, m_Data.data() + slot * m_FrameSize,
+                                   m_FrameSize))
+        return false;
+    }
+    return bencode_end(buf);
+  }
+
+  bool
+  LR_CommitFrames::BDecode(llarp_buffer_t* buf)
+  {
+    if(*buf->cur != 'l')  // ensure is a list
+      return false;
+
+    buf->cur++;
+    size_t idx = 0;
+    while(llarp_buffer_size_left(*buf) && *buf->cur != 'e')
+    {
+      llarp_buffer_t strbuf;
+      if(idx >= NumFrames || !bencode_read_string(buf, &strbuf))
+        return false;
+      if(idx == 0)
+      {
+        if(strbuf.sz <= EncryptedFrame::OverheadSize
+           || strbuf.sz > EncryptedFrame::MAX_SIZE)
+          return false;
+        m_FrameSize = strbuf.sz;
+        m_First     = 0;
+        m_Data.resize(NumFrames * m_FrameSize);
+      }
+      else if(strbuf.sz != m_FrameSize)
+        return false;
+      memcpy(m_Data.data() + idx * m_FrameSize, strbuf.base, m_FrameSize);
+      ++idx;
+    }
+    if(idx != NumFrames || *buf->cur != 'e')  // make sure we're at a list end
+      return false;
+    buf->cur++;
+    return true;
+  }
+
   LR_CommitMessage::~LR_CommitMessage()
   {
   }
@@ -16,7 +90,7 @@ namespace llarp
   {
     if(llarp_buffer_eq(key, "c"))
     {
-      return BEncodeReadArray(frames, buf);
+      return frames.BDecode(buf);
     }
     bool read = false;
     if(!BEncodeMaybeReadVersion("v", version, LLARP_PROTO_VERSION, read, key,
@@ -35,7 +109,9 @@ namespace llarp
     if(!BEncodeWriteDictMsgType(buf, "a", "c"))
       return false;
     // frames
-    if(!BEncodeWriteDictArray("c", frames, buf))
+    if(!bencode_write_bytestring(buf, "c", 1))
+      return false;
+    if(!frames.BEncode(buf))
       return false;
     // version
     if(!bencode_write_version_entry(buf))
@@ -47,12 +123,6 @@ namespace llarp
   bool
   LR_CommitMessage::HandleMessage(llarp_router* router) const
   {
-    if(frames.size() != MAXHOPS)
-    {
-      llarp::LogError("LRCM invalid number of records, ", frames.size(),
-                      "!=", MAXHOPS);
-      return false;
-    }
     if(!router->paths.AllowingTransit())
     {
       llarp::LogError("got LRCM when not permitting transit");
@@ -162,25 +232,31 @@ namespace llarp
   {
     typedef llarp::path::PathContext Context;
     typedef llarp::path::TransitHop Hop;
-    typedef AsyncFrameDecrypter< LRCMFrameDecrypt > Decrypter;
-    Decrypter* decrypter;
-    std::array< EncryptedFrame, 8 > frames;
+    LR_CommitFrames frames;
     Context* context;
     // decrypted record
     LR_CommitRecord record;
     // the actual hop
     Hop* hop;
 
-    LRCMFrameDecrypt(Context* ctx, Decrypter* dec,
-                     const LR_CommitMessage* commit)
-        : decrypter(dec), frames(commit->frames), context(ctx), hop(new Hop())
+    LRCMFrameDecrypt(Context* ctx, const LR_CommitMessage* commit)
+        : frames(commit->frames), context(ctx), hop(new Hop())
     {
       hop->info.downstream = commit->session->GetPubKey();
     }
 
-    ~LRCMFrameDecrypt()
+    /// called in the worker thread, our record is the first frame
+    static void
+    Decrypt(void* user)
     {
-      delete decrypter;
+      LRCMFrameDecrypt* self = static_cast< LRCMFrameDecrypt* >(user);
+      auto buf               = self->frames.Frame(0);
+      if(EncryptedFrame::DecryptInPlace(buf,
+                                        self->context->EncryptionSecretKey(),
+                                        self->context->Crypto()))
+        HandleDecrypted(&buf, self);
+      else
+        HandleDecrypted(nullptr, self);
     }
 
     /// this is done from logic thread
@@ -195,7 +271,8 @@ namespace llarp
       self->context->Router()->PersistSessionUntil(self->hop->info.upstream,
                                                    self->hop->ExpireTime());
       // forward to next hop
-      self->context->ForwardLRCM(self->hop->info.upstream, self->frames);
+      self->context->ForwardLRCM(self->hop->info.upstream,
+                                 std::move(self->frames));
       delete self;
     }
 
@@ -278,21 +355,8 @@ namespace llarp
       llarp::LogDebug("Accepted ", self->hop->info);
       self->context->PutTransitHop(self->hop);
 
-      size_t sz = self->frames[0].size();
-      // shift
-      std::array< EncryptedFrame, 8 > frames;
-      frames[0] = self->frames[1];
-      frames[1] = self->frames[2];
-      frames[2] = self->frames[3];
-      frames[3] = self->frames[4];
-      frames[4] = self->frames[5];
-      frames[5] = self->frames[6];
-      frames[6] = self->frames[7];
-      // put our response on the end
-      frames[7] = EncryptedFrame(sz - EncryptedFrame::OverheadSize);
-      // random junk for now
-      frames[7].Randomize();
-      self->frames = std::move(frames);
+      // shift, putting our response on the end, random junk for now
+      self->frames.Rotate();
       if(self->context->HopIsUs(info.upstream))
       {
         // we are the farthest hop
@@ -312,14 +376,12 @@ namespace llarp
   bool
   LR_CommitMessage::AsyncDecrypt(llarp::path::PathContext* context) const
   {
-    LRCMFrameDecrypt::Decrypter* decrypter = new LRCMFrameDecrypt::Decrypter(
-        context->Crypto(), context->EncryptionSecretKey(),
-        &LRCMFrameDecrypt::HandleDecrypted);
     // copy frames so we own them
-    LRCMFrameDecrypt* frames = new LRCMFrameDecrypt(context, decrypter, this);
+    LRCMFrameDecrypt* frames = new LRCMFrameDecrypt(context, this);
 
     // decrypt frames async
-    decrypter->AsyncDecrypt(context->Worker(), &frames->frames[0], frames);
+    llarp_threadpool_queue_job(context->Worker(),
+                               {frames, &LRCMFrameDecrypt::Decrypt});
     return true;
   }
 }  // namespace llarp
@@ -0,0 +1,146 @@
+#include <llarp/path.hpp>
+#include "logger.hpp"
+
+namespace llarp
+{
+  namespace path
+  {
+    RelayPipeline::RelayPipeline(DeliverFunc deliver) : m_Deliver(deliver)
+    {
+      for(auto& shard : m_Shards)
+        shard.parent = this;
+    }
+
+    void
+    RelayPipeline::Init(llarp_crypto* crypto, llarp_threadpool* worker,
+                        llarp_logic* logic)
+    {
+      m_Crypto = crypto;
+      m_Worker = worker;
+      m_Logic  = logic;
+    }
+
+    size_t
+    RelayPipeline::Pending() const
+    {
+      size_t num = 0;
+      for(const auto& shard : m_Shards)
+        num += shard.pending.size() + shard.working.size();
+      return num;
+    }
+
+    void
+    RelayPipeline::Crypt(Job& job)
+    {
+      m_Crypto->xchacha20(job.X.Buffer(), job.key, job.Y);
+    }
+
+    bool
+    RelayPipeline::Queue(Job job)
+    {
+      if(batchSize == 0)
+      {
+        Crypt(job);
+        m_Deliver(job);
+        return true;
+      }
+      Shard& shard =
+          m_Shards[PathIDHash()(job.info.txID) % m_Shards.size()];
+      // the workers are behind, shed load before we copy anything
+      if(maxPending && shard.pending.size() >= maxPending)
+      {
+        ++m_Dropped;
+        return false;
+      }
+      // we hang on to the payload past the caller's stack
+      if(!job.X.packet && !job.X.Copy(job.X.Buffer()))
+      {
+        llarp::LogWarn("relayed message too big, dropping");
+        return false;
+      }
+      shard.pending.emplace_back(std::move(job));
+      if(shard.pending.size() >= batchSize)
+        Dispatch(shard);
+      else
+        ScheduleFlush();
+      return true;
+    }
+
+    void
+    RelayPipeline::ScheduleFlush()
+    {
+      if(m_FlushScheduled)
+        return;
+      m_FlushScheduled = true;
+      if(latency)
+        llarp_logic_call_later(m_Logic, {latency, this, &HandleFlushTimer});
+      else
+        // runs after everything the event loop read this tick
+        llarp_logic_queue_job(m_Logic, {this, &HandleFlush});
+    }
+
+    void
+    RelayPipeline::HandleFlushTimer(void* user, uint64_t, uint64_t left)
+    {
+      RelayPipeline* self = static_cast< RelayPipeline* >(user);
+      // canceled, the next message schedules another
+      if(left)
+      {
+        self->m_FlushScheduled = false;
+        return;
+      }
+      self->Flush();
+    }
+
+    void
+    RelayPipeline::HandleFlush(void* user)
+    {
+      static_cast< RelayPipeline* >(user)->Flush();
+    }
+
+    void
+    RelayPipeline::Flush()
+    {
+      m_FlushScheduled = false;
+      for(auto& shard : m_Shards)
+      {
+        if(shard.pending.size())
+          Dispatch(shard);
+      }
+    }
+
+    void
+    RelayPipeline::Dispatch(Shard& shard)
+    {
+      // one batch per shard at a time keeps each path in order, the rest
+      // goes out when it comes back
+      if(shard.busy)
+        return;
+      shard.busy = true;
+      std::swap(shard.pending, shard.working);
+      llarp_threadpool_queue_job(m_Worker, {&shard, &HandleWork});
+    }
+
+    void
+    RelayPipeline::HandleWork(void* user)
+    {
+      Shard* shard = static_cast< Shard* >(user);
+      for(auto& job : shard->working)
+        shard->parent->Crypt(job);
+      llarp_logic_queue_job(shard->parent->m_Logic, {shard, &HandleDone});
+    }
+
+    void
+    RelayPipeline::HandleDone(void* user)
+    {
+      Shard* shard        = static_cast< Shard* >(user);
+      RelayPipeline* self = shard->parent;
+      for(auto& job : shard->working)
+        self->m_Deliver(job);
+      shard->working.clear();
+      shard->busy = false;
+      if(shard->pending.size())
+        self->Dispatch(*shard);
+    }
+  }  // namespace path
+}  // namespace llarp
@@ -18,6 +18,17 @@ namespace llarp
   {
   }
 
+  void
+  RelayUpstreamMessage::Reset(ILinkSession *from, const PacketRef &pkt)
+  {
+    session = from;
+    version = 0;
+    packet  = pkt;
+    pathid.Zero();
+    X.Clear();
+    Y.Zero();
+  }
+
   bool
   RelayUpstreamMessage::BEncode(llarp_buffer_t *buf) const
   {
@@ -46,8 +57,13 @@ namespace llarp
     if(!BEncodeMaybeReadVersion("v", version, LLARP_PROTO_VERSION, read, key,
                                 buf))
       return false;
-    if(!BEncodeMaybeReadDictEntry("x", X, read, key, buf))
-      return false;
+    if(llarp_buffer_eq(key, "x"))
+    {
+      // relayed payloads share the link message buffer
+      if(!X.BDecode(buf, packet))
+        return false;
+      read = true;
+    }
     if(!BEncodeMaybeReadDictEntry("y", Y, read, key, buf))
       return false;
     return read;
@@ -59,7 +75,7 @@ namespace llarp
     auto path = r->paths.GetByDownstream(session->GetPubKey(), pathid);
     if(path)
     {
-      return path->HandleUpstream(X.Buffer(), Y, r);
+      return path->HandleUpstream(X, Y, r);
     }
     return false;
   }
@@ -76,6 +92,17 @@ namespace llarp
   RelayDownstreamMessage::~RelayDownstreamMessage()
   {
   }
+
+  void
+  RelayDownstreamMessage::Reset(ILinkSession *from, const PacketRef &pkt)
+  {
+    session = from;
+    version = 0;
+    packet  = pkt;
+    pathid.Zero();
+    X.Clear();
+    Y.Zero();
+  }
   bool
   RelayDownstreamMessage::BEncode(llarp_buffer_t *buf) const
   {
@@ -104,8 +131,13 @@ namespace llarp
     if(!BEncodeMaybeReadVersion("v", version, LLARP_PROTO_VERSION, read, key,
                                 buf))
       return false;
-    if(!BEncodeMaybeReadDictEntry("x", X, read, key, buf))
-      return false;
+    if(llarp_buffer_eq(key, "x"))
+    {
+      // relayed payloads share the link message buffer
+      if(!X.BDecode(buf, packet))
+        return false;
+      read = true;
+    }
     if(!BEncodeMaybeReadDictEntry("y", Y, read, key, buf))
       return false;
     return read;
@@ -117,7 +149,7 @@ namespace llarp
     auto path = r->paths.GetByUpstream(session->GetPubKey(), pathid);
     if(path)
     {
-      return path->HandleDownstream(X.Buffer(), Y, r);
+      return path->HandleDownstream(X, Y, r);
     }
     llarp::LogWarn("unhandled downstream message");
     return false;
@@ -138,6 +138,13 @@ llarp_router::HandleRecvLinkMessageBuffer(llarp::ILinkSession *session,
   return inbound_link_msg_parser.ProcessFrom(session, buf);
 }
 
+bool
+llarp_router::HandleRecvLinkMessage(llarp::ILinkSession *session,
+                                    const llarp::PacketRef &pkt, size_t sz)
+{
+  return inbound_link_msg_parser.ProcessFrom(session, pkt, sz);
+}
+
 void
 llarp_router::PersistSessionUntil(const llarp::RouterID &remote,
                                   llarp_time_t until)
@@ -152,8 +159,6 @@ llarp_router::PersistSessionUntil(const llarp::RouterID &remote,
   }
 }
 
-constexpr size_t MaxPendingSendQueueSize = 8;
-
 bool
 llarp_router::SendToOrQueue(const llarp::RouterID &remote,
                             const llarp::ILinkMessage *msg)
@@ -170,27 +175,18 @@ llarp_router::SendToOrQueue(const llarp::RouterID &remote,
     SendTo(remote, msg, chosen);
     return true;
   }
-  // this will create an entry in the obmq if it's not already there
-  auto itr = outboundMessageQueue.find(remote);
-  if(itr == outboundMessageQueue.end())
-  {
-    outboundMessageQueue.insert(std::make_pair(remote, MessageQueue()));
-  }
   // encode
   llarp_buffer_t buf =
       llarp::StackBuffer< decltype(linkmsg_buffer) >(linkmsg_buffer);
   if(!msg->BEncode(&buf))
     return false;
-  // queue buffer
-  auto &q = outboundMessageQueue[remote];
-
-  if(q.size() < MaxPendingSendQueueSize)
-  {
-    buf.sz = buf.cur - buf.base;
-    q.emplace(buf.sz);
-    memcpy(q.back().data(), buf.base, buf.sz);
-  }
-  else
+  buf.sz = buf.cur - buf.base;
+  // queue buffer, this will create an entry in the obmq if it's not already
+  // there
+  bool queued = outboundMessageQueue.Put(
+      remote, std::vector< byte_t >(buf.base, buf.base + buf.sz), buf.sz,
+      llarp_time_now_ms());
+  if(!queued)
   {
     llarp::LogWarn("tried to queue a message to ", remote,
                    " but the queue is full so we drop it like it's hawt");
@@ -201,14 +197,14 @@ llarp_router::SendToOrQueue(const llarp::RouterID &remote,
   {
     // try connecting directly as the rc is loaded from disk
     llarp_router_try_connect(this, remoteRC, 10);
-    return true;
+    return queued;
   }
 
   // we don't have the RC locally so do a dht lookup
   dht->impl.LookupRouter(remote,
                          std::bind(&llarp_router::HandleDHTLookupForSendTo,
                                    this, remote, std::placeholders::_1));
-  return true;
+  return queued;
 }
 
 void
@@ -276,6 +272,20 @@ llarp_router::AddInboundLink(std::unique_ptr< llarp::ILinkLayer > &link)
   inboundLinks.push_back(std::move(link));
 }
 
+size_t
+llarp_router::MirrorInboundLinks(llarp_ev_loop *loop)
+{
+  size_t mirrored = 0;
+  for(const auto &link : inboundLinks)
+  {
+    if(link->Mirror(loop))
+      ++mirrored;
+    else
+      llarp::LogWarn("cannot read for ", link->Name(), " on another net thread");
+  }
+  return mirrored;
+}
+
 bool
 llarp_router::Ready()
 {
@@ -435,12 +445,25 @@ llarp_router::NumberOfConnectedRouters() const
   return validRouters.size();
 }
 
+static void
+log_link_stats(llarp::ILinkLayer *link)
+{
+  llarp_udp_stats st;
+  link->GetUDPStats(st);
+  if(st.rx_calls && st.tx_calls)
+    llarp::LogDebug(link->Name(), " datagrams per syscall: rx=",
+                    double(st.rx_pkts) / st.rx_calls,
+                    " tx=", double(st.tx_pkts) / st.tx_calls);
+}
+
 void
 llarp_router::Tick()
 {
   // llarp::LogDebug("tick router");
   auto now = llarp_time_now_ms();
   paths.ExpirePaths();
+  for(const auto &changed : routerProfiling.TakeChanged())
+    llarp_nodedb_update_hop_weight(nodedb, changed);
   {
     auto itr = m_PersistingSessions.begin();
     while(itr != m_PersistingSessions.end())
@@ -474,6 +497,9 @@ llarp_router::Tick()
       dht->impl.Explore(explore);
     }
     paths.BuildPaths();
+    llarp::LogDebug("path builds: ", paths.BuildStats());
+    if(paths.Relay().Dropped())
+      llarp::LogDebug("relayed messages dropped: ", paths.Relay().Dropped());
     hiddenServiceContext.Tick();
   }
   if(NumberOfConnectedRouters() < minConnectedRouters)
@@ -481,6 +507,13 @@ llarp_router::Tick()
     ConnectToRandomRouters(minConnectedRouters);
   }
   paths.TickPaths();
+  llarp::LogDebug("outbound message queue: ", outboundMessageQueue.Stats());
+  llarp::LogDebug("pending traffic holds ", pendingBudget.Used(), " of ",
+                  pendingBudget.limit, " bytes");
+  if(outboundLink)
+    log_link_stats(outboundLink.get());
+  for(const auto &link : inboundLinks)
+    log_link_stats(link.get());
 }
 
 void
@@ -558,31 +591,24 @@ llarp_router::FlushOutboundFor(const llarp::RouterID &remote,
 {
   llarp::LogDebug("Flush outbound for ", remote);
   pendingEstablishJobs.erase(remote);
-  auto itr = outboundMessageQueue.find(remote);
-  if(itr == outboundMessageQueue.end())
-  {
-    return;
-  }
   if(!chosen)
   {
     DiscardOutboundFor(remote);
     return;
   }
-  while(itr->second.size())
-  {
-    auto buf = llarp::ConstBuffer(itr->second.front());
-    if(!chosen->SendTo(remote, buf))
-      llarp::LogWarn("failed to send outboud message to ", remote, " via ",
-                     chosen->Name());
-
-    itr->second.pop();
-  }
+  outboundMessageQueue.Drain(
+      remote, llarp_time_now_ms(), [&](const std::vector< byte_t > &msg) {
+        auto buf = llarp::ConstBuffer(msg);
+        if(!chosen->SendTo(remote, buf))
+          llarp::LogWarn("failed to send outboud message to ", remote,
+                         " via ", chosen->Name());
+      });
 }
 
 void
 llarp_router::DiscardOutboundFor(const llarp::RouterID &remote)
 {
-  outboundMessageQueue.erase(remote);
+  outboundMessageQueue.Discard(remote);
 }
 
 bool
@@ -634,6 +660,13 @@ void
 llarp_router::Run()
 {
   routerProfiling.Load(routerProfilesFile.string().c_str());
+  llarp_nodedb_set_disk_worker(nodedb, disk);
+  ephemeralKeys.Init(tp);
+  // favour reliable and fast routers as path hops
+  llarp_nodedb_set_hop_weight_func(
+      nodedb, [&](const llarp::RouterContact &rc) -> uint64_t {
+        return routerProfiling.HopWeight(rc.pubkey);
+      });
   // zero out router contact
   sockaddr *dest = (sockaddr *)&this->ip4addr;
   llarp::Addr publicAddr(*dest);
@@ -869,6 +902,7 @@ llarp_init_router(struct llarp_threadpool *tp, struct llarp_ev_loop *netloop,
     router->disk = llarp_init_threadpool(1, "llarp-diskio");
 #endif
     llarp_crypto_init(&router->crypto);
+    router->paths.Relay().Init(&router->crypto, tp, logic);
   }
   return router;
 }
@@ -903,6 +937,14 @@ llarp_stop_router(struct llarp_router *router)
   {
     router->Close();
     router->routerProfiling.Save(router->routerProfilesFile.string().c_str());
+    // nodedb writes anything still pending itself when it goes
+    if(router->disk != router->tp)
+    {
+      llarp_threadpool_stop(router->disk);
+      llarp_threadpool_join(router->disk);
+    }
+    if(router->nodedb)
+      llarp_nodedb_set_disk_worker(router->nodedb, nullptr);
   }
 }
 
@@ -1122,6 +1164,74 @@ namespace llarp
         self->addrInfo.port    = htons(atoi(val));
         self->publicOverride   = true;
       }
+      if(StrEq(key, "link-fragments"))
+      {
+        self->linkVariableFragments = StrEq(val, "variable");
+      }
+      if(StrEq(key, "link-padding"))
+      {
+        self->linkFragmentPadding = std::max(atoi(val), 0);
+      }
+      if(StrEq(key, "link-crypto-batch"))
+      {
+        self->linkCryptoBatch = std::max(atoi(val), 0);
+      }
+      if(StrEq(key, "relay-batch"))
+      {
+        self->paths.Relay().batchSize = std::max(atoi(val), 0);
+      }
+      if(StrEq(key, "relay-latency"))
+      {
+        self->paths.Relay().latency = std::max(atoi(val), 0);
+      }
+      if(StrEq(key, "relay-max-pending"))
+      {
+        self->paths.Relay().maxPending = std::max(atoi(val), 0);
+      }
+      if(StrEq(key, "dht-verify-batch"))
+      {
+        self->dht->impl.verifier.batchSize = std::max(atoi(val), 0);
+      }
+      if(StrEq(key, "dht-verify-cache"))
+      {
+        self->dht->impl.verifier.cacheSize = std::max(atoi(val), 0);
+      }
+      if(StrEq(key, "dht-max-introsets"))
+      {
+        self->dht->impl.maxIntroSets = std::max(atoi(val), 0);
+      }
+      if(StrEq(key, "pending-max-bytes"))
+      {
+        self->pendingBudget.limit = std::max(atoi(val), 0);
+      }
+      if(StrEq(key, "pending-bytes"))
+      {
+        self->outboundMessageQueue.limits.bytesPerDest = std::max(atoi(val), 0);
+      }
+      if(StrEq(key, "pending-target"))
+      {
+        self->outboundMessageQueue.limits.targetMs = std::max(atoi(val), 0);
+      }
+      if(StrEq(key, "pending-interval"))
+      {
+        self->outboundMessageQueue.limits.intervalMs = std::max(atoi(val), 0);
+      }
+      if(StrEq(key, "path-build-rate"))
+      {
+        self->paths.buildBudget.rate = std::max(atoi(val), 0);
+      }
+      if(StrEq(key, "path-build-burst"))
+      {
+        self->paths.buildBudget.burst = std::max(atoi(val), 0);
+      }
+      if(StrEq(key, "path-builds-max"))
+      {
+        self->paths.buildBudget.maxBuilding = std::max(atoi(val), 0);
+      }
+      if(StrEq(key, "ephemeral-keys"))
+      {
+        self->ephemeralKeys.capacity = std::max(atoi(val), 0);
+      }
     }
   }  // namespace llarp
 }  // namespace llarp
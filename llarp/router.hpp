@@ -14,7 +14,9 @@
 
 #include <llarp/dht.hpp>
 #include <llarp/handlers/tun.hpp>
+#include <llarp/keypair_pool.hpp>
 #include <llarp/link_message.hpp>
+#include <llarp/pending_queue.hpp>
 #include <llarp/routing/handler.hpp>
 #include <llarp/service.hpp>
 #include <llarp/establish_job.hpp>
@@ -65,6 +67,11 @@ struct llarp_router
   llarp_threadpool *tp;
   llarp_logic *logic;
   llarp_crypto crypto;
+  /// ephemeral keypairs for path builds, refilled on tp
+  llarp::KeypairPool ephemeralKeys{&crypto};
+  /// bytes held by the outbound message queue and every hidden service's
+  /// pending traffic, declared before any of those so it outlives them
+  llarp::util::PendingBudget pendingBudget;
   llarp::path::PathContext paths;
   llarp::SecretKey identity;
   llarp::SecretKey encryption;
@@ -86,6 +93,16 @@ struct llarp_router
   // should we be sending padded messages every interval?
   bool sendPadding = false;
 
+  /// offer and take up variable sized link fragments, off until every
+  /// router on the network decodes the LIM feature key
+  bool linkVariableFragments = false;
+  /// round variable sized link fragments up to a multiple of this many
+  /// bytes, 0 for no padding
+  size_t linkFragmentPadding = 0;
+  /// most link fragments a session hands a worker to seal or open at once
+  /// before the end of the tick, 0 does link crypto inline
+  size_t linkCryptoBatch = 32;
+
   uint32_t ticker_job_id = 0;
 
   llarp::InboundMessageParser inbound_link_msg_parser;
@@ -99,11 +116,11 @@ struct llarp_router
   llarp::Profiling routerProfiling;
   fs::path routerProfilesFile = "profiles.dat";
 
-  typedef std::queue< std::vector< byte_t > > MessageQueue;
+  typedef llarp::util::PendingQueues< llarp::RouterID, std::vector< byte_t > >
+      MessageQueue;
 
   /// outbound message queue
-  std::unordered_map< llarp::RouterID, MessageQueue, llarp::RouterID::Hash >
-      outboundMessageQueue;
+  MessageQueue outboundMessageQueue{&pendingBudget};
 
   /// loki verified routers
   std::unordered_map< llarp::RouterID, llarp::RouterContact,
@@ -127,9 +144,19 @@ struct llarp_router
   bool
   HandleRecvLinkMessageBuffer(llarp::ILinkSession *from, llarp_buffer_t msg);
 
+  /// handle a link message the session reassembled into a pooled buffer
+  bool
+  HandleRecvLinkMessage(llarp::ILinkSession *from, const llarp::PacketRef &pkt,
+                        size_t sz);
+
   void
   AddInboundLink(std::unique_ptr< llarp::ILinkLayer > &link);
 
+  /// read for our inbound links on another net thread's loop
+  /// return how many links were mirrored
+  size_t
+  MirrorInboundLinks(llarp_ev_loop *loop);
+
   bool
   InitOutboundLink();
 
@@ -300,6 +300,12 @@ namespace llarp
 
     bool
     IntroSet::Verify(llarp_crypto* crypto) const
+    {
+      return VerifySignature(crypto) && VerifyContents(crypto);
+    }
+
+    bool
+    IntroSet::VerifySignature(llarp_crypto* crypto) const
     {
       byte_t tmp[MAX_INTROSET_SIZE];
       auto buf = llarp::StackBuffer< decltype(tmp) >(tmp);
@@ -311,8 +317,12 @@ namespace llarp
       // rewind and resize buffer
       buf.sz  = buf.cur - buf.base;
       buf.cur = buf.base;
-      if(!A.Verify(crypto, buf, Z))
-        return false;
+      return A.Verify(crypto, buf, Z);
+    }
+
+    bool
+    IntroSet::VerifyContents(llarp_crypto* crypto) const
+    {
       // validate PoW
       if(W && !W->IsValid(crypto->shorthash))
         return false;
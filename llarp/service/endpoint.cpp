@@ -11,7 +11,10 @@ namespace llarp
   namespace service
   {
     Endpoint::Endpoint(const std::string& name, llarp_router* r)
-        : path::Builder(r, r->dht, 4, 4), m_Router(r), m_Name(name)
+        : path::Builder(r, r->dht, 4, 4)
+        , m_Router(r)
+        , m_Name(name)
+        , m_PendingTraffic(&r->pendingBudget)
     {
       m_Tag.Zero();
     }
@@ -49,6 +52,30 @@ namespace llarp
         if(val > 0)
           m_MinPathLatency = val;
       }
+      if(k == "spare-paths")
+      {
+        numSpare = std::max(atoi(v.c_str()), 0);
+      }
+      if(k == "rebuild-ahead")
+      {
+        rebuildAhead = std::max(atoi(v.c_str()), 0);
+      }
+      if(k == "path-stripe")
+      {
+        stripeWidth = std::max(atoi(v.c_str()), 0);
+      }
+      if(k == "pending-bytes")
+      {
+        m_PendingTraffic.limits.bytesPerDest = std::max(atoi(v.c_str()), 0);
+      }
+      if(k == "pending-target")
+      {
+        m_PendingTraffic.limits.targetMs = std::max(atoi(v.c_str()), 0);
+      }
+      if(k == "pending-interval")
+      {
+        m_PendingTraffic.limits.intervalMs = std::max(atoi(v.c_str()), 0);
+      }
       return true;
     }
 
@@ -231,6 +258,7 @@ namespace llarp
             ++itr;
         }
       }
+      llarp::LogDebug(Name(), " pending traffic: ", PendingTrafficStats());
     }
 
     uint64_t
@@ -339,6 +367,24 @@ namespace llarp
       return true;
     }
 
+    void
+    Endpoint::PutPeerTakesMACFor(const ConvoTag& tag)
+    {
+      auto itr = m_Sessions.find(tag);
+      if(itr == m_Sessions.end())
+        return;
+      itr->second.takesMAC = true;
+    }
+
+    bool
+    Endpoint::PeerTakesMACFor(const ConvoTag& tag) const
+    {
+      auto itr = m_Sessions.find(tag);
+      if(itr == m_Sessions.end())
+        return false;
+      return itr->second.takesMAC;
+    }
+
     void
     Endpoint::PutIntroFor(const ConvoTag& tag, const Introduction& intro)
     {
@@ -866,6 +912,9 @@ namespace llarp
 
     {
       updatingIntroSet = false;
+      numSpare         = parent->numSpare;
+      rebuildAhead     = parent->rebuildAhead;
+      stripeWidth      = parent->stripeWidth;
       if(intro.I.size())
         remoteIntro = intro.I[0];
     }
@@ -912,7 +961,7 @@ namespace llarp
             if(p == nullptr && GetIntroFor(tag, remoteIntro))
             {
               if(!remoteIntro.ExpiresSoon(now))
-                p = GetPathByRouter(remoteIntro.router);
+                p = PickPathByRouter(remoteIntro.router, now);
               if(p)
               {
                 f.T = tag;
@@ -937,9 +986,13 @@ namespace llarp
             f.C.Zero();
             transfer.Y.Randomize();
             transfer.P = remoteIntro.pathID;
-            if(!f.EncryptAndSign(&Router()->crypto, m, K, m_Identity))
+            // older endpoints only take signed frames
+            const bool ok = PeerTakesMACFor(f.T)
+                ? f.EncryptAndMAC(&Router()->crypto, m, K)
+                : f.EncryptAndSign(&Router()->crypto, m, K, m_Identity);
+            if(!ok)
             {
-              llarp::LogError("failed to encrypt and sign");
+              llarp::LogError("failed to encrypt");
               return false;
             }
             llarp::LogDebug(Name(), " send ", data.sz, " via ", remoteIntro);
@@ -955,37 +1008,37 @@ namespace llarp
         return true;
       }
 
-      auto itr = m_PendingTraffic.find(remote);
-      if(itr == m_PendingTraffic.end())
+      const bool first = !m_PendingTraffic.Has(remote);
+      const bool queued =
+          m_PendingTraffic.Put(remote, PendingBuffer(data, t), data.sz,
+                               llarp_time_now_ms());
+      if(!queued)
+      {
+        llarp::LogWarn(Name(), " dropped ", data.sz, " bytes to ", remote,
+                       " as its pending queue is full");
+      }
+      if(first)
       {
-        m_PendingTraffic.insert(std::make_pair(remote, PendingBufferQueue()));
         EnsurePathToService(
             remote,
             [&](Address addr, OutboundContext* ctx) {
               if(ctx)
               {
-                auto itr = m_PendingTraffic.find(addr);
-                if(itr != m_PendingTraffic.end())
-                {
-                  while(itr->second.size())
-                  {
-                    auto& front = itr->second.front();
-                    ctx->AsyncEncryptAndSendTo(front.Buffer(), front.protocol);
-                    itr->second.pop();
-                  }
-                }
+                m_PendingTraffic.Drain(
+                    addr, llarp_time_now_ms(), [ctx](PendingBuffer& buf) {
+                      ctx->AsyncEncryptAndSendTo(buf.Buffer(), buf.protocol);
+                    });
               }
               else
               {
                 llarp::LogWarn("failed to obtain outbound context to ", addr,
                                " within timeout");
+                m_PendingTraffic.Discard(addr);
               }
-              m_PendingTraffic.erase(addr);
             },
             10000);
       }
-      m_PendingTraffic[remote].emplace(data, t);
-      return true;
+      return queued;
     }  // namespace service
 
     bool
@@ -1126,7 +1179,7 @@ namespace llarp
         // set sender
         self->msg.sender = self->m_LocalIdentity.pub;
         // set version
-        self->msg.version = LLARP_PROTO_VERSION;
+        self->msg.version = ProtocolMessageVersionMAC;
         // set protocol
         self->msg.proto = eProtocolTraffic;
         // encrypt and sign
@@ -1172,10 +1225,10 @@ namespace llarp
     void
     Endpoint::SendContext::Send(ProtocolFrame& msg)
     {
-      auto path = m_PathSet->GetPathByRouter(remoteIntro.router);
+      auto now  = llarp_time_now_ms();
+      auto path = m_PathSet->PickPathByRouter(remoteIntro.router, now);
       if(path)
       {
-        auto now = llarp_time_now_ms();
         if(remoteIntro.ExpiresSoon(now))
         {
           if(!MarkCurrentIntroBad(now))
@@ -1314,8 +1367,11 @@ namespace llarp
         }
       }
 
-      auto path = m_PathSet->GetNewestPathByRouter(remoteIntro.router);
-      if(!path)
+      // replies come back on the newest path as it lives longest, what we
+      // send is spread over the best few
+      auto replyPath = m_PathSet->GetNewestPathByRouter(remoteIntro.router);
+      auto path      = m_PathSet->PickPathByRouter(remoteIntro.router, now);
+      if(!path || !replyPath)
       {
         llarp::LogError("cannot encrypt and send: no path for intro ",
                         remoteIntro);
@@ -1327,13 +1383,18 @@ namespace llarp
         ProtocolMessage m;
         m.proto = t;
         m_DataHandler->PutIntroFor(f.T, remoteIntro);
-        m.introReply = path->intro;
+        m.introReply = replyPath->intro;
         m.sender     = m_Endpoint->m_Identity.pub;
         m.PutBuffer(payload);
 
-        if(!f.EncryptAndSign(&crypto, m, shared, m_Endpoint->m_Identity))
+        // the handshake was signed, from here on the session key is enough
+        // if the remote takes it
+        const bool ok = m_DataHandler->PeerTakesMACFor(f.T)
+            ? f.EncryptAndMAC(&crypto, m, shared)
+            : f.EncryptAndSign(&crypto, m, shared, m_Endpoint->m_Identity);
+        if(!ok)
         {
-          llarp::LogError("failed to sign");
+          llarp::LogError("failed to encrypt");
           return;
         }
       }
@@ -3,16 +3,20 @@
 #include "buffer.hpp"
 #include "mem.hpp"
 
+#include <sodium.h>
+
 namespace llarp
 {
   namespace service
   {
     ProtocolMessage::ProtocolMessage()
+        : IBEncodeMessage(ProtocolMessageVersionMAC)
     {
       tag.Zero();
     }
 
-    ProtocolMessage::ProtocolMessage(const ConvoTag& t) : tag(t)
+    ProtocolMessage::ProtocolMessage(const ConvoTag& t)
+        : IBEncodeMessage(ProtocolMessageVersionMAC), tag(t)
     {
     }
 
@@ -105,7 +109,11 @@ namespace llarp
       }
       if(!BEncodeWriteDictEntry("D", D, buf))
         return false;
-
+      if(!M.IsZero())
+      {
+        if(!BEncodeWriteDictEntry("M", M, buf))
+          return false;
+      }
       if(!BEncodeWriteDictEntry("N", N, buf))
         return false;
       if(!T.IsZero())
@@ -115,8 +123,11 @@ namespace llarp
       }
       if(!BEncodeWriteDictInt("V", version, buf))
         return false;
-      if(!BEncodeWriteDictEntry("Z", Z, buf))
-        return false;
+      if(M.IsZero())
+      {
+        if(!BEncodeWriteDictEntry("Z", Z, buf))
+          return false;
+      }
       return bencode_end(buf);
     }
 
@@ -137,6 +148,8 @@ namespace llarp
         return false;
       if(!BEncodeMaybeReadDictEntry("C", C, read, key, val))
         return false;
+      if(!BEncodeMaybeReadDictEntry("M", M, read, key, val))
+        return false;
       if(!BEncodeMaybeReadDictEntry("N", N, read, key, val))
         return false;
       if(!BEncodeMaybeReadDictInt("S", S, read, key, val))
@@ -163,10 +176,8 @@ namespace llarp
     }
 
     bool
-    ProtocolFrame::EncryptAndSign(llarp_crypto* crypto,
-                                  const ProtocolMessage& msg,
-                                  const byte_t* sessionKey,
-                                  const Identity& localIdent)
+    ProtocolFrame::Encrypt(llarp_crypto* crypto, const ProtocolMessage& msg,
+                           const byte_t* key)
     {
       byte_t tmp[MAX_PROTOCOL_MESSAGE_SIZE];
       auto buf = llarp::StackBuffer< decltype(tmp) >(tmp);
@@ -180,11 +191,24 @@ namespace llarp
       buf.sz  = buf.cur - buf.base;
       buf.cur = buf.base;
       // encrypt
-      crypto->xchacha20(buf, sessionKey, N);
+      crypto->xchacha20(buf, key, N);
       // put encrypted buffer
       D = buf;
+      return true;
+    }
+
+    bool
+    ProtocolFrame::EncryptAndSign(llarp_crypto* crypto,
+                                  const ProtocolMessage& msg,
+                                  const byte_t* sessionKey,
+                                  const Identity& localIdent)
+    {
+      if(!Encrypt(crypto, msg, sessionKey))
+        return false;
       // zero out signature
+      M.Zero();
       Z.Zero();
+      byte_t tmp[MAX_PROTOCOL_MESSAGE_SIZE];
       auto buf2 = llarp::StackBuffer< decltype(tmp) >(tmp);
       // encode frame
       if(!BEncode(&buf2))
@@ -205,6 +229,61 @@ namespace llarp
       return true;
     }
 
+    bool
+    ProtocolFrame::EncryptAndMAC(llarp_crypto* crypto,
+                                 const ProtocolMessage& msg,
+                                 const byte_t* sessionKey)
+    {
+      if(!Encrypt(crypto, msg, sessionKey))
+        return false;
+      Z.Zero();
+      M.Zero();
+      ShortHash mac;
+      if(!CalculateMAC(crypto, sessionKey, mac))
+        return false;
+      M = mac;
+      return true;
+    }
+
+    bool
+    ProtocolFrame::CalculateMAC(llarp_crypto* crypto, const byte_t* sessionKey,
+                                ShortHash& mac) const
+    {
+      // domain separated so the mac key is never the encryption key
+      static const char macDomain[] = "llarp-hs-frame-mac";
+      ShortHash macKey;
+      if(!crypto->hmac(macKey,
+                       llarp::InitBuffer(macDomain, sizeof(macDomain) - 1),
+                       sessionKey))
+        return false;
+      ProtocolFrame copy(*this);
+      copy.M.Zero();
+      copy.Z.Zero();
+      byte_t tmp[MAX_PROTOCOL_MESSAGE_SIZE];
+      auto buf = llarp::StackBuffer< decltype(tmp) >(tmp);
+      if(!copy.BEncode(&buf))
+      {
+        llarp::LogError("frame too big to encode");
+        return false;
+      }
+      // rewind
+      buf.sz  = buf.cur - buf.base;
+      buf.cur = buf.base;
+      return crypto->hmac(mac, buf, macKey);
+    }
+
+    bool
+    ProtocolFrame::VerifyMAC(llarp_crypto* crypto,
+                             const byte_t* sessionKey) const
+    {
+      if(M.IsZero())
+        return false;
+      ShortHash mac;
+      if(!CalculateMAC(crypto, sessionKey, mac))
+        return false;
+      return sodium_memcmp(mac.data(), M.data(), mac.size()) == 0;
+    }
+
     struct AsyncFrameDecrypt
     {
       llarp_crypto* crypto;
@@ -284,6 +363,8 @@ namespace llarp
         self->handler->PutIntroFor(self->msg->tag, self->msg->introReply);
         self->handler->PutSenderFor(self->msg->tag, self->msg->sender);
         self->handler->PutCachedSessionKeyFor(self->msg->tag, sharedKey);
+        if(self->msg->version >= ProtocolMessageVersionMAC)
+          self->handler->PutPeerTakesMACFor(self->msg->tag);
 
         self->msg->handler = self->handler;
         llarp_logic_queue_job(self->logic,
@@ -297,6 +378,7 @@ namespace llarp
     {
       C       = other.C;
       D       = other.D;
+      M       = other.M;
       N       = other.N;
       Z       = other.Z;
       T       = other.T;
@@ -334,7 +416,16 @@ namespace llarp
         llarp::LogError("No sender for T=", T);
         return false;
       }
-      if(!Verify(c, si))
+      // frames on an established convo carry a hmac instead of a signature
+      if(!M.IsZero())
+      {
+        if(!VerifyMAC(c, shared))
+        {
+          llarp::LogError("MAC failure from ", si.Addr());
+          return false;
+        }
+      }
+      else if(!Verify(c, si))
       {
         llarp::LogError("Signature failure from ", si.Addr());
         return false;
@@ -346,6 +437,8 @@ namespace llarp
         delete msg;
         return false;
       }
+      if(msg->version >= ProtocolMessageVersionMAC)
+        handler->PutPeerTakesMACFor(T);
       msg->srcPath = srcPath;
       msg->handler = handler;
       llarp_logic_queue_job(logic, {msg, &ProtocolMessage::ProcessAsync});
@@ -355,8 +448,9 @@ namespace llarp
     bool
     ProtocolFrame::operator==(const ProtocolFrame& other) const
     {
-      return C == other.C && D == other.D && N == other.N && Z == other.Z
-          && T == other.T && S == other.S && version == other.version;
+      return C == other.C && D == other.D && M == other.M && N == other.N
+          && Z == other.Z && T == other.T && S == other.S
+          && version == other.version;
     }
 
     bool
@@ -4,7 +4,9 @@
 #endif
 #include <cstring>
 
+#include <llarp/lockfree.hpp>
 #include <llarp/time.h>
+#include <atomic>
 #include <functional>
 #include <queue>
 
@@ -28,48 +30,89 @@ namespace llarp
 {
   namespace thread
   {
-    void
-    Pool::Spawn(size_t workers, const char *name)
+    /// the pool and queue index of the current worker thread if any
+    static thread_local Pool *currentPool = nullptr;
+    static thread_local size_t currentIdx = 0;
+
+    static void
+    SetCurrentThreadName(const char *name)
     {
-      stop = false;
-      while(workers--)
-      {
-        threads.emplace_back([this, name] {
-          if(name)
-          {
 #if(__APPLE__ && __MACH__)
-            pthread_setname_np(name);
+      pthread_setname_np(name);
 #elif(__FreeBSD__) || (__OpenBSD__) || (__NetBSD__)
-            pthread_set_name_np(pthread_self(), name);
+      pthread_set_name_np(pthread_self(), name);
 #elif(__linux__) || (__MINGW32__)
-            pthread_setname_np(pthread_self(), name);
+      pthread_setname_np(pthread_self(), name);
 #elif defined(_MSC_VER)
-            SetThreadName(GetCurrentThreadId(), name);
+      SetThreadName(GetCurrentThreadId(), name);
 #endif
-          }
-          for(;;)
+    }
+
+    static void
+    PinCurrentThread(int cpu)
+    {
+#if defined(__linux__) && !defined(ANDROID)
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+      int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+      if(err)
+        llarp::LogWarn("failed to pin worker to cpu ", cpu, ": ",
+                       strerror(err));
+      else
+        llarp::LogDebug("pinned worker to cpu ", cpu);
+#else
+      llarp::LogWarn("cannot pin worker to cpu ", cpu,
+                     ", not supported on this platform");
+#endif
+    }
+
+    void
+    Pool::Spawn(size_t workers, const char *name)
+    {
+      stop = false;
+      Prepare(workers);
+      size_t idx = 0;
+      while(workers--)
+      {
+        threads.emplace_back(&Pool::Work, this, idx++, name);
+      }
+    }
+
+#ifdef LLARP_THREADPOOL_GLOBAL_QUEUE
+    void
+    Pool::Prepare(size_t)
+    {
+    }
+
+    void
+    Pool::Work(size_t idx, const char *name)
+    {
+      if(name)
+        SetCurrentThreadName(name);
+      if(cpus.size())
+        PinCurrentThread(cpus[idx % cpus.size()]);
+      for(;;)
+      {
+        Job_t job;
+        {
+          lock_t lock(this->queue_mutex);
+          this->condition.WaitUntil(
+              lock, [this] { return this->stop || !this->jobs.empty(); });
+          if(this->stop)
           {
-            Job_t job;
+            // discard pending jobs
+            while(this->jobs.size())
             {
-              lock_t lock(this->queue_mutex);
-              this->condition.WaitUntil(
-                  lock, [this] { return this->stop || !this->jobs.empty(); });
-              if(this->stop)
-              {
-                // discard pending jobs
-                while(this->jobs.size())
-                {
-                  this->jobs.pop();
-                }
-                return;
-              }
-              job = std::move(this->jobs.top());
               this->jobs.pop();
             }
-            // do work
-            job();
+            return;
           }
-        });
+          job = std::move(this->jobs.top());
+          this->jobs.pop();
+        }
+        // do work
+        job();
       }
     }
 
@@ -83,15 +126,6 @@ namespace llarp
       condition.NotifyAll();
     }
 
-    void
-    Pool::Join()
-    {
-      for(auto &t : threads)
-        t.join();
-      threads.clear();
-      done.NotifyAll();
-    }
-
     void
     Pool::QueueJob(const llarp_thread_job &job)
     {
@@ -105,6 +139,117 @@ namespace llarp
       }
       condition.NotifyOne();
     }
+#else
+    void
+    Pool::Prepare(size_t workers)
+    {
+      if(queues.size())
+        return;
+      if(workers == 0)
+        workers = 1;
+      while(workers--)
+        queues.emplace_back(new WorkQueue());
+    }
+
+    bool
+    Pool::TakeJob(size_t idx, llarp_thread_job &job)
+    {
+      // our own jobs in the order they were queued
+      {
+        lock_t lock(queues[idx]->mutex);
+        auto &q = queues[idx]->jobs;
+        if(q.size())
+        {
+          job = q.front();
+          q.pop_front();
+          --pending;
+          return true;
+        }
+      }
+      // steal the newest job from the next busy worker
+      for(size_t n = 1; n < queues.size(); ++n)
+      {
+        auto &victim = queues[(idx + n) % queues.size()];
+        lock_t lock(victim->mutex);
+        if(victim->jobs.size())
+        {
+          job = victim->jobs.back();
+          victim->jobs.pop_back();
+          --pending;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void
+    Pool::Work(size_t idx, const char *name)
+    {
+      if(name)
+        SetCurrentThreadName(name);
+      if(cpus.size())
+        PinCurrentThread(cpus[idx % cpus.size()]);
+      currentPool = this;
+      currentIdx  = idx;
+      llarp_thread_job job;
+      for(;;)
+      {
+        // discard pending jobs on stop
+        if(stop)
+          return;
+        if(TakeJob(idx, job))
+        {
+          // do work
+          job.work(job.user);
+          continue;
+        }
+        lock_t lock(sleep_mutex);
+        ++idle;
+        condition.WaitUntil(lock, [this] { return stop || pending > 0; });
+        --idle;
+      }
+    }
+
+    void
+    Pool::Stop()
+    {
+      {
+        lock_t lock(sleep_mutex);
+        stop = true;
+      }
+      condition.NotifyAll();
+    }
+
+    void
+    Pool::QueueJob(const llarp_thread_job &job)
+    {
+      // don't allow enqueueing after stopping the pool
+      if(stop)
+        return;
+      // jobs queued by a worker stay on that worker
+      size_t idx = currentPool == this ? currentIdx
+                                       : nextQueue++ % queues.size();
+      {
+        lock_t lock(queues[idx]->mutex);
+        queues[idx]->jobs.push_back(job);
+      }
+      ++pending;
+      if(idle)
+      {
+        lock_t lock(sleep_mutex);
+        condition.NotifyOne();
+      }
+    }
+#endif
+
+    void
+    Pool::Join()
+    {
+      for(auto &t : threads)
+        t.join();
+      threads.clear();
+      done.NotifyAll();
+    }
 
     void
     IsolatedPool::Spawn(size_t workers, const char *name)
@@ -112,7 +257,9 @@ namespace llarp
       IsolatedPool *self      = this;
       self->IsolatedName      = name;
       self->m_IsolatedWorkers = workers;
-      m_isolated              = new std::thread([self] {
+      // queues must exist before the isolated thread spawns the workers
+      Prepare(workers);
+      m_isolated = new std::thread([self] {
         if(!self->IsolateCurrentProcess())
         {
           llarp::LogError("isolation failed: ", strerror(errno));
@@ -192,13 +339,82 @@ struct llarp_threadpool
 {
   llarp::thread::Pool *impl;
 
+  /// jobs queued to a same process pool, lock free for producers
+  std::unique_ptr< llarp::util::MPSCRing< llarp_thread_job > > ring;
+  /// jobs that did not fit in the ring, set while overflow has jobs so that
+  /// producers queue behind them and ordering is kept, the consumer moves
+  /// them back into the ring as it drains so producers go back to the ring
+  /// as soon as the backlog fits in it
+  std::atomic< bool > overflowing{false};
   llarp::util::Mutex m_access;
-  uint32_t ids = 0;
-  std::queue< llarp::thread::Pool::Job_t > jobs;
+  std::queue< llarp_thread_job > overflow;
+
+  std::atomic< uint64_t > enqueued{0};
+  std::atomic< uint64_t > dequeued{0};
+  std::atomic< uint64_t > overflowed{0};
+  std::atomic< uint64_t > maxdepth{0};
+
+  void
+  Enqueue(const llarp_thread_job &job)
+  {
+    enqueued.fetch_add(1, std::memory_order_relaxed);
+    if(!overflowing.load())
+    {
+      llarp_thread_job j = job;
+      if(ring->TryPush(std::move(j)))
+        return;
+    }
+    llarp::util::Lock lock(m_access);
+    overflowing = true;
+    overflow.push(job);
+    overflowed.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /// move as much of the overflow into the ring as fits, lets producers
+  /// use the ring again once it is empty
+  void
+  Refill()
+  {
+    llarp::util::Lock lock(m_access);
+    while(overflow.size())
+    {
+      llarp_thread_job job = overflow.front();
+      if(!ring->TryPush(std::move(job)))
+        return;
+      overflow.pop();
+    }
+    overflowing = false;
+  }
+
+  /// run all pending jobs in the order they were queued
+  void
+  Drain()
+  {
+    const uint64_t depth = enqueued.load(std::memory_order_relaxed)
+        - dequeued.load(std::memory_order_relaxed);
+    if(depth > maxdepth.load(std::memory_order_relaxed))
+      maxdepth.store(depth, std::memory_order_relaxed);
+    llarp_thread_job job;
+    for(;;)
+    {
+      if(ring->TryPop(job))
+      {
+        dequeued.fetch_add(1, std::memory_order_relaxed);
+        job.work(job.user);
+        continue;
+      }
+      if(!overflowing.load())
+        return;
+      // a producer only goes back to the ring once everything it put in
+      // the overflow is in there ahead of it
+      Refill();
+    }
+  }
 
   llarp_threadpool(int workers, const char *name, bool isolate,
                    setup_net_func setup  = nullptr,
-                   run_main_func runmain = nullptr, void *user = nullptr)
+                   run_main_func runmain = nullptr, void *user = nullptr,
+                   std::vector< int > cpus = {})
   {
 #ifdef NET_ISOLATION_SUPPORTED
     if(isolate)
@@ -211,10 +427,12 @@ struct llarp_threadpool
     }
 #endif
       impl = new llarp::thread::Pool();
+    impl->cpus = cpus;
     impl->Spawn(workers, name);
   }
 
-  llarp_threadpool() : impl(nullptr)
+  llarp_threadpool()
+      : impl(nullptr), ring(new llarp::util::MPSCRing< llarp_thread_job >())
   {
   }
 };
@@ -227,6 +445,16 @@ llarp_init_threadpool(int workers, const char *name)
   return new llarp_threadpool(workers, name, false);
 }
 
+struct llarp_threadpool *
+llarp_init_pinned_threadpool(int workers, const char *name, const int *cpus,
+                             size_t numcpus)
+{
+  if(workers <= 0)
+    workers = 1;
+  return new llarp_threadpool(workers, name, false, nullptr, nullptr, nullptr,
+                              std::vector< int >(cpus, cpus + numcpus));
+}
+
 struct llarp_threadpool *
 llarp_init_same_process_threadpool()
 {
@@ -282,24 +510,26 @@ llarp_threadpool_queue_job(struct llarp_threadpool *pool,
   else
   {
     // single threaded mode
-    llarp::util::Lock lock(pool->m_access);
-    pool->jobs.emplace(++pool->ids, job);
+    pool->Enqueue(job);
   }
 }
 
 void
 llarp_threadpool_tick(struct llarp_threadpool *pool)
 {
-  while(pool->jobs.size())
-  {
-    llarp::thread::Pool::Job_t job;
-    {
-      llarp::util::Lock lock(pool->m_access);
-      job = std::move(pool->jobs.front());
-      pool->jobs.pop();
-    }
-    job();
-  }
+  if(pool->ring)
+    pool->Drain();
+}
+
+void
+llarp_threadpool_get_stats(struct llarp_threadpool *pool,
+                           struct llarp_threadpool_stats *stats)
+{
+  stats->enqueued   = pool->enqueued.load(std::memory_order_relaxed);
+  stats->dequeued   = pool->dequeued.load(std::memory_order_relaxed);
+  stats->overflowed = pool->overflowed.load(std::memory_order_relaxed);
+  stats->depth      = stats->enqueued - stats->dequeued;
+  stats->maxdepth   = pool->maxdepth.load(std::memory_order_relaxed);
 }
 
 void
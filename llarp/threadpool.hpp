@@ -4,7 +4,10 @@
 #include <llarp/threadpool.h>
 #include <llarp/threading.hpp>
 
+#include <atomic>
+#include <deque>
 #include <functional>
+#include <memory>
 #include <queue>
 
 #include <thread>
@@ -29,7 +32,15 @@ namespace llarp
 
       void
       Stop();
+
+      /// set up per worker job queues ahead of Spawn so jobs can be queued
+      /// before the workers start
+      void
+      Prepare(size_t workers);
+
       std::vector< std::thread > threads;
+      /// if not empty worker N is pinned to cpus[N % cpus.size()]
+      std::vector< int > cpus;
 
       struct Job_t
       {
@@ -57,12 +68,37 @@ namespace llarp
         }
       };
 
+#ifdef LLARP_THREADPOOL_GLOBAL_QUEUE
       std::priority_queue< Job_t > jobs;
       uint32_t ids = 0;
       mtx_t queue_mutex;
+#else
+      /// jobs queued for one worker, other workers steal from the back
+      struct WorkQueue
+      {
+        mtx_t mutex;
+        std::deque< llarp_thread_job > jobs;
+      };
+
+      std::vector< std::unique_ptr< WorkQueue > > queues;
+      std::atomic< size_t > nextQueue{0};
+      /// jobs queued but not yet taken by a worker
+      std::atomic< size_t > pending{0};
+      /// workers waiting on condition
+      std::atomic< size_t > idle{0};
+      mtx_t sleep_mutex;
+
+      /// take a job from queue idx or steal one from another worker
+      bool
+      TakeJob(size_t idx, llarp_thread_job& job);
+#endif
       util::Condition condition;
       util::Condition done;
-      bool stop;
+      std::atomic< bool > stop{false};
+
+     private:
+      void
+      Work(size_t idx, const char* name);
     };
 
     struct IsolatedPool : public Pool
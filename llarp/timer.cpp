@@ -1,63 +1,18 @@
 #include <llarp/time.h>
-#include <llarp/timer.h>
+#include <llarp/timer.hpp>
 #include <atomic>
 #include <condition_variable>
 #include <list>
-#include <queue>
 #include <unordered_map>
+#include <vector>
 
 #include "logger.hpp"
 
-namespace llarp
-{
-  struct timer
-  {
-    void* user;
-    uint64_t called_at;
-    uint64_t started;
-    uint64_t timeout;
-    llarp_timer_handler_func func;
-    bool done;
-    bool canceled;
-
-    timer(uint64_t ms = 0, void* _user = nullptr,
-          llarp_timer_handler_func _func = nullptr)
-        : user(_user)
-        , called_at(0)
-        , started(llarp_time_now_ms())
-        , timeout(ms)
-        , func(_func)
-        , done(false)
-        , canceled(false)
-    {
-    }
-
-    ~timer()
-    {
-    }
-
-    void
-    exec();
-
-    static void
-    call(void* user)
-    {
-      static_cast< timer* >(user)->exec();
-    }
-
-    bool
-    operator<(const timer& other) const
-    {
-      return (started + timeout) < (other.started + other.timeout);
-    }
-  };
-};  // namespace llarp
-
 struct llarp_timer_context
 {
   llarp::util::Mutex timersMutex;
   std::unordered_map< uint32_t, std::unique_ptr< llarp::timer > > timers;
-  std::priority_queue< std::unique_ptr< llarp::timer > > calling;
+  llarp::TimerWheel wheel;
   llarp::util::Mutex tickerMutex;
   llarp::util::Condition* ticker        = nullptr;
   std::chrono::milliseconds nextTickLen = std::chrono::milliseconds(100);
@@ -83,6 +38,7 @@ struct llarp_timer_context
     _run = false;
   }
 
+  /// canceled timers are called on the next tick
   void
   cancel(uint32_t id)
   {
@@ -91,8 +47,10 @@ struct llarp_timer_context
     if(itr == timers.end())
       return;
     itr->second->canceled = true;
+    wheel.ExpireNow(itr->second.get());
   }
 
+  /// removed timers are never called
   void
   remove(uint32_t id)
   {
@@ -100,22 +58,42 @@ struct llarp_timer_context
     const auto& itr = timers.find(id);
     if(itr == timers.end())
       return;
-    itr->second->func     = nullptr;
-    itr->second->canceled = true;
+    wheel.Unlink(itr->second.get());
+    timers.erase(itr);
   }
 
   uint32_t
   call_later(void* user, llarp_timer_handler_func func, uint64_t timeout_ms)
   {
     llarp::util::Lock lock(timersMutex);
-    uint32_t id = ++ids;
-    timers.insert(
-        std::make_pair(id,
-                       std::unique_ptr< llarp::timer >(
-                           new llarp::timer(timeout_ms, user, func))));
+    uint32_t id     = ++ids;
+    llarp::timer* t = new llarp::timer(timeout_ms, user, func);
+    t->id           = id;
+    timers.emplace(id, std::unique_ptr< llarp::timer >(t));
+    wheel.Insert(t);
     return id;
   }
 
+  /// collect all timers that expired as of now
+  void
+  expire(uint64_t now, std::vector< std::unique_ptr< llarp::timer > >& hit)
+  {
+    llarp::util::Lock lock(timersMutex);
+    wheel.Advance(now, [&](llarp::timer* t) {
+      auto itr = timers.find(t->id);
+      hit.emplace_back(std::move(itr->second));
+      timers.erase(itr);
+    });
+  }
+
+  void
+  clear()
+  {
+    llarp::util::Lock lock(timersMutex);
+    wheel.Clear();
+    timers.clear();
+  }
+
   void
   cancel_all()
   {
@@ -169,7 +147,7 @@ llarp_timer_stop(struct llarp_timer_context* t)
 {
   // destroy all timers
   // don't call callbacks on timers
-  t->timers.clear();
+  t->clear();
   t->stop();
   if(t->ticker)
     t->ticker->NotifyAll();
@@ -187,23 +165,8 @@ llarp_timer_tick_all(struct llarp_timer_context* t)
   if(!t->run())
     return;
   auto now = llarp_time_now_ms();
-  std::list< std::unique_ptr< llarp::timer > > hit;
-  {
-    llarp::util::Lock lock(t->timersMutex);
-    auto itr = t->timers.begin();
-    while(itr != t->timers.end())
-    {
-      if(now - itr->second->started >= itr->second->timeout
-         || itr->second->canceled)
-      {
-        // timer hit
-        hit.emplace_back(std::move(itr->second));
-        itr = t->timers.erase(itr);
-      }
-      else
-        ++itr;
-    }
-  }
+  std::vector< std::unique_ptr< llarp::timer > > hit;
+  t->expire(now, hit);
   for(const auto& h : hit)
   {
     if(h->func)
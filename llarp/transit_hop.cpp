@@ -72,43 +72,37 @@ namespace llarp
         buf.sz = MESSAGE_PAD_SIZE;
       }
       buf.cur = buf.base;
-      return HandleDownstream(buf, N, r);
+      PacketSlice X;
+      X.Borrow(buf);
+      return HandleDownstream(X, N, r);
     }
 
     bool
-    TransitHop::HandleDownstream(llarp_buffer_t buf, const TunnelNonce& Y,
+    TransitHop::HandleDownstream(const PacketSlice& X, const TunnelNonce& Y,
                                  llarp_router* r)
     {
-      RelayDownstreamMessage msg;
-      msg.pathid = info.rxID;
-      msg.Y      = Y ^ nonceXOR;
-      r->crypto.xchacha20(buf, pathKey, Y);
-      msg.X = buf;
-      llarp::LogDebug("relay ", msg.X.size(), " bytes downstream from ",
-                      info.upstream, " to ", info.downstream);
-      return r->SendToOrQueue(info.downstream, &msg);
+      return QueueRelay(X, Y, false, r);
     }
 
     bool
-    TransitHop::HandleUpstream(llarp_buffer_t buf, const TunnelNonce& Y,
+    TransitHop::HandleUpstream(const PacketSlice& X, const TunnelNonce& Y,
                                llarp_router* r)
     {
-      r->crypto.xchacha20(buf, pathKey, Y);
-      if(info.upstream == RouterID(r->pubkey()))
-      {
-        return m_MessageParser.ParseMessageBuffer(buf, this, info.rxID, r);
-      }
-      else
-      {
-        RelayUpstreamMessage msg;
-        msg.pathid = info.txID;
-        msg.Y      = Y ^ nonceXOR;
-
-        msg.X = buf;
-        llarp::LogDebug("relay ", msg.X.size(), " bytes upstream from ",
-                        info.downstream, " to ", info.upstream);
-        return r->SendToOrQueue(info.upstream, &msg);
-      }
+      return QueueRelay(X, Y, true, r);
+    }
+
+    bool
+    TransitHop::QueueRelay(const PacketSlice& X, const TunnelNonce& Y,
+                           bool upstream, llarp_router* r)
+    {
+      RelayPipeline::Job job;
+      job.info     = info;
+      job.key      = pathKey;
+      job.Y        = Y;
+      job.nextY    = Y ^ nonceXOR;
+      job.X        = X;
+      job.upstream = upstream;
+      return r->paths.Relay().Queue(std::move(job));
     }
 
     bool
@@ -167,7 +161,9 @@ namespace llarp
       buf.cur = buf.base;
       // send
       llarp::LogInfo("Transfer ", buf.sz, " bytes", " to ", msg->P);
-      return path->HandleDownstream(buf, msg->Y, r);
+      PacketSlice X;
+      X.Borrow(buf);
+      return path->HandleDownstream(X, msg->Y, r);
     }
 
   }  // namespace path
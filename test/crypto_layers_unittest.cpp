@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include <llarp/buffer.hpp>
+#include <llarp/crypto.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+class CryptoLayersTest : public ::testing::Test
+{
+ public:
+  llarp_crypto crypto;
+  std::vector< llarp::SharedSecret > keys;
+  std::vector< llarp::TunnelNonce > nonces;
+  std::vector< const byte_t* > keyPtrs, noncePtrs;
+
+  CryptoLayersTest()
+  {
+    llarp_crypto_init(&crypto);
+  }
+
+  void
+  MakeLayers(size_t num)
+  {
+    keys.resize(num);
+    nonces.resize(num);
+    keyPtrs.clear();
+    noncePtrs.clear();
+    for(size_t idx = 0; idx < num; ++idx)
+    {
+      keys[idx].Randomize();
+      nonces[idx].Randomize();
+      keyPtrs.push_back(keys[idx]);
+      noncePtrs.push_back(nonces[idx]);
+    }
+  }
+
+  /// what Path did before, one pass per layer
+  void
+  EachLayer(std::vector< byte_t >& data)
+  {
+    auto buf = llarp::InitBuffer(data.data(), data.size());
+    for(size_t idx = 0; idx < keys.size(); ++idx)
+      ASSERT_TRUE(crypto.xchacha20(buf, keys[idx], nonces[idx]));
+  }
+
+  void
+  AllLayers(std::vector< byte_t >& data)
+  {
+    auto buf = llarp::InitBuffer(data.data(), data.size());
+    ASSERT_TRUE(crypto.xchacha20_layers(buf, keyPtrs.data(),
+                                        noncePtrs.data(), keys.size()));
+  }
+};
+
+TEST_F(CryptoLayersTest, TestMatchesEachLayer)
+{
+  for(const size_t layers : {0, 1, 2, 4, 8, 9, 17})
+  {
+    MakeLayers(layers);
+    for(const size_t sz : {0, 1, 63, 64, 65, 1023, 1024, 1025, 3000, 8192})
+    {
+      std::vector< byte_t > data(sz);
+      crypto.randbytes(data.data(), data.size());
+      const auto plain = data;
+      auto expect      = data;
+      EachLayer(expect);
+      AllLayers(data);
+      ASSERT_EQ(data, expect) << layers << " layers " << sz << " bytes";
+      // and back
+      AllLayers(data);
+      ASSERT_EQ(data, plain) << layers << " layers " << sz << " bytes";
+    }
+  }
+};
+
+TEST_F(CryptoLayersTest, DISABLED_BenchLayers)
+{
+  static constexpr size_t Hops = 4;
+  MakeLayers(Hops);
+  for(const size_t sz : {128, 512, 1024, 4096, 8192})
+  {
+    const size_t rounds = (64 * 1024 * 1024) / sz;
+    std::vector< byte_t > data(sz);
+    crypto.randbytes(data.data(), data.size());
+
+    auto start = std::chrono::steady_clock::now();
+    for(size_t n = 0; n < rounds; ++n)
+      EachLayer(data);
+    auto eachTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for(size_t n = 0; n < rounds; ++n)
+      AllLayers(data);
+    auto allTime = std::chrono::steady_clock::now() - start;
+
+    auto mbps = [&](std::chrono::steady_clock::duration d) {
+      auto us =
+          std::chrono::duration_cast< std::chrono::microseconds >(d).count();
+      return us ? double(rounds * sz) / us : 0.0;
+    };
+    std::cout << Hops << " hops " << sz
+              << " bytes: layer by layer " << mbps(eachTime)
+              << " MB/s, all layers " << mbps(allTime) << " MB/s" << std::endl;
+  }
+};
@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
 #include <llarp/dht.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
 using Key_t = llarp::dht::Key_t;
 
 class KademliaDHTTest : public ::testing::Test
@@ -69,3 +73,158 @@ TEST_F(KademliaDHTTest, TestBucketRandomzied)
   target.Randomize();
   ASSERT_TRUE(nodes->FindClosest(target, result));
 };
+
+/// closest n keys to target by scanning everything like the old bucket did
+static std::vector< Key_t >
+ScanClosest(const std::vector< Key_t >& keys, const Key_t& target, size_t n)
+{
+  std::vector< Key_t > sorted = keys;
+  std::sort(sorted.begin(), sorted.end(),
+            [&target](const Key_t& a, const Key_t& b) -> bool {
+              return (a ^ target) < (b ^ target);
+            });
+  sorted.resize(std::min(n, sorted.size()));
+  return sorted;
+}
+
+TEST_F(KademliaDHTTest, TestBucketMatchesScan)
+{
+  llarp::dht::Bucket< llarp::dht::RCNode > bucket(us);
+  std::vector< Key_t > keys;
+  for(size_t idx = 0; idx < 2000; ++idx)
+  {
+    llarp::dht::RCNode n;
+    n.ID.Randomize();
+    bucket.PutNode(n);
+    keys.push_back(n.ID);
+  }
+  // drop some so removal gets exercised too
+  for(size_t idx = 0; idx < keys.size(); idx += 3)
+    bucket.DelNode(keys[idx]);
+  std::vector< Key_t > live;
+  for(size_t idx = 0; idx < keys.size(); ++idx)
+    if(idx % 3)
+      live.push_back(keys[idx]);
+  ASSERT_EQ(bucket.Size(), live.size());
+
+  for(size_t round = 0; round < 100; ++round)
+  {
+    Key_t target;
+    target.Randomize();
+    auto expect = ScanClosest(live, target, 9);
+    std::set< Key_t > exclude = {expect[0]};
+    std::set< Key_t > near;
+    ASSERT_TRUE(bucket.GetManyNearExcluding(target, near, 8, exclude));
+    ASSERT_EQ(near, std::set< Key_t >(expect.begin() + 1, expect.end()));
+    Key_t closest;
+    ASSERT_TRUE(bucket.FindClosest(target, closest));
+    ASSERT_EQ(closest, expect[0]);
+    ASSERT_TRUE(bucket.FindCloseExcluding(target, closest, exclude));
+    ASSERT_EQ(closest, expect[1]);
+  }
+
+  std::set< Key_t > all(live.begin(), live.end());
+  Key_t random;
+  ASSERT_FALSE(bucket.GetRandomNodeExcluding(random, all));
+  auto everything = [](const llarp::dht::RCNode&) -> bool { return true; };
+  ASSERT_EQ(bucket.RemoveIf(everything), live.size());
+  ASSERT_EQ(bucket.Size(), 0U);
+  ASSERT_FALSE(bucket.FindClosest(us, random));
+};
+
+TEST_F(KademliaDHTTest, TestBucketDropsLeastRecentlySeen)
+{
+  llarp::dht::Bucket< llarp::dht::RCNode > bucket(us, 2);
+  // all share no leading bits with us so they land in one k-bucket
+  llarp::dht::RCNode a, b, c;
+  a.ID.Fill(0x81);
+  b.ID.Fill(0x82);
+  c.ID.Fill(0x83);
+  ASSERT_EQ(bucket.CommonPrefix(a.ID, us), 0U);
+  bucket.PutNode(a);
+  bucket.PutNode(b);
+  // seeing a again makes b the stale one
+  bucket.PutNode(a);
+  bucket.PutNode(c);
+  ASSERT_EQ(bucket.BucketSize(0), 2U);
+  ASSERT_NE(bucket.GetNode(a.ID), nullptr);
+  ASSERT_EQ(bucket.GetNode(b.ID), nullptr);
+  ASSERT_NE(bucket.GetNode(c.ID), nullptr);
+  Key_t closest;
+  ASSERT_TRUE(bucket.FindClosest(b.ID, closest));
+  ASSERT_EQ(closest, c.ID);
+};
+
+TEST_F(KademliaDHTTest, DISABLED_BenchBucketLookups)
+{
+  static constexpr size_t Lookups = 1000;
+  // the scan is slow enough that a handful tells us what it costs
+  static constexpr size_t ScanLookups = 20;
+  static constexpr size_t K           = 4;
+  for(const size_t numNodes : {10000, 100000})
+  {
+    llarp::dht::Bucket< llarp::dht::RCNode > bucket(us);
+    std::vector< Key_t > keys(numNodes);
+    for(auto& k : keys)
+    {
+      llarp::dht::RCNode n;
+      n.ID.Randomize();
+      k = n.ID;
+      bucket.PutNode(n);
+    }
+    std::vector< Key_t > targets(Lookups);
+    for(auto& t : targets)
+      t.Randomize();
+    std::set< Key_t > exclude = {us};
+
+    // what GetManyNearExcluding used to cost, one full scan per peer
+    auto start = std::chrono::steady_clock::now();
+    std::vector< std::set< Key_t > > scanned;
+    for(size_t idx = 0; idx < ScanLookups; ++idx)
+    {
+      const Key_t& target = targets[idx];
+      std::set< Key_t > found, skip = exclude;
+      for(size_t n = 0; n < K; ++n)
+      {
+        Key_t best, mindist;
+        mindist.Fill(0xff);
+        for(const auto& k : keys)
+        {
+          if(skip.count(k))
+            continue;
+          auto dist = k ^ target;
+          if(dist < mindist)
+          {
+            mindist = dist;
+            best    = k;
+          }
+        }
+        skip.insert(best);
+        found.insert(best);
+      }
+      scanned.emplace_back(std::move(found));
+    }
+    auto scanTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    std::vector< std::set< Key_t > > walked;
+    for(const auto& target : targets)
+    {
+      std::set< Key_t > found;
+      ASSERT_TRUE(bucket.GetManyNearExcluding(target, found, K, exclude));
+      walked.emplace_back(std::move(found));
+    }
+    auto walkTime = std::chrono::steady_clock::now() - start;
+    for(size_t idx = 0; idx < ScanLookups; ++idx)
+      ASSERT_EQ(scanned[idx], walked[idx]);
+
+    auto perLookup = [](std::chrono::steady_clock::duration d, size_t n) {
+      return std::chrono::duration_cast< std::chrono::nanoseconds >(d).count()
+          / n;
+    };
+    std::cout << numNodes << " nodes, closest " << K << " per lookup: "
+              << "linear scan " << perLookup(scanTime, ScanLookups)
+              << "ns, k-buckets " << perLookup(walkTime, Lookups) << "ns"
+              << std::endl;
+  }
+};
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include <llarp/dht/verifier.hpp>
+#include <llarp/service/Identity.hpp>
+#include <llarp/time.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/// counts ed25519 verifies that make it past the cache
+static std::atomic< size_t > verifies(0);
+static llarp_verify_func realVerify = nullptr;
+
+static bool
+CountingVerify(const byte_t* pk, llarp_buffer_t buf, const byte_t* sig)
+{
+  ++verifies;
+  return realVerify(pk, buf, sig);
+}
+
+class DHTVerifierTest : public ::testing::Test
+{
+ public:
+  llarp_crypto crypto;
+  llarp_threadpool* worker = nullptr;
+  llarp_threadpool* thread = nullptr;
+  llarp_logic* logic       = nullptr;
+  llarp::dht::Verifier verifier;
+
+  DHTVerifierTest()
+  {
+    llarp_crypto_init(&crypto);
+    realVerify    = crypto.verify;
+    crypto.verify = &CountingVerify;
+  }
+
+  void
+  SetUp()
+  {
+    verifies = 0;
+    worker   = llarp_init_threadpool(2, "test-verify");
+    thread   = llarp_init_same_process_threadpool();
+    logic    = llarp_init_single_process_logic(thread);
+    verifier.Init(&crypto, worker, logic);
+  }
+
+  void
+  TearDown()
+  {
+    llarp_threadpool_stop(worker);
+    llarp_threadpool_join(worker);
+    llarp_free_threadpool(&worker);
+    llarp_free_logic(&logic);
+    llarp_free_threadpool(&thread);
+  }
+
+  llarp::RouterContact
+  MakeRC()
+  {
+    llarp::SecretKey sk;
+    crypto.identity_keygen(sk);
+    llarp::RouterContact rc;
+    EXPECT_TRUE(rc.Sign(&crypto, sk));
+    return rc;
+  }
+
+  bool
+  RunUntilDone()
+  {
+    auto giveup = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while(verifier.Pending())
+    {
+      if(std::chrono::steady_clock::now() > giveup)
+        return false;
+      llarp_logic_tick(logic);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+  }
+};
+
+TEST_F(DHTVerifierTest, TestBatchedWithCache)
+{
+  static constexpr size_t NumRCs = 20;
+  std::vector< llarp::RouterContact > rcs;
+  for(size_t idx = 0; idx < NumRCs; ++idx)
+    rcs.emplace_back(MakeRC());
+  // changed after signing
+  rcs[7].last_updated += 1;
+  verifies = 0;
+
+  std::vector< int > results(NumRCs, -1);
+  auto queueAll = [&]() {
+    for(size_t idx = 0; idx < NumRCs; ++idx)
+    {
+      llarp::dht::Verifier::Job job;
+      job.rcs.push_back(rcs[idx]);
+      job.result = [&results, idx](llarp::dht::Verifier::Job& j) {
+        results[idx] = j.valid;
+      };
+      verifier.Queue(std::move(job));
+    }
+  };
+
+  queueAll();
+  // results only come back on the logic thread
+  for(const auto result : results)
+    ASSERT_EQ(result, -1);
+  ASSERT_TRUE(RunUntilDone());
+  for(size_t idx = 0; idx < NumRCs; ++idx)
+    ASSERT_EQ(results[idx], idx == 7 ? 0 : 1);
+  ASSERT_EQ(verifies, NumRCs);
+  ASSERT_EQ(verifier.CacheSize(), NumRCs - 1);
+
+  // the same blobs again only check the bad one
+  results.assign(NumRCs, -1);
+  queueAll();
+  ASSERT_TRUE(RunUntilDone());
+  for(size_t idx = 0; idx < NumRCs; ++idx)
+    ASSERT_EQ(results[idx], idx == 7 ? 0 : 1);
+  ASSERT_EQ(verifies, NumRCs + 1);
+};
+
+TEST_F(DHTVerifierTest, TestIntroSetInline)
+{
+  verifier.batchSize = 0;
+  llarp::service::Identity ident;
+  ident.RegenerateKeys(&crypto);
+  llarp::service::IntroSet introset;
+  llarp::service::Introduction intro;
+  intro.router.Randomize();
+  intro.pathID.Randomize();
+  intro.expiresAt = llarp_time_now_ms() + 60 * 1000;
+  introset.I.push_back(intro);
+  ASSERT_TRUE(ident.SignIntroSet(introset, &crypto));
+  verifies = 0;
+
+  bool valid = false;
+  llarp::dht::Verifier::Job job;
+  job.introsets.push_back(introset);
+  job.result = [&valid](llarp::dht::Verifier::Job& j) { valid = j.valid; };
+  verifier.Queue(std::move(job));
+  ASSERT_TRUE(valid);
+  ASSERT_EQ(verifies, 1U);
+  ASSERT_TRUE(verifier.Verify(introset));
+  ASSERT_EQ(verifies, 1U);
+
+  introset.Z.Randomize();
+  ASSERT_FALSE(verifier.Verify(introset));
+  ASSERT_EQ(verifies, 2U);
+};
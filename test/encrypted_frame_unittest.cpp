@@ -62,3 +62,74 @@ TEST_F(FrameTest, TestFrameCrypto)
   ASSERT_TRUE(otherRecord.BDecode(buf));
   ASSERT_TRUE(otherRecord == record);
 };
+
+TEST_F(FrameTest, TestCommitFramesRotate)
+{
+  typedef llarp::LR_CommitFrames Frames;
+  llarp::LR_CommitMessage msg;
+  msg.frames.Randomize();
+  auto frame = [](Frames& frames, size_t idx) {
+    auto buf = frames.Frame(idx);
+    return std::vector< byte_t >(buf.base, buf.base + buf.sz);
+  };
+
+  // the first hop's record is encrypted in place and comes back
+  LRCR record;
+  record.nextHop.Fill(1);
+  record.txid.Fill(4);
+  auto buf = msg.frames.Frame(0);
+  buf.cur  = buf.base + EncryptedFrame::OverheadSize;
+  ASSERT_TRUE(record.BEncode(&buf));
+  ASSERT_TRUE(EncryptedFrame::EncryptInPlace(
+      msg.frames.Frame(0), alice, llarp::seckey_topublic(bob), &crypto));
+
+  // over the wire
+  byte_t tmp[MAX_LINK_MSG_SIZE];
+  auto wire = llarp::StackBuffer< decltype(tmp) >(tmp);
+  ASSERT_TRUE(msg.frames.BEncode(&wire));
+  wire.sz  = wire.cur - wire.base;
+  wire.cur = wire.base;
+  Frames got(1);
+  ASSERT_TRUE(got.BDecode(&wire));
+  ASSERT_EQ(got.FrameSize(), Frames::DefaultFrameSize);
+  for(size_t idx = 0; idx < Frames::NumFrames; ++idx)
+    ASSERT_EQ(frame(got, idx), frame(msg.frames, idx));
+
+  buf = got.Frame(0);
+  ASSERT_TRUE(EncryptedFrame::DecryptInPlace(buf, bob, &crypto));
+  buf.cur = buf.base + EncryptedFrame::OverheadSize;
+  LRCR otherRecord;
+  ASSERT_TRUE(otherRecord.BDecode(&buf));
+  ASSERT_TRUE(otherRecord == record);
+
+  // all frames are the same size and there is one per hop
+  for(const size_t num : {Frames::NumFrames - 1, Frames::NumFrames})
+  {
+    wire = llarp::StackBuffer< decltype(tmp) >(tmp);
+    ASSERT_TRUE(bencode_start_list(&wire));
+    for(size_t idx = 0; idx < num; ++idx)
+    {
+      // short a frame, or the last one a byte too big
+      const bool big  = num == Frames::NumFrames && idx + 1 == num;
+      const size_t sz = Frames::DefaultFrameSize + big;
+      std::vector< byte_t > junk(sz);
+      ASSERT_TRUE(bencode_write_bytestring(&wire, junk.data(), sz));
+    }
+    ASSERT_TRUE(bencode_end(&wire));
+    wire.cur = wire.base;
+    Frames bad;
+    ASSERT_FALSE(bad.BDecode(&wire));
+  }
+
+  // each hop shifts the rest down and puts junk on the end
+  for(size_t hop = 0; hop < 2 * Frames::NumFrames; ++hop)
+  {
+    std::vector< std::vector< byte_t > > before;
+    for(size_t idx = 0; idx < Frames::NumFrames; ++idx)
+      before.push_back(frame(got, idx));
+    got.Rotate();
+    for(size_t idx = 0; idx + 1 < Frames::NumFrames; ++idx)
+      ASSERT_EQ(frame(got, idx), before[idx + 1]);
+    ASSERT_NE(frame(got, Frames::NumFrames - 1), before[0]);
+  }
+};
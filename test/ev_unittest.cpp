@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include <ev.hpp>
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+
+struct DatagramCounter
+{
+  size_t recv = 0;
+  std::thread::id thread;
+  bool wrongThread = false;
+
+  static void
+  RecvFrom(llarp_udp_io* udp, const sockaddr*, const void*, ssize_t)
+  {
+    DatagramCounter* self = static_cast< DatagramCounter* >(udp->user);
+    if(std::this_thread::get_id() != self->thread)
+      self->wrongThread = true;
+    ++self->recv;
+  }
+};
+
+class EventLoopTest : public ::testing::Test
+{
+ public:
+  llarp_ev_loop* loop = nullptr;
+  llarp_udp_io udp;
+  DatagramCounter counter;
+  sockaddr_in addr;
+
+  void
+  SetUp()
+  {
+    llarp_ev_loop_alloc(&loop);
+    counter.thread = std::this_thread::get_id();
+    memset(&udp, 0, sizeof(udp));
+    udp.user     = &counter;
+    udp.recvfrom = &DatagramCounter::RecvFrom;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  }
+
+  void
+  TearDown()
+  {
+    llarp_ev_close_udp(&udp);
+    llarp_ev_loop_free(&loop);
+  }
+
+  /// bind to an ephemeral port and find out which one we got
+  void
+  Listen()
+  {
+    ASSERT_EQ(llarp_ev_add_udp(loop, &udp, (const sockaddr*)&addr), 0);
+    socklen_t slen = sizeof(addr);
+    ASSERT_NE(getsockname(udp.fd, (sockaddr*)&addr, &slen), -1);
+  }
+
+  void
+  SendFrom(int fd, size_t num)
+  {
+    char buf[64] = {0};
+    for(size_t idx = 0; idx < num; ++idx)
+      ASSERT_EQ(::sendto(fd, buf, sizeof(buf), 0, (const sockaddr*)&addr,
+                         sizeof(addr)),
+                ssize_t(sizeof(buf)));
+  }
+};
+
+TEST_F(EventLoopTest, TestDrainsUntilWouldBlock)
+{
+  // more than one recvmmsg batch but not enough to overflow the socket
+  static constexpr size_t NumDatagrams = 60;
+  Listen();
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  SendFrom(fd, NumDatagrams);
+  loop->tick(100);
+  close(fd);
+  ASSERT_EQ(counter.recv, NumDatagrams);
+};
+
+TEST_F(EventLoopTest, TestMirrorDeliversOnOwnerThread)
+{
+  static constexpr size_t NumRemotes = 16;
+  static constexpr size_t PerRemote  = 4;
+  llarp_ev_loop_set_reuseport(loop, true);
+  Listen();
+
+  llarp_ev_loop* mirror = nullptr;
+  llarp_ev_loop_alloc(&mirror);
+  ASSERT_EQ(llarp_ev_udp_mirror(mirror, &udp), 0);
+  std::thread net([mirror]() { llarp_ev_loop_run(mirror, nullptr); });
+
+  // each remote hashes to one of the two sockets by its 4-tuple
+  std::vector< int > remotes;
+  for(size_t idx = 0; idx < NumRemotes; ++idx)
+  {
+    remotes.push_back(socket(AF_INET, SOCK_DGRAM, 0));
+    SendFrom(remotes.back(), PerRemote);
+  }
+  auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(2000);
+  while(counter.recv < NumRemotes * PerRemote
+        && std::chrono::steady_clock::now() < deadline)
+    loop->tick(10);
+
+  llarp_ev_loop_stop(mirror);
+  net.join();
+  llarp_ev_loop_free(&mirror);
+  for(int fd : remotes)
+    close(fd);
+
+  ASSERT_EQ(counter.recv, NumRemotes * PerRemote);
+  ASSERT_FALSE(counter.wrongThread);
+  llarp_udp_stats stats;
+  llarp_ev_udp_get_stats(&udp, &stats);
+  // the rest came in through the mirror
+  ASSERT_LT(stats.rx_pkts, NumRemotes * PerRemote);
+};
+
+#endif
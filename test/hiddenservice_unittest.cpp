@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #include <llarp/service.hpp>
 
+#include <chrono>
+#include <iostream>
+
 struct HiddenServiceTest : public ::testing::Test
 {
   llarp_crypto crypto;
@@ -51,3 +54,86 @@ TEST_F(HiddenServiceTest, TestAddressToFromString)
   ASSERT_TRUE(addr.FromString(str));
   ASSERT_TRUE(addr == ident.pub.Addr());
 }
+
+TEST_F(HiddenServiceTest, TestFrameMAC)
+{
+  llarp::SharedSecret K;
+  K.Randomize();
+  llarp::service::ProtocolMessage msg;
+  msg.sender = ident.pub;
+  std::string payload("hello world");
+  msg.PutBuffer(llarp::InitBuffer(payload.data(), payload.size()));
+  llarp::service::ProtocolFrame frame;
+  frame.N.Randomize();
+  frame.T.Randomize();
+  ASSERT_TRUE(frame.EncryptAndMAC(Crypto(), msg, K));
+  ASSERT_FALSE(frame.M.IsZero());
+  ASSERT_TRUE(frame.Z.IsZero());
+
+  byte_t tmp[llarp::service::MAX_PROTOCOL_MESSAGE_SIZE];
+  auto buf = llarp::StackBuffer< decltype(tmp) >(tmp);
+  ASSERT_TRUE(frame.BEncode(&buf));
+  buf.sz  = buf.cur - buf.base;
+  buf.cur = buf.base;
+  llarp::service::ProtocolFrame decoded;
+  ASSERT_TRUE(decoded.BDecode(&buf));
+  ASSERT_EQ(decoded, frame);
+  ASSERT_TRUE(decoded.VerifyMAC(Crypto(), K));
+  llarp::service::ProtocolMessage got;
+  ASSERT_TRUE(decoded.DecryptPayloadInto(Crypto(), K, got));
+  ASSERT_EQ(std::string((char*)got.payload.data(), got.payload.size()),
+            payload);
+  // so the remote knows it can send us frames with a mac
+  ASSERT_EQ(got.version, llarp::service::ProtocolMessageVersionMAC);
+
+  llarp::SharedSecret other;
+  other.Randomize();
+  ASSERT_FALSE(decoded.VerifyMAC(Crypto(), other));
+  decoded.T.Randomize();
+  ASSERT_FALSE(decoded.VerifyMAC(Crypto(), K));
+  decoded   = frame;
+  auto body = decoded.D.Buffer();
+  body->base[0] ^= 1;
+  ASSERT_FALSE(decoded.VerifyMAC(Crypto(), K));
+  // signed frames have no mac
+  ASSERT_TRUE(frame.EncryptAndSign(Crypto(), msg, K, ident));
+  ASSERT_TRUE(frame.M.IsZero());
+  ASSERT_FALSE(frame.VerifyMAC(Crypto(), K));
+  ASSERT_TRUE(frame.Verify(Crypto(), ident.pub));
+}
+
+TEST_F(HiddenServiceTest, DISABLED_BenchFrameSignVsMAC)
+{
+  static constexpr size_t Frames = 2000;
+  llarp::SharedSecret K;
+  K.Randomize();
+  llarp::service::ProtocolMessage msg;
+  msg.sender = ident.pub;
+  msg.payload.resize(1400);
+  llarp::service::ProtocolFrame frame;
+  frame.N.Randomize();
+  frame.T.Randomize();
+
+  auto start = std::chrono::steady_clock::now();
+  for(size_t idx = 0; idx < Frames; ++idx)
+  {
+    ASSERT_TRUE(frame.EncryptAndSign(Crypto(), msg, K, ident));
+    ASSERT_TRUE(frame.Verify(Crypto(), ident.pub));
+  }
+  auto signTime = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for(size_t idx = 0; idx < Frames; ++idx)
+  {
+    ASSERT_TRUE(frame.EncryptAndMAC(Crypto(), msg, K));
+    ASSERT_TRUE(frame.VerifyMAC(Crypto(), K));
+  }
+  auto macTime = std::chrono::steady_clock::now() - start;
+
+  auto us = [](std::chrono::steady_clock::duration d) {
+    return std::chrono::duration_cast< std::chrono::microseconds >(d).count()
+        / Frames;
+  };
+  std::cout << "1400 byte frame send + receive: signed " << us(signTime)
+            << "us, mac " << us(macTime) << "us" << std::endl;
+}
@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+#include <llarp/crypto.h>
+#include <llarp/dht/introset_store.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+
+class IntroSetStoreTest : public ::testing::Test
+{
+ public:
+  llarp::dht::Key_t us;
+
+  void
+  SetUp()
+  {
+    us.Randomize();
+  }
+
+  /// an introset for a random service with its last intro running out at
+  /// expiresAt, only what the store looks at is filled in
+  static llarp::service::IntroSet
+  MakeIntroSet(const std::string& topic, llarp_time_t expiresAt,
+               llarp_time_t T = 1)
+  {
+    llarp::PubKey enc, sign;
+    enc.Randomize();
+    sign.Randomize();
+    llarp::service::IntroSet introset;
+    introset.A.Update(enc, sign);
+    introset.topic = topic;
+    introset.T     = T;
+    llarp::service::Introduction intro;
+    intro.expiresAt = expiresAt;
+    introset.I.push_back(intro);
+    return introset;
+  }
+
+  static llarp::dht::Key_t
+  AddrOf(const llarp::service::IntroSet& introset)
+  {
+    llarp::dht::Key_t addr;
+    introset.A.CalculateAddress(addr);
+    return addr;
+  }
+};
+
+TEST_F(IntroSetStoreTest, TestTagLookupAndExpiry)
+{
+  const llarp::service::Tag tagged(std::string("tagged"));
+  const llarp::service::Tag other(std::string("other"));
+  const llarp::service::Tag movedTag(std::string("moved"));
+  llarp::dht::IntroSetStore store(us);
+  std::vector< llarp::service::IntroSet > introsets;
+  for(size_t idx = 0; idx < 300; ++idx)
+  {
+    introsets.emplace_back(
+        MakeIntroSet(idx % 3 ? "tagged" : "", 1000 + (idx % 10) * 100));
+    ASSERT_TRUE(store.Put(introsets.back()));
+  }
+  ASSERT_EQ(store.Size(), introsets.size());
+
+  auto found = store.FindRandomWithTagExcluding(tagged, 1000, {});
+  ASSERT_EQ(found.size(), 200U);
+  for(const auto& introset : found)
+    ASSERT_EQ(introset.topic.ToString(), "tagged");
+  auto some = store.FindRandomWithTagExcluding(tagged, 5, {});
+  ASSERT_EQ(some.size(), 5U);
+  auto rest = store.FindRandomWithTagExcluding(tagged, 1000, some);
+  ASSERT_EQ(rest.size(), 195U);
+  ASSERT_EQ(store.FindRandomWithTagExcluding(other, 10, {}).size(), 0U);
+
+  // a newer one moves to another tag and lives longer
+  auto moved  = introsets[1];
+  moved.topic = movedTag;
+  moved.T     = 2;
+  moved.I[0].expiresAt += 10000;
+  ASSERT_TRUE(store.Put(moved));
+  ASSERT_EQ(store.Size(), introsets.size());
+  ASSERT_EQ(store.FindRandomWithTagExcluding(movedTag, 10, {}).size(), 1U);
+  ASSERT_EQ(store.FindRandomWithTagExcluding(tagged, 1000, {}).size(), 199U);
+  // an older one does not replace it
+  ASSERT_TRUE(store.Put(introsets[1]));
+  ASSERT_EQ(store.Get(AddrOf(moved))->topic.ToString(), "moved");
+
+  ASSERT_EQ(store.Expire(999), 0U);
+  ASSERT_EQ(store.Expire(1000), 30U);
+  ASSERT_EQ(store.Expire(1450), 119U);
+  for(size_t idx = 0; idx < introsets.size(); ++idx)
+  {
+    const bool gone = idx != 1 && introsets[idx].I[0].expiresAt <= 1450;
+    ASSERT_EQ(store.Get(AddrOf(introsets[idx])) == nullptr, gone);
+  }
+  ASSERT_EQ(store.Expire(5000), 150U);
+  ASSERT_EQ(store.Size(), 1U);
+  ASSERT_EQ(store.FindRandomWithTagExcluding(tagged, 1000, {}).size(), 0U);
+  ASSERT_EQ(store.Expire(20000), 1U);
+  ASSERT_EQ(store.Size(), 0U);
+};
+
+TEST_F(IntroSetStoreTest, TestFullDropsFarthest)
+{
+  static constexpr size_t Max = 100;
+  llarp::dht::IntroSetStore store(us, Max);
+  std::vector< llarp::dht::Key_t > addrs;
+  for(size_t idx = 0; idx < Max * 3; ++idx)
+  {
+    auto introset = MakeIntroSet("", 1000);
+    store.Put(introset);
+    addrs.push_back(AddrOf(introset));
+  }
+  ASSERT_EQ(store.Size(), Max);
+  std::sort(addrs.begin(), addrs.end(),
+            [&](const llarp::dht::Key_t& a, const llarp::dht::Key_t& b) {
+              return (a ^ us) < (b ^ us);
+            });
+  for(size_t idx = 0; idx < addrs.size(); ++idx)
+    ASSERT_EQ(store.Get(addrs[idx]) != nullptr, idx < Max);
+  ASSERT_EQ(store.Expire(1000), Max);
+};
+
+TEST_F(IntroSetStoreTest, DISABLED_Bench50kIntroSets)
+{
+  static constexpr size_t NumIntroSets = 50000;
+  static constexpr size_t NumTags      = 100;
+  static constexpr size_t Lookups      = 1000;
+  llarp::dht::IntroSetStore store(us, NumIntroSets);
+  // what the dht used to keep them in
+  std::map< llarp::dht::Key_t, llarp::service::IntroSet > scan;
+  for(size_t idx = 0; idx < NumIntroSets; ++idx)
+  {
+    auto introset =
+        MakeIntroSet("tag-" + std::to_string(idx % NumTags), 1000 + idx);
+    store.Put(introset);
+    scan.emplace(AddrOf(introset), introset);
+  }
+
+  auto start        = std::chrono::steady_clock::now();
+  size_t foundTotal = 0;
+  for(size_t idx = 0; idx < Lookups; ++idx)
+  {
+    std::string tagname = "tag-" + std::to_string(idx % NumTags);
+    std::set< llarp::service::IntroSet > found;
+    // start at random middle point and wrap around like the dht did
+    auto itr = scan.begin();
+    std::advance(itr, llarp_randint() % scan.size());
+    for(size_t n = 0; n < scan.size() && found.size() < 2; ++n)
+    {
+      if(itr->second.topic.ToString() == tagname)
+        found.insert(itr->second);
+      if(++itr == scan.end())
+        itr = scan.begin();
+    }
+    foundTotal += found.size();
+  }
+  auto scanTime = std::chrono::steady_clock::now() - start;
+
+  start             = std::chrono::steady_clock::now();
+  size_t foundIndex = 0;
+  for(size_t idx = 0; idx < Lookups; ++idx)
+  {
+    llarp::service::Tag tag("tag-" + std::to_string(idx % NumTags));
+    foundIndex += store.FindRandomWithTagExcluding(tag, 2, {}).size();
+  }
+  auto indexTime = std::chrono::steady_clock::now() - start;
+  ASSERT_EQ(foundTotal, foundIndex);
+
+  // a cleaner tick where a handful expired
+  const llarp_time_t now = 1010;
+  start                  = std::chrono::steady_clock::now();
+  size_t expiredWalk     = 0;
+  for(const auto& item : scan)
+    if(item.second.GetNewestIntroExpiration() <= now)
+      ++expiredWalk;
+  auto walkTime = std::chrono::steady_clock::now() - start;
+
+  start              = std::chrono::steady_clock::now();
+  size_t expiredHeap = store.Expire(now);
+  auto heapTime      = std::chrono::steady_clock::now() - start;
+  ASSERT_EQ(expiredWalk, expiredHeap);
+
+  auto us = [](std::chrono::steady_clock::duration d) {
+    return std::chrono::duration_cast< std::chrono::microseconds >(d).count();
+  };
+  std::cout << NumIntroSets << " introsets, " << Lookups
+            << " tag lookups: full scan " << us(scanTime) << "us, tag index "
+            << us(indexTime) << "us" << std::endl;
+  std::cout << "expiry check: full walk " << us(walkTime)
+            << "us, expiry heap " << us(heapTime) << "us" << std::endl;
+};
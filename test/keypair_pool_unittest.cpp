@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include <llarp/keypair_pool.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <thread>
+
+class KeypairPoolTest : public ::testing::Test
+{
+ public:
+  llarp_crypto crypto;
+  llarp_threadpool* worker = nullptr;
+  /// outlives the worker, which may still be refilling it
+  llarp::KeypairPool pool{&crypto};
+
+  KeypairPoolTest()
+  {
+    llarp_crypto_init(&crypto);
+  }
+
+  void
+  SetUp()
+  {
+    worker = llarp_init_threadpool(2, "test-keypairs");
+  }
+
+  void
+  TearDown()
+  {
+    llarp_threadpool_stop(worker);
+    llarp_threadpool_join(worker);
+    llarp_free_threadpool(&worker);
+  }
+
+  /// wait up to a few seconds for the pool to hold at least num keypairs
+  bool
+  WaitFor(size_t num) const
+  {
+    for(size_t n = 0; n < 500 && pool.Size() < num; ++n)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return pool.Size() >= num;
+  }
+};
+
+TEST_F(KeypairPoolTest, TestTakeAndRefill)
+{
+  pool.capacity = 16;
+  // no worker, every key is made on the spot
+  llarp::SecretKey k;
+  pool.Take(k);
+  ASSERT_EQ(pool.Size(), 0U);
+  ASSERT_EQ(pool.Misses(), 1U);
+  ASSERT_FALSE(k.IsZero());
+
+  pool.Init(worker);
+  ASSERT_TRUE(WaitFor(16));
+
+  // all distinct, the public half matches the secret
+  std::set< llarp::PubKey > seen;
+  for(size_t idx = 0; idx < 8; ++idx)
+  {
+    pool.Take(k);
+    ASSERT_TRUE(seen.emplace(llarp::seckey_topublic(k)).second);
+  }
+  ASSERT_EQ(pool.Misses(), 1U);
+  // down to half, tops back up
+  ASSERT_TRUE(WaitFor(16));
+
+  // drained dry it still hands out fresh keys
+  for(size_t idx = 0; idx < 64; ++idx)
+  {
+    pool.Take(k);
+    ASSERT_TRUE(seen.emplace(llarp::seckey_topublic(k)).second);
+  }
+  // a refill may have finished before the last few takes, so it is only
+  // sure to be back above half
+  ASSERT_TRUE(WaitFor(pool.capacity / 2 + 1));
+};
+
+TEST_F(KeypairPoolTest, DISABLED_BenchTake)
+{
+  static constexpr size_t Rounds = 4096;
+  pool.capacity = Rounds;
+  llarp::SecretKey k;
+
+  auto start = std::chrono::steady_clock::now();
+  for(size_t n = 0; n < Rounds; ++n)
+    crypto.encryption_keygen(k);
+  auto keygenTime = std::chrono::steady_clock::now() - start;
+
+  pool.Init(worker);
+  ASSERT_TRUE(WaitFor(Rounds));
+  start = std::chrono::steady_clock::now();
+  for(size_t n = 0; n < Rounds; ++n)
+    pool.Take(k);
+  auto takeTime = std::chrono::steady_clock::now() - start;
+
+  auto us = [](std::chrono::steady_clock::duration d) {
+    return std::chrono::duration_cast< std::chrono::microseconds >(d).count();
+  };
+  std::cout << Rounds << " keypairs: keygen " << us(keygenTime)
+            << "us, from pool " << us(takeTime) << "us" << std::endl;
+};
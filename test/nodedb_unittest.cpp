@@ -0,0 +1,355 @@
+#include <gtest/gtest.h>
+#include <llarp/nodedb.hpp>
+#include <llarp/profiling.hpp>
+#include <encode.hpp>
+#include <fs.hpp>
+
+#include <sys/stat.h>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <thread>
+
+class NodeDBTest : public ::testing::Test
+{
+ public:
+  llarp_crypto crypto;
+  llarp_threadpool* worker = nullptr;
+  fs::path dir;
+  /// the rc we put in with a good signature
+  std::vector< llarp::PubKey > good;
+
+  NodeDBTest()
+  {
+    llarp_crypto_init(&crypto);
+  }
+
+  void
+  SetUp()
+  {
+    dir = fs::temp_directory_path()
+        / ("nodedb-test-" + std::to_string(llarp_randint()));
+    ASSERT_TRUE(llarp_nodedb_ensure_dir(dir.string().c_str()));
+    worker = llarp_init_threadpool(
+        std::max(std::thread::hardware_concurrency(), 2U), "test-nodedb");
+  }
+
+  void
+  TearDown()
+  {
+    llarp_threadpool_stop(worker);
+    llarp_threadpool_join(worker);
+    llarp_free_threadpool(&worker);
+    fs::remove_all(dir);
+  }
+
+  /// put num signed rc into the skiplist at dir, the last one is changed
+  /// after signing if bad is set
+  void
+  WriteRCs(size_t num, bool bad)
+  {
+    llarp_nodedb* db = llarp_nodedb_new(&crypto);
+    llarp_nodedb_set_dir(db, dir.string().c_str());
+    for(size_t idx = 0; idx < num; ++idx)
+    {
+      llarp::SecretKey sk;
+      crypto.identity_keygen(sk);
+      llarp::RouterContact rc;
+      ASSERT_TRUE(rc.Sign(&crypto, sk));
+      if(bad && idx + 1 == num)
+        rc.last_updated += 1;
+      else
+        good.push_back(rc.pubkey);
+      ASSERT_TRUE(llarp_nodedb_put_rc(db, rc));
+    }
+    llarp_nodedb_free(&db);
+  }
+
+  /// load dir into a new nodedb and check we got all the good rc
+  llarp_nodedb*
+  Load(llarp_threadpool* tp)
+  {
+    llarp_nodedb* db = llarp_nodedb_new(&crypto);
+    EXPECT_EQ(llarp_nodedb_load_dir_parallel(db, dir.string().c_str(), tp),
+              ssize_t(good.size()));
+    EXPECT_EQ(llarp_nodedb_num_loaded(db), good.size());
+    llarp::RouterContact rc;
+    for(const auto& pk : good)
+      EXPECT_TRUE(llarp_nodedb_get_rc(db, pk, rc));
+    return db;
+  }
+
+  fs::path
+  SnapshotPath() const
+  {
+    return dir / "rcs.snapshot";
+  }
+};
+
+TEST_F(NodeDBTest, TestParallelLoadAndSnapshot)
+{
+  WriteRCs(300, true);
+  llarp_nodedb* db = Load(nullptr);
+  llarp_nodedb_free(&db);
+  db = Load(worker);
+
+  ASSERT_TRUE(llarp_nodedb_write_snapshot(db));
+  ASSERT_TRUE(fs::exists(SnapshotPath()));
+  llarp_nodedb_free(&db);
+  // twice, it stays until something changes
+  db = Load(nullptr);
+  llarp_nodedb_free(&db);
+  db = Load(worker);
+  ASSERT_TRUE(fs::exists(SnapshotPath()));
+
+  // changing the nodedb drops it
+  ASSERT_TRUE(llarp_nodedb_del_rc(db, good.back()));
+  good.pop_back();
+  ASSERT_FALSE(fs::exists(SnapshotPath()));
+  ASSERT_TRUE(llarp_nodedb_write_snapshot(db));
+  llarp_nodedb_free(&db);
+
+  // a broken snapshot falls back to the rc files
+  {
+    std::fstream f(SnapshotPath().string(),
+                   std::ios::binary | std::ios::in | std::ios::out);
+    f.seekp(100);
+    f.put('X');
+  }
+  db = Load(worker);
+  // and is gone since it did not get used
+  ASSERT_FALSE(fs::exists(SnapshotPath()));
+  ASSERT_TRUE(llarp_nodedb_write_snapshot(db));
+  llarp_nodedb_free(&db);
+  {
+    std::ofstream f(SnapshotPath().string(),
+                    std::ios::binary | std::ios::in | std::ios::out);
+    f.seekp(0);
+    f.write("llrcsnp2\0\0\xff\xff", 12);
+  }
+  db = Load(worker);
+  llarp_nodedb_free(&db);
+};
+
+TEST_F(NodeDBTest, TestSnapshotFromEarlierRunDropped)
+{
+  WriteRCs(10, false);
+  llarp_nodedb* db = Load(worker);
+  ASSERT_TRUE(llarp_nodedb_write_snapshot(db));
+  llarp_nodedb_free(&db);
+
+  // a nodedb that never loaded it still removes it once it changes
+  ASSERT_TRUE(fs::exists(SnapshotPath()));
+  WriteRCs(1, false);
+  ASSERT_FALSE(fs::exists(SnapshotPath()));
+};
+
+TEST_F(NodeDBTest, TestSnapshotWithDirtyRC)
+{
+  WriteRCs(10, false);
+  llarp_nodedb* db = Load(worker);
+  // a disk worker that never runs, like one stopped with the router
+  llarp_threadpool* disk = llarp_init_same_process_threadpool();
+  llarp_nodedb_set_disk_worker(db, disk);
+  llarp::SecretKey sk;
+  crypto.identity_keygen(sk);
+  llarp::RouterContact rc;
+  ASSERT_TRUE(rc.Sign(&crypto, sk));
+  ASSERT_TRUE(llarp_nodedb_put_rc(db, rc));
+  good.push_back(rc.pubkey);
+  llarp_nodedb_set_disk_worker(db, nullptr);
+  ASSERT_TRUE(llarp_nodedb_write_snapshot(db));
+  // past the fs clock granularity so a write on free would be newer
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  llarp_nodedb_free(&db);
+  llarp_free_threadpool(&disk);
+
+  // the snapshot is not older than the rc files so it gets used
+  db = Load(worker);
+  ASSERT_TRUE(fs::exists(SnapshotPath()));
+  llarp_nodedb_free(&db);
+};
+
+TEST_F(NodeDBTest, TestWriteBehind)
+{
+  static constexpr size_t NumRCs = 200;
+  llarp_nodedb* db = llarp_nodedb_new(&crypto);
+  llarp_nodedb_set_dir(db, dir.string().c_str());
+  llarp_nodedb_set_disk_worker(db, worker);
+  std::vector< llarp::RouterContact > rcs(NumRCs);
+  for(auto& rc : rcs)
+  {
+    llarp::SecretKey sk;
+    crypto.identity_keygen(sk);
+    ASSERT_TRUE(rc.Sign(&crypto, sk));
+    good.push_back(rc.pubkey);
+    ASSERT_TRUE(llarp_nodedb_put_rc(db, rc));
+  }
+  ASSERT_TRUE(llarp_nodedb_flush(db));
+
+  auto inode = [&](const llarp::RouterContact& rc) -> ino_t {
+    char tmp[68] = {0};
+    std::string hex =
+        llarp::HexEncode< llarp::PubKey, decltype(tmp) >(rc.pubkey, tmp);
+    struct stat st;
+    fs::path fpath = dir / hex.substr(hex.size() - 1) / (hex + ".signed");
+    if(stat(fpath.string().c_str(), &st) == -1)
+      return 0;
+    return st.st_ino;
+  };
+  std::vector< ino_t > inodes;
+  for(const auto& rc : rcs)
+  {
+    inodes.push_back(inode(rc));
+    ASSERT_NE(inodes.back(), 0U);
+  }
+
+  // the same bytes are not written again, changed ones replace the file
+  rcs[1].last_updated += 1;
+  for(const auto& rc : rcs)
+    ASSERT_TRUE(llarp_nodedb_put_rc(db, rc));
+  ASSERT_TRUE(llarp_nodedb_del_rc(db, rcs[2].pubkey));
+  good.erase(good.begin() + 2);
+  ASSERT_TRUE(llarp_nodedb_flush(db));
+  for(size_t idx = 0; idx < NumRCs; ++idx)
+  {
+    if(idx == 1)
+      ASSERT_NE(inode(rcs[idx]), inodes[idx]);
+    else if(idx == 2)
+      ASSERT_EQ(inode(rcs[idx]), 0U);
+    else
+      ASSERT_EQ(inode(rcs[idx]), inodes[idx]);
+  }
+
+  // pending writes go out when the nodedb does
+  llarp::SecretKey sk;
+  crypto.identity_keygen(sk);
+  llarp::RouterContact last;
+  ASSERT_TRUE(last.Sign(&crypto, sk));
+  good.push_back(last.pubkey);
+  llarp_threadpool_stop(worker);
+  llarp_threadpool_join(worker);
+  ASSERT_TRUE(llarp_nodedb_put_rc(db, last));
+  llarp_nodedb_free(&db);
+
+  // rcs[1] no longer verifies
+  good.erase(good.begin() + 1);
+  db = Load(nullptr);
+  llarp_nodedb_free(&db);
+};
+
+TEST_F(NodeDBTest, TestWeightedHopSelection)
+{
+  static constexpr size_t NumHops = 10;
+  static constexpr size_t Picks   = 45000;
+  llarp_nodedb* db = llarp_nodedb_new(&crypto);
+  llarp_nodedb_set_dir(db, dir.string().c_str());
+  std::vector< llarp::RouterContact > rcs(NumHops + 1);
+  std::map< llarp::PubKey, uint64_t > weights;
+  for(size_t idx = 0; idx < rcs.size(); ++idx)
+  {
+    rcs[idx].pubkey.Randomize();
+    // the last one is a client
+    if(idx < NumHops)
+    {
+      llarp::AddressInfo ai;
+      ai.dialect = "test";
+      ai.port    = idx;
+      rcs[idx].addrs.push_back(ai);
+    }
+    weights[rcs[idx].pubkey] = idx;
+    ASSERT_TRUE(llarp_nodedb_put_rc(db, rcs[idx]));
+  }
+  llarp_nodedb_set_hop_weight_func(
+      db, [&weights](const llarp::RouterContact& rc) -> uint64_t {
+        return weights[rc.pubkey];
+      });
+
+  auto pick = [&](const llarp::RouterContact& prev) {
+    std::map< llarp::PubKey, size_t > picked;
+    llarp::RouterContact result;
+    for(size_t n = 0; n < Picks; ++n)
+    {
+      if(llarp_nodedb_select_random_hop(db, prev, result, 1))
+      {
+        EXPECT_NE(result.pubkey, prev.pubkey);
+        ++picked[result.pubkey];
+      }
+    }
+    return picked;
+  };
+
+  // in proportion to weights 0..9 out of 45
+  auto picked = pick(rcs[NumHops]);
+  ASSERT_EQ(picked.count(rcs[0].pubkey), 0U);
+  ASSERT_EQ(picked.count(rcs[NumHops].pubkey), 0U);
+  for(size_t idx = 1; idx < NumHops; ++idx)
+  {
+    ASSERT_GT(picked[rcs[idx].pubkey], idx * 800);
+    ASSERT_LT(picked[rcs[idx].pubkey], idx * 1200);
+  }
+
+  weights[rcs[9].pubkey] = 0;
+  llarp_nodedb_update_hop_weight(db, rcs[9].pubkey);
+  ASSERT_TRUE(llarp_nodedb_del_rc(db, rcs[5].pubkey));
+  weights[rcs[0].pubkey] = 5;
+  llarp_nodedb_update_hop_weight(db, rcs[0].pubkey);
+  picked = pick(rcs[8]);
+  ASSERT_EQ(picked.count(rcs[5].pubkey), 0U);
+  ASSERT_EQ(picked.count(rcs[8].pubkey), 0U);
+  ASSERT_EQ(picked.count(rcs[9].pubkey), 0U);
+  ASSERT_GT(picked[rcs[0].pubkey], 0U);
+  llarp_nodedb_free(&db);
+
+  // what the router weighs them with
+  llarp::Profiling profiling;
+  llarp::RouterID r;
+  r.Randomize();
+  const uint64_t unknown = profiling.HopWeight(r);
+  ASSERT_EQ(unknown, 1000U);
+  profiling.MarkTimeout(r);
+  ASSERT_EQ(profiling.HopWeight(r), 1U);
+  profiling.MarkSuccess(r);
+  profiling.MarkSuccess(r);
+  ASSERT_GT(profiling.HopWeight(r), 1U);
+  ASSERT_LT(profiling.HopWeight(r), unknown);
+  auto changed = profiling.TakeChanged();
+  ASSERT_EQ(changed.size(), 1U);
+  ASSERT_EQ(changed[0], r);
+  ASSERT_TRUE(profiling.TakeChanged().empty());
+};
+
+TEST_F(NodeDBTest, DISABLED_BenchColdStart)
+{
+  auto ms = [](std::chrono::steady_clock::duration d) {
+    return std::chrono::duration_cast< std::chrono::milliseconds >(d).count();
+  };
+  for(const size_t num : {5000, 50000})
+  {
+    WriteRCs(num - good.size(), false);
+
+    auto start       = std::chrono::steady_clock::now();
+    llarp_nodedb* db = Load(nullptr);
+    auto serialTime  = std::chrono::steady_clock::now() - start;
+    llarp_nodedb_free(&db);
+
+    start             = std::chrono::steady_clock::now();
+    db                = Load(worker);
+    auto parallelTime = std::chrono::steady_clock::now() - start;
+    ASSERT_TRUE(llarp_nodedb_write_snapshot(db));
+    llarp_nodedb_free(&db);
+
+    start             = std::chrono::steady_clock::now();
+    db                = Load(worker);
+    auto snapshotTime = std::chrono::steady_clock::now() - start;
+    llarp_nodedb_free(&db);
+    fs::remove(SnapshotPath());
+
+    std::cout << num << " rc cold start: one thread " << ms(serialTime)
+              << "ms, " << std::max(std::thread::hardware_concurrency(), 2U)
+              << " workers " << ms(parallelTime) << "ms, snapshot "
+              << ms(snapshotTime) << "ms" << std::endl;
+  }
+};
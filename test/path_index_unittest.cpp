@@ -0,0 +1,231 @@
+#include <gtest/gtest.h>
+#include <llarp/path_index.hpp>
+#include <llarp/router_id.hpp>
+#include <llarp/time.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct FakeHop
+{
+  llarp::PathID_t txID;
+  llarp::PathID_t rxID;
+  llarp::RouterID upstream;
+  llarp_time_t expires;
+};
+
+typedef llarp::path::PathIndex< FakeHop > Index_t;
+
+class PathIndexTest : public ::testing::Test
+{
+ public:
+  std::vector< FakeHop > hops;
+
+  void
+  MakeHops(size_t num)
+  {
+    hops.resize(num);
+    for(size_t idx = 0; idx < num; ++idx)
+    {
+      hops[idx].txID.Randomize();
+      hops[idx].rxID.Randomize();
+      hops[idx].upstream.Randomize();
+      hops[idx].expires = idx;
+    }
+  }
+};
+
+TEST_F(PathIndexTest, TestMatchesMultimap)
+{
+  MakeHops(2000);
+  // share some path ids between hops like the multimap allowed
+  for(size_t idx = 1; idx < hops.size(); idx += 7)
+    hops[idx].txID = hops[idx - 1].txID;
+
+  Index_t index(16);
+  std::multimap< llarp::PathID_t, FakeHop* > model;
+  std::mt19937 rng(1234);
+  std::vector< bool > present(hops.size(), false);
+
+  for(size_t round = 0; round < 20000; ++round)
+  {
+    size_t idx   = rng() % hops.size();
+    FakeHop* hop = &hops[idx];
+    if(present[idx])
+    {
+      ASSERT_TRUE(index.Remove(hop->txID, hop));
+      ASSERT_TRUE(index.Remove(hop->rxID, hop));
+      ASSERT_FALSE(index.Remove(hop->rxID, hop));
+      for(const auto& id : {hop->txID, hop->rxID})
+      {
+        auto range = model.equal_range(id);
+        for(auto itr = range.first; itr != range.second; ++itr)
+        {
+          if(itr->second == hop)
+          {
+            model.erase(itr);
+            break;
+          }
+        }
+      }
+    }
+    else
+    {
+      index.Insert(hop->txID, hop);
+      index.Insert(hop->rxID, hop);
+      model.emplace(hop->txID, hop);
+      model.emplace(hop->rxID, hop);
+    }
+    present[idx] = !present[idx];
+    ASSERT_EQ(index.Size(), model.size());
+  }
+
+  for(size_t idx = 0; idx < hops.size(); ++idx)
+  {
+    FakeHop* hop = &hops[idx];
+    auto byTX    = index.Find(hop->txID, [hop](const FakeHop* h) -> bool {
+      return h->upstream == hop->upstream;
+    });
+    auto byRX    = index.Find(hop->rxID, [hop](const FakeHop* h) -> bool {
+      return h == hop;
+    });
+    ASSERT_EQ(byTX, present[idx] ? hop : nullptr);
+    ASSERT_EQ(byRX, present[idx] ? hop : nullptr);
+  }
+};
+
+TEST_F(PathIndexTest, TestReadersDuringWrites)
+{
+  static constexpr size_t Stable = 1000;
+  MakeHops(Stable + 10000);
+  Index_t index(16);
+  for(size_t idx = 0; idx < Stable; ++idx)
+    index.Insert(hops[idx].txID, &hops[idx]);
+
+  std::atomic< bool > done(false);
+  std::atomic< size_t > misses(0);
+  std::vector< std::thread > readers;
+  for(size_t r = 0; r < 2; ++r)
+  {
+    readers.emplace_back([&]() {
+      while(!done)
+      {
+        for(size_t idx = 0; idx < Stable; ++idx)
+        {
+          if(index.Find(hops[idx].txID) != &hops[idx])
+            ++misses;
+        }
+      }
+    });
+  }
+  // churn through growth and backward shifts while they read
+  for(size_t idx = Stable; idx < hops.size(); ++idx)
+    index.Insert(hops[idx].txID, &hops[idx]);
+  for(size_t idx = Stable; idx < hops.size(); ++idx)
+    index.Remove(hops[idx].txID, &hops[idx]);
+  done = true;
+  for(auto& reader : readers)
+    reader.join();
+  ASSERT_EQ(misses, 0U);
+  ASSERT_EQ(index.Size(), Stable);
+};
+
+TEST_F(PathIndexTest, DISABLED_Bench100kTransitHops)
+{
+  static constexpr size_t NumHops = 100000;
+  static constexpr size_t Lookups = 1000000;
+  MakeHops(NumHops);
+
+  typedef std::pair< llarp::util::Mutex,
+                     std::multimap< llarp::PathID_t, FakeHop* > >
+      SyncMap_t;
+  SyncMap_t map;
+  Index_t index;
+  typedef std::pair< llarp_time_t, FakeHop* > Expiry_t;
+  std::priority_queue< Expiry_t, std::vector< Expiry_t >,
+                       std::greater< Expiry_t > >
+      heap;
+  for(auto& hop : hops)
+  {
+    map.second.emplace(hop.txID, &hop);
+    map.second.emplace(hop.rxID, &hop);
+    index.Insert(hop.txID, &hop);
+    index.Insert(hop.rxID, &hop);
+    heap.emplace(hop.expires, &hop);
+  }
+
+  std::mt19937 rng(42);
+  std::vector< size_t > order(Lookups);
+  for(auto& idx : order)
+    idx = rng() % NumHops;
+
+  // what PathContext::GetByUpstream used to do for every relayed message
+  auto start      = std::chrono::steady_clock::now();
+  size_t foundMap = 0;
+  for(const auto idx : order)
+  {
+    const FakeHop& hop = hops[idx];
+    llarp::util::Lock lock(map.first);
+    auto range = map.second.equal_range(hop.txID);
+    for(auto itr = range.first; itr != range.second; ++itr)
+    {
+      if(itr->second->upstream == hop.upstream)
+      {
+        ++foundMap;
+        break;
+      }
+    }
+  }
+  auto mapTime = std::chrono::steady_clock::now() - start;
+
+  start             = std::chrono::steady_clock::now();
+  size_t foundIndex = 0;
+  for(const auto idx : order)
+  {
+    const FakeHop& hop = hops[idx];
+    if(index.Find(hop.txID, [&hop](const FakeHop* h) -> bool {
+         return h->upstream == hop.upstream;
+       }))
+      ++foundIndex;
+  }
+  auto indexTime = std::chrono::steady_clock::now() - start;
+  ASSERT_EQ(foundMap, Lookups);
+  ASSERT_EQ(foundIndex, Lookups);
+
+  // a router tick where nothing has expired yet
+  const llarp_time_t now = 0;
+  start                  = std::chrono::steady_clock::now();
+  size_t expiredWalk     = 0;
+  {
+    llarp::util::Lock lock(map.first);
+    for(const auto& item : map.second)
+      if(item.second->expires < now)
+        ++expiredWalk;
+  }
+  auto walkTime = std::chrono::steady_clock::now() - start;
+
+  start             = std::chrono::steady_clock::now();
+  size_t expiredTop = 0;
+  while(heap.size() && heap.top().first < now)
+  {
+    heap.pop();
+    ++expiredTop;
+  }
+  auto heapTime = std::chrono::steady_clock::now() - start;
+  ASSERT_EQ(expiredWalk, expiredTop);
+
+  auto us = [](std::chrono::steady_clock::duration d) {
+    return std::chrono::duration_cast< std::chrono::microseconds >(d).count();
+  };
+  std::cout << NumHops << " transit hops, " << Lookups
+            << " lookups: locked multimap " << us(mapTime)
+            << "us, path index " << us(indexTime) << "us" << std::endl;
+  std::cout << "expiry check: full walk " << us(walkTime)
+            << "us, expiry heap " << us(heapTime) << "us" << std::endl;
+};
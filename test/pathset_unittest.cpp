@@ -0,0 +1,247 @@
+#include <gtest/gtest.h>
+#include <llarp/path.hpp>
+
+#include <map>
+#include <vector>
+
+struct TestPathSet : public llarp::path::PathSet
+{
+  TestPathSet(size_t num) : llarp::path::PathSet(num)
+  {
+  }
+
+  bool
+  SelectHop(llarp_nodedb*, const llarp::RouterContact&, llarp::RouterContact&,
+            size_t)
+  {
+    return false;
+  }
+};
+
+class PathSetTest : public ::testing::Test
+{
+ public:
+  /// a path through 3 made up routers, built at started, ending at
+  /// endpoint unless that is zero
+  static llarp::path::Path*
+  MakePath(llarp::path::PathStatus st, llarp_time_t started,
+           const llarp::RouterID& endpoint = llarp::RouterID())
+  {
+    std::vector< llarp::RouterContact > hops(3);
+    for(auto& hop : hops)
+      hop.pubkey.Randomize();
+    if(!endpoint.IsZero())
+      hops.back().pubkey = endpoint;
+    auto p          = new llarp::path::Path(hops);
+    p->buildStarted = started;
+    p->_status      = st;
+    return p;
+  }
+
+  /// drop every path in set
+  static void
+  Clear(TestPathSet& set, std::vector< llarp::path::Path* >& paths)
+  {
+    for(auto p : paths)
+      p->_status = llarp::path::ePathTimeout;
+    set.ExpirePaths(0);
+    paths.clear();
+  }
+};
+
+TEST_F(PathSetTest, TestSparesAndStagger)
+{
+  static constexpr llarp_time_t Lifetime = DEFAULT_PATH_LIFETIME;
+  TestPathSet set(4);
+  set.numSpare     = 2;
+  set.rebuildAhead = 60 * 1000;
+  ASSERT_EQ(set.NumPathsWanted(0), 6U);
+
+  // building and timed out paths
+  std::vector< llarp::path::Path* > paths;
+  for(size_t idx = 0; idx < 3; ++idx)
+  {
+    paths.push_back(MakePath(llarp::path::ePathBuilding, 0));
+    set.AddPath(paths.back());
+  }
+  paths.push_back(MakePath(llarp::path::ePathTimeout, 0));
+  set.AddPath(paths.back());
+  ASSERT_EQ(set.NumPathsWanted(0), 3U);
+  ASSERT_TRUE(set.ShouldBuildMore());
+  Clear(set, paths);
+
+  // a batch all built at once goes due for replacement bit by bit over
+  // the rebuildAhead long window before rebuildAhead
+  static constexpr size_t NumPaths = 100;
+  set.numSpare = NumPaths;
+  for(size_t idx = 0; idx < NumPaths; ++idx)
+  {
+    paths.push_back(MakePath(llarp::path::ePathEstablished, 0));
+    set.AddPath(paths.back());
+  }
+  ASSERT_EQ(set.NumPathsWanted(Lifetime / 2 - 1), 4U);
+  size_t last = 4;
+  std::vector< size_t > wanted;
+  for(llarp_time_t ago = 110; ago > 60; ago -= 10)
+  {
+    wanted.push_back(set.NumPathsWanted(Lifetime - ago * 1000));
+    ASSERT_GE(wanted.back(), last);
+    last = wanted.back();
+  }
+  ASSERT_GT(wanted.front(), 4U);
+  ASSERT_LT(wanted.front(), 4U + NumPaths / 4);
+  ASSERT_GT(wanted.back(), 4U + NumPaths / 2);
+  ASSERT_EQ(set.NumPathsWanted(Lifetime - 60 * 1000), 4U + NumPaths);
+
+  // no stagger when told not to rebuild ahead
+  set.rebuildAhead = 0;
+  ASSERT_EQ(set.NumPathsWanted(Lifetime - 1), 4U);
+  ASSERT_EQ(set.NumPathsWanted(Lifetime), 4U + NumPaths);
+  Clear(set, paths);
+};
+
+TEST_F(PathSetTest, TestTimeToFirstPath)
+{
+  TestPathSet set(2);
+  auto start = llarp_time_now_ms();
+  set.PathEstablished(start + 1500);
+  // only the first one counts
+  set.PathEstablished(start + 3000);
+  ASSERT_EQ(set.ReadyStats().samples, 1U);
+  ASSERT_GE(set.ReadyStats().max, 1500U);
+  ASSERT_LT(set.ReadyStats().max, 2500U);
+
+  // again once the last established path goes
+  std::vector< llarp::path::Path* > paths;
+  paths.push_back(MakePath(llarp::path::ePathEstablished, 0));
+  set.AddPath(paths.back());
+  set.ExpirePaths(10000);
+  set.ExpirePaths(20000);
+  set.PathEstablished(20500);
+  ASSERT_EQ(set.ReadyStats().samples, 1U);
+  Clear(set, paths);
+  set.ExpirePaths(30000);
+  set.PathEstablished(30500);
+  ASSERT_EQ(set.ReadyStats().samples, 2U);
+  ASSERT_EQ(set.ReadyStats().total, set.ReadyStats().max + 500);
+};
+
+TEST_F(PathSetTest, TestBuildBudget)
+{
+  llarp::path::PathBuildBudget budget;
+  budget.rate        = 2;
+  budget.burst       = 4;
+  budget.maxBuilding = 6;
+  // a burst to start with
+  ASSERT_EQ(budget.Take(1000, 10, 0), 4U);
+  ASSERT_EQ(budget.Take(1000, 10, 4), 0U);
+  // then the rate
+  ASSERT_EQ(budget.Take(1500, 10, 4), 1U);
+  ASSERT_EQ(budget.Take(2000, 10, 5), 1U);
+  // never past maxBuilding however long we waited
+  ASSERT_EQ(budget.Take(60000, 10, 6), 0U);
+  ASSERT_EQ(budget.Take(60000, 10, 3), 3U);
+  ASSERT_EQ(budget.Take(60000, 10, 0), 1U);
+  ASSERT_EQ(budget.started, 10U);
+  ASSERT_EQ(budget.deferred, 60U);
+  // builds that never started go back
+  budget.Refund(1);
+  ASSERT_EQ(budget.started, 9U);
+  ASSERT_EQ(budget.Take(60000, 10, 0), 1U);
+
+  // no limits
+  llarp::path::PathBuildBudget open;
+  open.rate        = 0;
+  open.maxBuilding = 0;
+  ASSERT_EQ(open.Take(0, 100, 1000), 100U);
+  ASSERT_EQ(open.deferred, 0U);
+};
+
+TEST_F(PathSetTest, TestPathQuality)
+{
+  llarp::path::PathQuality q;
+  ASSERT_EQ(q.BaseCost(), double(llarp::path::PathQuality::DefaultRTT));
+  q.SampleRTT(100);
+  ASSERT_EQ(q.srtt, 100U);
+  ASSERT_EQ(q.rttvar, 50U);
+  for(size_t idx = 0; idx < 100; ++idx)
+    q.SampleRTT(200);
+  ASSERT_GT(q.srtt, 190U);
+  ASSERT_LE(q.srtt, 200U);
+  ASSERT_LT(q.rttvar, 10U);
+  const double base = q.BaseCost();
+
+  // what we send fades out over a few rtt
+  q.Sent(64 * 1024, 1000);
+  ASSERT_DOUBLE_EQ(q.Cost(1000), 2 * base);
+  ASSERT_LT(q.Cost(1000 + q.srtt), 1.5 * base);
+  ASSERT_LT(q.Cost(1000 + 10 * q.srtt), 1.001 * base);
+
+  // drops go against it, sending clean wins it back
+  for(size_t idx = 0; idx < 64; ++idx)
+    q.Lost();
+  ASSERT_GT(q.loss, 0.5);
+  ASSERT_GT(q.BaseCost(), 2 * base);
+  for(size_t idx = 0; idx < 1000; ++idx)
+    q.Sent(0, 100000);
+  ASSERT_LT(q.loss, 0.01);
+};
+
+TEST_F(PathSetTest, TestPickPathByRouter)
+{
+  TestPathSet set(4);
+  llarp::RouterID router;
+  router.Randomize();
+  std::vector< llarp::path::Path* > paths;
+  // rtt 100, 200, 300 and 400 ms to router, and one elsewhere
+  for(size_t idx = 0; idx < 4; ++idx)
+  {
+    paths.push_back(MakePath(llarp::path::ePathEstablished, 0, router));
+    paths.back()->intro.latency = 100 * (idx + 1);
+    paths.back()->quality.SampleRTT(paths.back()->intro.latency);
+    set.AddPath(paths.back());
+  }
+  paths.push_back(MakePath(llarp::path::ePathEstablished, 0));
+  paths.back()->intro.latency = 10;
+  paths.back()->quality.SampleRTT(10);
+  set.AddPath(paths.back());
+  ASSERT_EQ(set.GetPathByRouter(router), paths[0]);
+
+  // pinned, it all goes on the best
+  set.stripeWidth = 1;
+  for(size_t idx = 0; idx < 100; ++idx)
+  {
+    auto p = set.PickPathByRouter(router, 1000);
+    ASSERT_EQ(p, paths[0]);
+    p->quality.Sent(1024, 1000);
+  }
+
+  // striped, the best two take turns as they fill up
+  for(auto p : paths)
+    p->quality = llarp::path::PathQuality();
+  for(size_t idx = 0; idx < 4; ++idx)
+    paths[idx]->quality.SampleRTT(100 * (idx + 1));
+  set.stripeWidth = 2;
+  std::map< llarp::path::Path*, size_t > used;
+  for(size_t idx = 0; idx < 300; ++idx)
+  {
+    auto p = set.PickPathByRouter(router, 2000);
+    ASSERT_EQ(p->Endpoint(), router);
+    p->quality.Sent(1024, 2000);
+    ++used[p];
+  }
+  ASSERT_EQ(used.size(), 2U);
+  ASSERT_GT(used[paths[1]], 50U);
+  ASSERT_GT(used[paths[0]], used[paths[1]]);
+
+  // losses push a path out of the best two
+  for(size_t idx = 0; idx < 100; ++idx)
+    paths[0]->quality.Lost();
+  set.stripeWidth = 0;
+  ASSERT_EQ(set.GetPathByRouter(router), paths[1]);
+
+  llarp::RouterID nowhere;
+  nowhere.Randomize();
+  ASSERT_EQ(set.PickPathByRouter(nowhere, 2000), nullptr);
+  Clear(set, paths);
+};
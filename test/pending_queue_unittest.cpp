@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <llarp/pending_queue.hpp>
+#include <llarp/router_id.hpp>
+
+#include <vector>
+
+typedef llarp::util::PendingQueues< llarp::RouterID, size_t > Queues;
+
+class PendingQueueTest : public ::testing::Test
+{
+ public:
+  llarp::util::PendingBudget budget;
+  llarp::RouterID alice, bob;
+
+  PendingQueueTest()
+  {
+    alice.Randomize();
+    bob.Randomize();
+  }
+
+  /// drain k from q at now, what we got in order
+  static std::vector< size_t >
+  Drain(Queues& q, const llarp::RouterID& k, llarp_time_t now)
+  {
+    std::vector< size_t > got;
+    q.Drain(k, now, [&got](size_t val) { got.push_back(val); });
+    return got;
+  }
+};
+
+TEST_F(PendingQueueTest, TestBudgets)
+{
+  budget.limit = 1000;
+  Queues q(&budget), other(&budget);
+  q.limits.bytesPerDest     = 400;
+  other.limits.bytesPerDest = 0;
+
+  for(size_t idx = 0; idx < 5; ++idx)
+    ASSERT_EQ(q.Put(alice, idx, 100, 0), idx < 4);
+  ASSERT_TRUE(q.Put(bob, 4, 400, 0));
+  ASSERT_EQ(budget.Used(), 800U);
+  // the rest of the global budget
+  ASSERT_TRUE(other.Put(alice, 0, 200, 0));
+  ASSERT_FALSE(other.Put(alice, 1, 1, 0));
+  ASSERT_FALSE(q.Put(bob, 5, 1, 0));
+
+  auto st = q.Stats();
+  ASSERT_EQ(st.queues, 2U);
+  ASSERT_EQ(st.depth, 5U);
+  ASSERT_EQ(st.bytes, 800U);
+  ASSERT_EQ(st.queued, 5U);
+  ASSERT_EQ(st.droppedFull, 2U);
+
+  ASSERT_EQ(Drain(q, alice, 0), std::vector< size_t >({0, 1, 2, 3}));
+  ASSERT_FALSE(q.Has(alice));
+  ASSERT_EQ(budget.Used(), 600U);
+  ASSERT_EQ(q.Discard(bob), 1U);
+  ASSERT_EQ(budget.Used(), 200U);
+  st = q.Stats();
+  ASSERT_EQ(st.queues, 0U);
+  ASSERT_EQ(st.depth, 0U);
+  ASSERT_EQ(st.bytes, 0U);
+  ASSERT_EQ(st.sent, 4U);
+  ASSERT_EQ(st.discarded, 1U);
+  {
+    Queues gone(&budget);
+    ASSERT_TRUE(gone.Put(bob, 0, 500, 0));
+  }
+  ASSERT_EQ(budget.Used(), 200U);
+};
+
+TEST_F(PendingQueueTest, TestSojournDrops)
+{
+  Queues q(&budget);
+  q.limits.bytesPerDest = 0;
+  q.limits.targetMs     = 100;
+  q.limits.intervalMs   = 100;
+
+  // nothing goes before the queue stood above target for an interval
+  for(size_t idx = 0; idx < 10; ++idx)
+    ASSERT_TRUE(q.Put(alice, idx, 1, idx));
+  ASSERT_EQ(Drain(q, alice, 199).size(), 10U);
+  ASSERT_EQ(q.Stats().droppedStale, 0U);
+
+  // then the head goes at interval / sqrt(count), catching up on the time
+  // nobody looked, until the head is fresh again
+  for(size_t idx = 0; idx < 1000; ++idx)
+    ASSERT_TRUE(q.Put(alice, idx, 1, 0));
+  for(size_t idx = 1000; idx < 1010; ++idx)
+    ASSERT_TRUE(q.Put(alice, idx, 1, 1000));
+  // drops at 200, 300, 370, 427, 477, 521, 561, 598, 633, 666, ...
+  // 200 + sum(100 / sqrt(n)) passes 1000 after about 23 of them
+  auto got     = Drain(q, alice, 1000);
+  auto dropped = q.Stats().droppedStale;
+  ASSERT_GT(dropped, 18U);
+  ASSERT_LT(dropped, 28U);
+  ASSERT_EQ(got.size(), 1010U - dropped);
+  ASSERT_EQ(got.front(), dropped);
+  ASSERT_EQ(got.back(), 1009U);
+
+  // putting sheds the stale head too, so a standing queue cannot hold
+  // memory forever
+  for(llarp_time_t now = 0; now < 10000; now += 10)
+    q.Put(alice, now, 1, now);
+  auto st = q.Stats();
+  ASSERT_LT(st.depth, 200U);
+  ASSERT_EQ(budget.Used(), st.depth);
+  got = Drain(q, alice, 10000);
+  ASSERT_LT(10000 - got.front(), 1000U);
+
+  // target 0 never drops for waiting
+  q.limits.targetMs = 0;
+  ASSERT_TRUE(q.Put(bob, 0, 1, 0));
+  ASSERT_EQ(Drain(q, bob, 1000000).size(), 1U);
+};
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include <llarp/crypto.hpp>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <thread>
+#include <vector>
+
+class RandBytesTest : public ::testing::Test
+{
+ public:
+  llarp_crypto crypto;
+
+  RandBytesTest()
+  {
+    llarp_crypto_init(&crypto);
+  }
+
+  /// sz bytes drawn in chunks of up to chunk bytes
+  static std::vector< byte_t >
+  Draw(size_t sz, size_t chunk)
+  {
+    std::vector< byte_t > data(sz);
+    for(size_t off = 0; off < sz; off += chunk)
+      llarp_randbytes(data.data() + off, std::min(chunk, sz - off));
+    return data;
+  }
+};
+
+TEST_F(RandBytesTest, TestThreadsIndependent)
+{
+  static constexpr size_t NumThreads = 8;
+  static constexpr size_t Bytes      = 128 * 1024;
+  std::vector< std::vector< byte_t > > got(NumThreads);
+  std::vector< std::thread > threads;
+  for(size_t idx = 0; idx < NumThreads; ++idx)
+  {
+    // small, odd and past the buffer sized draws
+    const size_t chunk = size_t(1) << (idx + 3);
+    threads.emplace_back(
+        [&got, idx, chunk]() { got[idx] = Draw(Bytes, chunk); });
+  }
+  for(auto& t : threads)
+    t.join();
+
+  // no two threads share a stream, not even offset by a draw
+  std::set< std::vector< byte_t > > blocks;
+  std::vector< size_t > counts(256);
+  for(const auto& data : got)
+  {
+    for(size_t off = 0; off < Bytes; off += 16)
+      ASSERT_TRUE(
+          blocks.emplace(data.begin() + off, data.begin() + off + 16).second);
+    for(const auto b : data)
+      ++counts[b];
+  }
+  // about 4096 of each byte value
+  for(const auto count : counts)
+  {
+    ASSERT_GT(count, 3500U);
+    ASSERT_LT(count, 4700U);
+  }
+};
+
+TEST_F(RandBytesTest, TestForkReseeds)
+{
+  auto before = Draw(64, 64);
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  pid_t pid = fork();
+  ASSERT_NE(pid, -1);
+  if(pid == 0)
+  {
+    auto child    = Draw(64, 64);
+    ssize_t wrote = write(fds[1], child.data(), child.size());
+    _exit(wrote == ssize_t(child.size()) ? 0 : 1);
+  }
+  auto parent = Draw(64, 64);
+  std::vector< byte_t > child(64);
+  ASSERT_EQ(read(fds[0], child.data(), child.size()), ssize_t(child.size()));
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+  close(fds[0]);
+  close(fds[1]);
+  ASSERT_NE(before, parent);
+  ASSERT_NE(parent, child);
+};
+
+TEST_F(RandBytesTest, DISABLED_BenchRandBytes)
+{
+  static constexpr size_t Bytes = 16 * 1024 * 1024;
+  std::vector< byte_t > data(8192);
+  auto mbps = [](std::chrono::steady_clock::duration d) {
+    auto us =
+        std::chrono::duration_cast< std::chrono::microseconds >(d).count();
+    return us ? double(Bytes) / us : 0.0;
+  };
+  for(const size_t sz : {8, 24, 32, 1100, 8192})
+  {
+    const size_t rounds = Bytes / sz;
+    auto start          = std::chrono::steady_clock::now();
+    for(size_t n = 0; n < rounds; ++n)
+      randombytes(data.data(), sz);
+    auto systemTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for(size_t n = 0; n < rounds; ++n)
+      crypto.randbytes(data.data(), sz);
+    auto bufferedTime = std::chrono::steady_clock::now() - start;
+
+    std::cout << sz << " byte draws: libsodium " << mbps(systemTime)
+              << " MB/s, buffered " << mbps(bufferedTime) << " MB/s"
+              << std::endl;
+  }
+};
@@ -0,0 +1,272 @@
+#include <gtest/gtest.h>
+#include <llarp/lockfree.hpp>
+#include <llarp/threadpool.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+struct JobRecorder
+{
+  std::vector< size_t > order;
+  size_t next = 0;
+
+  static void
+  Record(void* user)
+  {
+    JobRecorder* self = static_cast< JobRecorder* >(user);
+    self->order.push_back(self->next++);
+  }
+};
+
+class ThreadpoolTest : public ::testing::Test
+{
+ public:
+  llarp_threadpool* pool = nullptr;
+
+  void
+  SetUp()
+  {
+    pool = llarp_init_same_process_threadpool();
+  }
+
+  void
+  TearDown()
+  {
+    llarp_free_threadpool(&pool);
+  }
+};
+
+TEST_F(ThreadpoolTest, TestRingOrderPerProducer)
+{
+  static constexpr size_t NumProducers = 4;
+  static constexpr size_t PerProducer  = 100000;
+  llarp::util::MPSCRing< uint64_t, 1024 > ring;
+
+  std::vector< std::thread > producers;
+  for(size_t p = 0; p < NumProducers; ++p)
+  {
+    producers.emplace_back([&ring, p]() {
+      for(uint64_t seq = 0; seq < PerProducer; ++seq)
+      {
+        uint64_t val = (uint64_t(p) << 32) | seq;
+        while(!ring.TryPush(std::move(val)))
+          std::this_thread::yield();
+      }
+    });
+  }
+
+  std::vector< uint64_t > next(NumProducers, 0);
+  size_t popped = 0;
+  uint64_t val;
+  while(popped < NumProducers * PerProducer)
+  {
+    if(!ring.TryPop(val))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    const size_t p = val >> 32;
+    ASSERT_LT(p, NumProducers);
+    ASSERT_EQ(val & 0xffffffff, next[p]);
+    ++next[p];
+    ++popped;
+  }
+  for(auto& t : producers)
+    t.join();
+  ASSERT_FALSE(ring.TryPop(val));
+};
+
+TEST_F(ThreadpoolTest, TestSPSCRingInPlace)
+{
+  static constexpr size_t Num = 200000;
+  struct Slot
+  {
+    uint64_t seq;
+    uint8_t fill[100];
+  };
+  llarp::util::SPSCRing< Slot, 64 > ring;
+
+  std::thread producer([&ring]() {
+    for(uint64_t seq = 0; seq < Num; ++seq)
+    {
+      Slot* slot;
+      while((slot = ring.Reserve()) == nullptr)
+        std::this_thread::yield();
+      slot->seq = seq;
+      memset(slot->fill, seq & 0xff, sizeof(slot->fill));
+      ring.Push();
+    }
+  });
+
+  for(uint64_t seq = 0; seq < Num; ++seq)
+  {
+    Slot* slot;
+    while((slot = ring.Front()) == nullptr)
+      std::this_thread::yield();
+    ASSERT_EQ(slot->seq, seq);
+    ASSERT_EQ(slot->fill[0], seq & 0xff);
+    ASSERT_EQ(slot->fill[sizeof(slot->fill) - 1], seq & 0xff);
+    ring.Pop();
+  }
+  producer.join();
+  ASSERT_EQ(ring.Front(), nullptr);
+
+  // full means no slot until the consumer gives one back
+  for(size_t idx = 0; idx < 64; ++idx)
+  {
+    ASSERT_NE(ring.Reserve(), nullptr);
+    ring.Push();
+  }
+  ASSERT_EQ(ring.Reserve(), nullptr);
+  ASSERT_EQ(ring.SizeApprox(), 64U);
+  ring.Pop();
+  ASSERT_NE(ring.Reserve(), nullptr);
+};
+
+TEST_F(ThreadpoolTest, TestOverflowKeepsOrder)
+{
+  // more than fits in the ring
+  static constexpr size_t NumJobs = 10000;
+  JobRecorder rec;
+  for(size_t idx = 0; idx < NumJobs; ++idx)
+    llarp_threadpool_queue_job(pool, {&rec, &JobRecorder::Record});
+
+  llarp_threadpool_stats stats;
+  llarp_threadpool_get_stats(pool, &stats);
+  ASSERT_EQ(stats.enqueued, NumJobs);
+  ASSERT_EQ(stats.depth, NumJobs);
+  ASSERT_GT(stats.overflowed, 0U);
+
+  llarp_threadpool_tick(pool);
+  ASSERT_EQ(rec.order.size(), NumJobs);
+  for(size_t idx = 0; idx < NumJobs; ++idx)
+    ASSERT_EQ(rec.order[idx], idx);
+
+  llarp_threadpool_get_stats(pool, &stats);
+  ASSERT_EQ(stats.dequeued, NumJobs);
+  ASSERT_EQ(stats.depth, 0U);
+  ASSERT_EQ(stats.maxdepth, NumJobs);
+
+  // the backlog moves into the ring as it drains, once it all fits there
+  // producers are back on the ring
+  const uint64_t overflowed = stats.overflowed;
+  rec.order.clear();
+  rec.next = 0;
+  for(size_t idx = 0; idx < NumJobs; ++idx)
+  {
+    llarp_threadpool_queue_job(pool, {&rec, &JobRecorder::Record});
+    if(idx % 1000 == 999)
+      llarp_threadpool_tick(pool);
+  }
+  llarp_threadpool_tick(pool);
+  ASSERT_EQ(rec.order.size(), NumJobs);
+  for(size_t idx = 0; idx < NumJobs; ++idx)
+    ASSERT_EQ(rec.order[idx], idx);
+  llarp_threadpool_get_stats(pool, &stats);
+  ASSERT_EQ(stats.overflowed, overflowed);
+};
+
+static void
+count_job(void* user)
+{
+  ++(*static_cast< uint64_t* >(user));
+}
+
+TEST_F(ThreadpoolTest, DISABLED_BenchCrossThreadHandoff)
+{
+  static constexpr size_t NumProducers = 4;
+  static constexpr size_t PerProducer  = 250000;
+  static constexpr uint64_t Total      = NumProducers * PerProducer;
+  // well under the ring size so we time the ring and not the overflow
+  static constexpr uint64_t MaxInFlight = 1024;
+  uint64_t ran                          = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector< std::thread > producers;
+  for(size_t p = 0; p < NumProducers; ++p)
+  {
+    producers.emplace_back([&]() {
+      llarp_threadpool_stats st;
+      for(size_t idx = 0; idx < PerProducer; ++idx)
+      {
+        llarp_threadpool_get_stats(pool, &st);
+        while(st.depth >= MaxInFlight)
+        {
+          std::this_thread::yield();
+          llarp_threadpool_get_stats(pool, &st);
+        }
+        llarp_threadpool_queue_job(pool, {&ran, &count_job});
+      }
+    });
+  }
+  // this thread plays the logic thread
+  while(ran < Total)
+    llarp_threadpool_tick(pool);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  for(auto& t : producers)
+    t.join();
+
+  llarp_threadpool_stats stats;
+  llarp_threadpool_get_stats(pool, &stats);
+  ASSERT_EQ(stats.enqueued, Total);
+  ASSERT_EQ(stats.dequeued, Total);
+  ASSERT_EQ(stats.depth, 0U);
+  ASSERT_EQ(stats.overflowed, 0U);
+
+  auto us =
+      std::chrono::duration_cast< std::chrono::microseconds >(elapsed).count();
+  std::cout << Total << " jobs from " << NumProducers << " threads in " << us
+            << "us, " << (Total * 1000000) / (us ? us : 1)
+            << " handoffs/s, max depth " << stats.maxdepth << ", overflowed "
+            << stats.overflowed << std::endl;
+};
+
+struct FanOut
+{
+  llarp_threadpool* pool;
+  std::atomic< size_t > ran{0};
+  std::atomic< size_t > children{0};
+
+  static void
+  Child(void* user)
+  {
+    ++static_cast< FanOut* >(user)->ran;
+  }
+
+  /// queues more jobs from inside a worker
+  static void
+  Parent(void* user)
+  {
+    FanOut* self = static_cast< FanOut* >(user);
+    for(size_t idx = 0; idx < 4; ++idx)
+    {
+      ++self->children;
+      llarp_threadpool_queue_job(self->pool, {self, &FanOut::Child});
+    }
+    ++self->ran;
+  }
+};
+
+TEST(WorkerPoolTest, TestRunsAllJobs)
+{
+  static constexpr size_t NumJobs = 100000;
+  FanOut fan;
+  fan.pool = llarp_init_threadpool(4, "test-worker");
+  for(size_t idx = 0; idx < NumJobs; ++idx)
+  {
+    if(idx % 10)
+      llarp_threadpool_queue_job(fan.pool, {&fan, &FanOut::Child});
+    else
+      llarp_threadpool_queue_job(fan.pool, {&fan, &FanOut::Parent});
+  }
+  while(fan.ran < NumJobs + (NumJobs / 10) * 4)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  ASSERT_EQ(fan.children, (NumJobs / 10) * 4);
+  llarp_threadpool_stop(fan.pool);
+  llarp_threadpool_join(fan.pool);
+  llarp_free_threadpool(&fan.pool);
+};
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include <llarp/timer.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using Timer_t = llarp::timer;
+
+class TimerWheelTest : public ::testing::Test
+{
+ public:
+  static constexpr uint64_t Base     = 1000000;
+  static constexpr uint64_t TickLen  = 100;
+  static constexpr uint64_t NumTicks = 100;
+
+  std::vector< std::unique_ptr< Timer_t > > timers;
+  std::mt19937_64 rng;
+
+  void
+  MakeTimers(size_t num, uint64_t maxTimeout)
+  {
+    timers.clear();
+    std::uniform_int_distribution< uint64_t > dist(0, maxTimeout);
+    for(size_t idx = 0; idx < num; ++idx)
+    {
+      Timer_t* t = new Timer_t(dist(rng));
+      t->id      = idx + 1;
+      t->started = Base;
+      timers.emplace_back(t);
+    }
+  }
+
+  /// how llarp_timer_tick_all found expired timers before the wheel
+  static size_t
+  LinearScan(std::unordered_map< uint32_t, Timer_t* >& m, uint64_t now)
+  {
+    size_t hit = 0;
+    auto itr   = m.begin();
+    while(itr != m.end())
+    {
+      if(now - itr->second->started >= itr->second->timeout
+         || itr->second->canceled)
+      {
+        ++hit;
+        itr = m.erase(itr);
+      }
+      else
+        ++itr;
+    }
+    return hit;
+  }
+};
+
+TEST_F(TimerWheelTest, TestExpiresOnTime)
+{
+  // spans all levels of the wheel
+  MakeTimers(10000, 1000 * 60 * 60 * 24);
+  llarp::TimerWheel wheel(Base);
+  for(const auto& t : timers)
+    wheel.Insert(t.get());
+  ASSERT_EQ(wheel.Size(), timers.size());
+
+  size_t expired = 0;
+  uint64_t now   = Base;
+  uint64_t last  = Base - 1;
+  while(wheel.Size())
+  {
+    // jump ahead in big steps sometimes to exercise the skip path
+    now += (now % 7) ? TickLen : TickLen * 1000;
+    wheel.Advance(now, [&](Timer_t* t) {
+      ASSERT_LE(t->expires(), now);
+      ASSERT_GT(t->expires(), last);
+      ++expired;
+    });
+    last = now;
+  }
+  ASSERT_EQ(expired, timers.size());
+};
+
+TEST_F(TimerWheelTest, TestUnlinkAndExpireNow)
+{
+  MakeTimers(1000, 10000);
+  llarp::TimerWheel wheel(Base);
+  for(const auto& t : timers)
+    wheel.Insert(t.get());
+
+  // remove half and force a few to go off right away
+  for(size_t idx = 0; idx < timers.size(); idx += 2)
+    wheel.Unlink(timers[idx].get());
+  ASSERT_EQ(wheel.Size(), timers.size() / 2);
+  wheel.ExpireNow(timers[1].get());
+  wheel.ExpireNow(timers[3].get());
+
+  std::vector< uint32_t > ids;
+  wheel.Advance(Base, [&](Timer_t* t) { ids.push_back(t->id); });
+  ASSERT_EQ(ids.size(), 2U);
+
+  size_t expired = 0;
+  wheel.Advance(Base + 10000, [&](Timer_t* t) {
+    ASSERT_EQ(t->id % 2, 0U);
+    ++expired;
+  });
+  ASSERT_EQ(expired, (timers.size() / 2) - 2);
+  ASSERT_EQ(wheel.Size(), 0U);
+};
+
+TEST_F(TimerWheelTest, DISABLED_BenchWheelVersusLinearScan)
+{
+  for(const size_t num : {1000, 10000, 100000})
+  {
+    // outstanding timeouts much longer than the run like path and dht timeouts
+    MakeTimers(num, 60 * 1000);
+
+    std::unordered_map< uint32_t, Timer_t* > linear;
+    llarp::TimerWheel wheel(Base);
+    for(const auto& t : timers)
+    {
+      linear.emplace(t->id, t.get());
+      wheel.Insert(t.get());
+    }
+
+    size_t linearHit = 0;
+    size_t wheelHit  = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(uint64_t tick = 1; tick <= NumTicks; ++tick)
+      linearHit += LinearScan(linear, Base + (tick * TickLen));
+    auto linearTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for(uint64_t tick = 1; tick <= NumTicks; ++tick)
+      wheel.Advance(Base + (tick * TickLen), [&](Timer_t*) { ++wheelHit; });
+    auto wheelTime = std::chrono::steady_clock::now() - start;
+
+    ASSERT_EQ(linearHit, wheelHit);
+
+    std::cout << num << " timers " << NumTicks << " ticks: linear scan "
+              << std::chrono::duration_cast< std::chrono::microseconds >(
+                     linearTime)
+                     .count()
+              << "us, timing wheel "
+              << std::chrono::duration_cast< std::chrono::microseconds >(
+                     wheelTime)
+                     .count()
+              << "us" << std::endl;
+  }
+};